@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#include "alu.h"
+
+uint8_t incFlags[256];
+uint8_t decFlags[256];
+uint8_t zeroFlags[256];
+uint16_t addTable[2][0x10000];
+uint16_t subTable[2][0x10000];
+uint16_t daaTable[0x800];
+
+/*
+ * Filled from the same formulas the arithmetic kernels use. 512 KB of
+ * it is ADD/SUB, only filled when ALU_TABLE_ADDSUB uses them.
+ */
+void alu_init(void) {
+    static int done;
+    if (done) {
+        return;
+    }
+    done = 1;
+
+    for (int result = 0; result < 256; result++) {
+        incFlags[result] = (result == 0 ? Z_FLAG : 0) | ((result & 0x0F) == 0 ? H_FLAG : 0);
+        decFlags[result] = N_FLAG | (result == 0 ? Z_FLAG : 0) | ((result & 0x0F) == 0x0F ? H_FLAG : 0);
+        zeroFlags[result] = result == 0 ? Z_FLAG : 0;
+    }
+
+#if ALU_TABLE_ADDSUB
+    for (int carry = 0; carry < 2; carry++) {
+        for (int a = 0; a < 256; a++) {
+            for (int value = 0; value < 256; value++) {
+                int add = a + value + carry;
+                int sub = a - value - carry;
+                addTable[carry][(a << 8) | value] = ((add & 0xFF) << 8) | ((add & 0xFF) == 0 ? Z_FLAG : 0) | ((a & 0x0F) + (value & 0x0F) + carry > 0x0F ? H_FLAG : 0) | (add > 0xFF ? C_FLAG : 0);
+                subTable[carry][(a << 8) | value] = ((sub & 0xFF) << 8) | N_FLAG | ((sub & 0xFF) == 0 ? Z_FLAG : 0) | ((a & 0x0F) < (value & 0x0F) + carry ? H_FLAG : 0) | (sub < 0 ? C_FLAG : 0);
+            }
+        }
+    }
+#endif
+
+    for (int index = 0; index < 0x800; index++) {
+        daaTable[index] = alu_daa_result(index & 0xFF, (index >> 4) & (N_FLAG | H_FLAG | C_FLAG));
+    }
+}
+
+int alu_check(void) {
+    uint16_t saved = af;
+    int bad = 0;
+    for (int value = 0; value < 256; value++) {
+        uint8_t result = value + 1;
+        af = 0;
+        alu_inc(value);
+        bad |= af != ((result == 0 ? Z_FLAG : 0) | ((result & 0x0F) == 0 ? H_FLAG : 0));
+        result = value - 1;
+        af = 0;
+        alu_dec(value);
+        bad |= af != (N_FLAG | (result == 0 ? Z_FLAG : 0) | ((result & 0x0F) == 0x0F ? H_FLAG : 0));
+        for (int flags = 0; flags < 0x100; flags += 0x10) {
+            af = (value << 8) | flags;
+            alu_daa();
+            bad |= af != alu_daa_result(value, flags);
+        }
+    }
+#if ALU_TABLE_ADDSUB
+    for (int a = 0; a < 256; a++) {
+        for (int value = 0; value < 256; value++) {
+            for (int carry = 0; carry < 2; carry++) {
+                int add = a + value + carry;
+                af = a << 8;
+                alu_add(value, carry);
+                bad |= af != (((add & 0xFF) << 8) | ((add & 0xFF) == 0 ? Z_FLAG : 0) | ((a & 0x0F) + (value & 0x0F) + carry > 0x0F ? H_FLAG : 0) | (add > 0xFF ? C_FLAG : 0));
+                int sub = a - value - carry;
+                uint16_t expected = ((sub & 0xFF) << 8) | N_FLAG | ((sub & 0xFF) == 0 ? Z_FLAG : 0) | ((a & 0x0F) < (value & 0x0F) + carry ? H_FLAG : 0) | (sub < 0 ? C_FLAG : 0);
+                af = a << 8;
+                alu_sub(value, carry);
+                bad |= af != expected;
+                if (!carry) {
+                    /* CP keeps A */
+                    af = a << 8;
+                    alu_cp(value);
+                    bad |= af != ((a << 8) | (expected & 0xFF));
+                }
+            }
+        }
+    }
+#endif
+#if ALU_TABLE_LOGIC
+    for (int result = 0; result < 256; result++) {
+        bad |= alu_zero(result) != (result == 0 ? Z_FLAG : 0);
+    }
+#endif
+    af = saved;
+    return bad;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#ifndef ALU_H
+#define ALU_H
+
+#include <stdint.h>
+#include "emu.h"
+
+/*
+ * 8-bit ALU kernels shared by the opcode handlers. Each family can work
+ * out its flags from a table filled by alu_init() or with plain
+ * arithmetic, picked here at compile time. The defaults are whichever
+ * was faster running the handlers over varied operands: INC/DEC and DAA
+ * come out ahead with tables, ADD/SUB (256 KB each, far past L1) and the
+ * Z of the logic ops are quicker worked out.
+ */
+#ifndef ALU_TABLE_INCDEC
+#define ALU_TABLE_INCDEC 1
+#endif
+#ifndef ALU_TABLE_ADDSUB
+#define ALU_TABLE_ADDSUB 0
+#endif
+#ifndef ALU_TABLE_LOGIC
+#define ALU_TABLE_LOGIC 0
+#endif
+#ifndef ALU_TABLE_DAA
+#define ALU_TABLE_DAA 1
+#endif
+
+/* Flags for INC/DEC, indexed by the result */
+extern uint8_t incFlags[256];
+extern uint8_t decFlags[256];
+/* Z on its own, indexed by the result */
+extern uint8_t zeroFlags[256];
+/* A and F after ADD/ADC and SUB/SBC, indexed by carry then A << 8 | operand */
+extern uint16_t addTable[2][0x10000];
+extern uint16_t subTable[2][0x10000];
+/* A and F after DAA, indexed by N, H and C << 8 | A */
+extern uint16_t daaTable[0x800];
+
+/* Fills the tables, call before running anything */
+void alu_init(void);
+/* Runs the tables the kernels use against the plain arithmetic, nonzero if one is off */
+int alu_check(void);
+
+/* Flag bits the ALU does not touch, the low nibble of F stays as it was */
+#define ALU_KEEP 0x0F
+
+static inline uint8_t alu_inc(uint8_t value) {
+    uint8_t result = value + 1;
+#if ALU_TABLE_INCDEC
+    af = (af & (0xFF00 | C_FLAG | ALU_KEEP)) | incFlags[result];
+#else
+    af = (af & (0xFF00 | C_FLAG | ALU_KEEP)) | (result == 0 ? Z_FLAG : 0) | ((result & 0x0F) == 0 ? H_FLAG : 0);
+#endif
+    return result;
+}
+
+static inline uint8_t alu_dec(uint8_t value) {
+    uint8_t result = value - 1;
+#if ALU_TABLE_INCDEC
+    af = (af & (0xFF00 | C_FLAG | ALU_KEEP)) | decFlags[result];
+#else
+    af = (af & (0xFF00 | C_FLAG | ALU_KEEP)) | N_FLAG | (result == 0 ? Z_FLAG : 0) | ((result & 0x0F) == 0x0F ? H_FLAG : 0);
+#endif
+    return result;
+}
+
+/* A = A + value + carry, carry being 0 or 1 */
+static inline void alu_add(uint8_t value, int carry) {
+#if ALU_TABLE_ADDSUB
+    af = addTable[carry][(af & 0xFF00) | value] | (af & ALU_KEEP);
+#else
+    unsigned a = af >> 8;
+    unsigned result = a + value + carry;
+    uint8_t flags = ((result & 0xFF) == 0 ? Z_FLAG : 0) | ((a & 0x0F) + (value & 0x0F) + carry > 0x0F ? H_FLAG : 0) | (result > 0xFF ? C_FLAG : 0);
+    af = ((result & 0xFF) << 8) | flags | (af & ALU_KEEP);
+#endif
+}
+
+/* The A and F that A - value - carry gives */
+static inline uint16_t alu_sub_result(uint8_t value, int carry) {
+#if ALU_TABLE_ADDSUB
+    return subTable[carry][(af & 0xFF00) | value];
+#else
+    unsigned a = af >> 8;
+    unsigned result = a - value - carry;
+    uint8_t flags = N_FLAG | ((result & 0xFF) == 0 ? Z_FLAG : 0) | ((a & 0x0F) < (value & 0x0F) + carry ? H_FLAG : 0) | (result > 0xFF ? C_FLAG : 0);
+    return ((result & 0xFF) << 8) | flags;
+#endif
+}
+
+static inline void alu_sub(uint8_t value, int carry) {
+    af = alu_sub_result(value, carry) | (af & ALU_KEEP);
+}
+
+/* SUB without keeping the result */
+static inline void alu_cp(uint8_t value) {
+    af = (af & (0xFF00 | ALU_KEEP)) | (alu_sub_result(value, 0) & 0xF0);
+}
+
+static inline uint8_t alu_zero(uint8_t result) {
+#if ALU_TABLE_LOGIC
+    return zeroFlags[result];
+#else
+    return result == 0 ? Z_FLAG : 0;
+#endif
+}
+
+static inline void alu_and(uint8_t value) {
+    uint8_t result = (af >> 8) & value;
+    af = (result << 8) | alu_zero(result) | H_FLAG | (af & ALU_KEEP);
+}
+
+static inline void alu_xor(uint8_t value) {
+    uint8_t result = (af >> 8) ^ value;
+    af = (result << 8) | alu_zero(result) | (af & ALU_KEEP);
+}
+
+static inline void alu_or(uint8_t value) {
+    uint8_t result = (af >> 8) | value;
+    af = (result << 8) | alu_zero(result) | (af & ALU_KEEP);
+}
+
+/* The A and F DAA gives, flags being N, H and C as F has them */
+static inline uint16_t alu_daa_result(uint8_t a, uint8_t flags) {
+    uint8_t correction = 0;
+    uint8_t carry = 0;
+    if ((flags & H_FLAG) || (!(flags & N_FLAG) && (a & 0x0F) > 9)) {
+        correction |= 0x06; /* Adjust lower nibble */
+    }
+    if ((flags & C_FLAG) || (!(flags & N_FLAG) && a > 0x99)) {
+        correction |= 0x60; /* Adjust upper nibble */
+        carry = 1;
+    }
+    a = (flags & N_FLAG) ? a - correction : a + correction;
+    return (a << 8) | (a == 0 ? Z_FLAG : 0) | (flags & N_FLAG) | (carry ? C_FLAG : 0);
+}
+
+static inline void alu_daa(void) {
+#if ALU_TABLE_DAA
+    af = daaTable[(af & 0xFF00) >> 8 | (af & (N_FLAG | H_FLAG | C_FLAG)) << 4] | (af & ALU_KEEP);
+#else
+    af = alu_daa_result(af >> 8, af & 0xFF) | (af & ALU_KEEP);
+#endif
+}
+
+#endif /* ALU_H */
@@ -0,0 +1,620 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "aot.h"
+#include "blockcache.h"
+#include "movie.h"
+#include "opcodes.h"
+#include "codepages.h"
+
+/*
+ * honeybun-aot, compiles a ROM ahead of time. Control flow is followed
+ * from the entry point, the interrupt vectors and the RST targets, and
+ * every block found becomes a C function. The guest registers are locals
+ * in it, immediates and cycle counts are constants and branches are plain
+ * ifs, so the C compiler gets to keep registers in host registers across
+ * the block and fold what it can. Ops written out here follow the JIT's
+ * load and store rules; anything else calls its handler with the
+ * registers written back around it. The C is built into a shared object
+ * that `honeybun -A` loads. Only ROM below 0x8000 is looked at; there is
+ * no MBC, so bank 0 is all there is.
+ */
+
+#define OPTSTR "i:o:k:C:h"
+
+/* Where the CPU can start running without a jump we could see */
+static const uint16_t entryPoints[] = {
+    0x0100, /* Cartridge entry */
+    0x0040, 0x0048, 0x0050, 0x0058, 0x0060, /* VBlank, STAT, timer, serial, joypad */
+    0x0000, 0x0008, 0x0010, 0x0018, 0x0020, 0x0028, 0x0030, 0x0038, /* RST */
+};
+
+static const uint16_t immMasks[4] = { 0, 0, 0x00FF, 0xFFFF };
+
+/* Two spare bytes so immediates can be read past the last opcode */
+static uint8_t rom[0x8000 + 2];
+static uint8_t isBlockStart[0x8000];
+static uint16_t worklist[0x8000];
+static int worklistCount;
+
+static void add_target(uint32_t addr) {
+    if (addr >= 0x8000 || isBlockStart[addr]) {
+        return;
+    }
+    isBlockStart[addr] = 1;
+    worklist[worklistCount++] = (uint16_t)addr;
+}
+
+static uint16_t op_imm(uint16_t addr) {
+    uint8_t opcode = rom[addr];
+    return (rom[addr + 1] | (rom[addr + 2] << 8)) & immMasks[opLength[opcode]];
+}
+
+/* Whether the op at addr can be compiled, it has to fit in ROM */
+static int op_usable(uint16_t addr) {
+    uint8_t opcode = rom[addr];
+    return opTable[opcode] && opLength[opcode] && addr + opLength[opcode] <= 0x8000;
+}
+
+/* Queues every block the op at the end of a block can go to */
+static void add_successors(uint8_t opcode, uint16_t imm, uint16_t nextPc) {
+    switch (opcode) {
+        case 0x18: /* JR e8 */
+            add_target((uint16_t)(nextPc + (int8_t)imm));
+            break;
+        case 0x20: case 0x28: case 0x30: case 0x38: /* JR cc,e8 */
+            add_target((uint16_t)(nextPc + (int8_t)imm));
+            add_target(nextPc);
+            break;
+        case 0xC3: /* JP a16 */
+            add_target(imm);
+            break;
+        case 0xC2: case 0xCA: case 0xD2: case 0xDA: /* JP cc,a16 */
+        case 0xC4: case 0xCC: case 0xD4: case 0xDC: case 0xCD: /* CALL */
+            add_target(imm);
+            add_target(nextPc);
+            break;
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF:
+        case 0xE7: case 0xEF: case 0xF7: case 0xFF: /* RST */
+            add_target(opcode & 0x38);
+            add_target(nextPc);
+            break;
+        case 0xC9: case 0xD9: case 0xE9: /* RET, RETI, JP HL */
+            break;
+        default: /* RET cc, STOP, HALT, DI, EI and blocks cut short */
+            add_target(nextPc);
+            break;
+    }
+}
+
+/* Follows one block from start, returns how many bytes of it compile */
+static int walk_block(uint16_t start) {
+    uint16_t addr = start;
+    int count = 0;
+    while (count < BLOCK_MAX_OPS && op_usable(addr)) {
+        uint8_t opcode = rom[addr];
+        uint16_t imm = op_imm(addr);
+        addr += opLength[opcode];
+        count++;
+        if (opcode_ends_block(opcode)) {
+            add_successors(opcode, imm, addr);
+            return addr - start;
+        }
+    }
+    if (count) {
+        /* Cut short, whatever follows runs next */
+        add_successors(0x00, 0, addr);
+    }
+    return addr - start;
+}
+
+static const char *generatedPrologue =
+    "#include <stdint.h>\n"
+    "\n"
+    "/* Must match aot.h and codepages.h */\n"
+    "#define AOT_ABI_VERSION %d\n"
+    "#define CODE_PAGE_SHIFT %d\n"
+    "typedef int (*op_handler)(uint16_t imm);\n"
+    "typedef int (*aot_block_fn)(int budget);\n"
+    "typedef struct { uint16_t pc; uint16_t bytes; aot_block_fn fn; } aot_entry;\n"
+    "typedef struct {\n"
+    "    const op_handler *ops;\n"
+    "    uint16_t *af, *bc, *de, *hl, *pc;\n"
+    "    uint8_t *const *ram;\n"
+    "    const uint16_t *slowBase, *slowReads, *slowWrites;\n"
+    "    const uint8_t *pageHasCode;\n"
+    "    uint8_t (*read)(uint16_t addr);\n"
+    "    void (*write)(uint16_t addr, uint8_t value);\n"
+    "    const volatile int *stop;\n"
+    "} aot_imports;\n"
+    "\n"
+    "static aot_imports gb;\n"
+    "\n"
+    "void aotBind(const aot_imports *imports) {\n"
+    "    gb = *imports;\n"
+    "}\n"
+    "\n"
+    "#define FZ 0x80\n"
+    "#define FN 0x40\n"
+    "#define FH 0x20\n"
+    "#define FC 0x10\n"
+    "\n"
+    "/* The guest registers live in locals while a block runs */\n"
+    "#define REGS uint8_t a, f, b, c, d, e, h, l\n"
+    "#define REGS_IN \\\n"
+    "    a = *gb.af >> 8; f = (uint8_t)*gb.af; b = *gb.bc >> 8; c = (uint8_t)*gb.bc; \\\n"
+    "    d = *gb.de >> 8; e = (uint8_t)*gb.de; h = *gb.hl >> 8; l = (uint8_t)*gb.hl;\n"
+    "#define REGS_OUT \\\n"
+    "    *gb.af = (uint16_t)(a << 8 | f); *gb.bc = (uint16_t)(b << 8 | c); \\\n"
+    "    *gb.de = (uint16_t)(d << 8 | e); *gb.hl = (uint16_t)(h << 8 | l);\n"
+    "#define BC ((uint16_t)(b << 8 | c))\n"
+    "#define DE ((uint16_t)(d << 8 | e))\n"
+    "#define HL ((uint16_t)(h << 8 | l))\n"
+    "#define SET_BC(v) { uint16_t v_ = (v); b = v_ >> 8; c = (uint8_t)v_; }\n"
+    "#define SET_DE(v) { uint16_t v_ = (v); d = v_ >> 8; e = (uint8_t)v_; }\n"
+    "#define SET_HL(v) { uint16_t v_ = (v); h = v_ >> 8; l = (uint8_t)v_; }\n"
+    "\n"
+    "/* Leaves with pc past the last op that ran */\n"
+    "#define EXIT(next) { REGS_OUT *gb.pc = (next); return cycles; }\n"
+    "/* Stops where the cached interpreter would */\n"
+    "#define CHECK(next) if (cycles >= budget) EXIT(next)\n"
+    "/*\n"
+    " * A branch back to the block's own start. Nothing outside the CPU moves\n"
+    " * before the budget runs out unless the loop went to the bus, so until\n"
+    " * then it goes round again without leaving the block.\n"
+    " */\n"
+    "#define LOOP(next) { if (!io && cycles < budget) goto top; EXIT(next) }\n"
+    "\n"
+    "/* read_byte(), io is set when it had to ask the bus */\n"
+    "static inline uint8_t read_at(uint16_t addr, int *io) {\n"
+    "    if ((uint16_t)(addr - *gb.slowBase) < *gb.slowReads) {\n"
+    "        *io = 1;\n"
+    "        return gb.read(addr);\n"
+    "    }\n"
+    "    return (*gb.ram)[addr];\n"
+    "}\n"
+    "#define READ(addr) read_at((uint16_t)(addr), &io)\n"
+    "\n"
+    "/* write_byte(), only taken for I/O and pages with code. Always last in an op */\n"
+    "#define WRITE(addr, value, next) { \\\n"
+    "    uint16_t w_addr = (addr); uint8_t w_value = (value); \\\n"
+    "    if ((uint16_t)(w_addr - *gb.slowBase) < *gb.slowWrites || gb.pageHasCode[w_addr >> CODE_PAGE_SHIFT]) { \\\n"
+    "        io = 1; \\\n"
+    "        gb.write(w_addr, w_value); \\\n"
+    "        if (*gb.stop) EXIT(next) \\\n"
+    "    } else { \\\n"
+    "        (*gb.ram)[w_addr] = w_value; \\\n"
+    "    } \\\n"
+    "}\n"
+    "\n"
+    "/* An op with no translation, run by its handler with the registers written back */\n"
+    "#define HANDLER(next, opcode, imm) \\\n"
+    "    REGS_OUT *gb.pc = (next); \\\n"
+    "    cycles += gb.ops[opcode](imm); \\\n"
+    "    REGS_IN \\\n"
+    "    if (*gb.stop) return cycles;\n"
+    "#define LAST_HANDLER(next, opcode, imm) \\\n"
+    "    REGS_OUT *gb.pc = (next); \\\n"
+    "    return cycles + gb.ops[opcode](imm);\n"
+    "\n"
+    "/* The ALU kernels of alu.h on the locals, the low nibble of F is kept */\n"
+    "#define INC8(r) { r++; f = (f & (FC | 0x0F)) | (r ? 0 : FZ) | ((r & 0x0F) ? 0 : FH); }\n"
+    "#define DEC8(r) { r--; f = (f & (FC | 0x0F)) | FN | (r ? 0 : FZ) | ((r & 0x0F) == 0x0F ? FH : 0); }\n"
+    "#define ADD8(v, carry) { \\\n"
+    "    unsigned v_ = (v), c_ = (carry), r_ = a + v_ + c_; \\\n"
+    "    f = (f & 0x0F) | ((r_ & 0xFF) ? 0 : FZ) | ((a & 0x0F) + (v_ & 0x0F) + c_ > 0x0F ? FH : 0) | (r_ > 0xFF ? FC : 0); \\\n"
+    "    a = (uint8_t)r_; \\\n"
+    "}\n"
+    "#define SUB8(v, carry, keep) { \\\n"
+    "    unsigned v_ = (v), c_ = (carry), r_ = a - v_ - c_; \\\n"
+    "    f = (f & 0x0F) | FN | ((r_ & 0xFF) ? 0 : FZ) | ((a & 0x0F) < (v_ & 0x0F) + c_ ? FH : 0) | (r_ > 0xFF ? FC : 0); \\\n"
+    "    if (keep) a = (uint8_t)r_; \\\n"
+    "}\n"
+    "#define AND8(v) { a &= (v); f = (f & 0x0F) | (a ? 0 : FZ) | FH; }\n"
+    "#define XOR8(v) { a ^= (v); f = (f & 0x0F) | (a ? 0 : FZ); }\n"
+    "#define OR8(v) { a |= (v); f = (f & 0x0F) | (a ? 0 : FZ); }\n"
+    "#define CARRY ((f & FC) != 0)\n"
+    "#define SHIFT_FLAGS(r, carry) f = (f & 0x0F) | (r ? 0 : FZ) | ((carry) ? FC : 0)\n"
+    "\n";
+
+/* B, C, D, E, H, L, [HL], A as an operand to read */
+static const char *regNames[8] = { "b", "c", "d", "e", "h", "l", "READ(HL)", "a" };
+/* BC, DE, HL by bits 4-5 of the opcode */
+static const char *pairNames[3] = { "BC", "DE", "HL" };
+
+/* CB opcodes on a register, [HL] is left to the handler */
+static int emit_cb(FILE *out, uint8_t cb) {
+    int reg = cb & 7;
+    int bit = (cb >> 3) & 7;
+    if (reg == 6) {
+        return 0;
+    }
+    const char *r = regNames[reg];
+    fprintf(out, "    cycles += %d;\n", cbOpInfo[cb].cycles);
+    switch (cb >> 6) {
+        case 0: {
+            static const char *shifts[8] = {
+                "{ uint8_t o_ = %1$s; %1$s = (uint8_t)(o_ << 1 | o_ >> 7); SHIFT_FLAGS(%1$s, o_ & 0x80); }",
+                "{ uint8_t o_ = %1$s; %1$s = (uint8_t)(o_ >> 1 | o_ << 7); SHIFT_FLAGS(%1$s, o_ & 0x01); }",
+                "{ uint8_t o_ = %1$s; %1$s = (uint8_t)(o_ << 1 | CARRY); SHIFT_FLAGS(%1$s, o_ & 0x80); }",
+                "{ uint8_t o_ = %1$s; %1$s = (uint8_t)(o_ >> 1 | CARRY << 7); SHIFT_FLAGS(%1$s, o_ & 0x01); }",
+                "{ uint8_t o_ = %1$s; %1$s = (uint8_t)(o_ << 1); SHIFT_FLAGS(%1$s, o_ & 0x80); }",
+                "{ uint8_t o_ = %1$s; %1$s = (uint8_t)(o_ >> 1 | (o_ & 0x80)); SHIFT_FLAGS(%1$s, o_ & 0x01); }",
+                "{ %1$s = (uint8_t)(%1$s << 4 | %1$s >> 4); SHIFT_FLAGS(%1$s, 0); }",
+                "{ uint8_t o_ = %1$s; %1$s = o_ >> 1; SHIFT_FLAGS(%1$s, o_ & 0x01); }",
+            };
+            fprintf(out, "    ");
+            fprintf(out, shifts[bit], r);
+            fprintf(out, "\n");
+            break;
+        }
+        case 1: /* BIT */
+            fprintf(out, "    f = (f & (FC | 0x0F)) | FH | ((%s & 0x%02x) ? 0 : FZ);\n", r, 1 << bit);
+            break;
+        case 2: /* RES */
+            fprintf(out, "    %s &= 0x%02x;\n", r, (uint8_t)~(1 << bit));
+            break;
+        default: /* SET */
+            fprintf(out, "    %s |= 0x%02x;\n", r, 1 << bit);
+            break;
+    }
+    return 1;
+}
+
+/*
+ * Straight-line op as C on the locals, 0 if it has none and the handler
+ * has to run it. Same set as the JIT plus whatever was as easy to write
+ * down here. Stores come last so a store over code leaves nothing half done.
+ */
+static int emit_op(FILE *out, uint8_t opcode, uint16_t imm, uint16_t next) {
+    int cycles = opInfo[opcode].cycles;
+    const char *pair = opcode < 0x30 ? pairNames[opcode >> 4] : NULL;
+    char body[160];
+    /* ALU ops leave their operand here, a register, READ(HL) or n8 */
+    char operand[16];
+    body[0] = '\0';
+    switch (opcode) {
+        case 0x00:
+            break;
+        case 0x01: case 0x11: case 0x21:
+            snprintf(body, sizeof(body), "SET_%s(0x%04x);", pair, imm);
+            break;
+        case 0x03: case 0x13: case 0x23: case 0x0B: case 0x1B: case 0x2B:
+            snprintf(body, sizeof(body), "SET_%s(%s %c 1);", pair, pair, (opcode & 0x08) ? '-' : '+');
+            break;
+        case 0x09: case 0x19: case 0x29:
+            snprintf(body, sizeof(body), "{ unsigned x_ = HL, y_ = %s; f = (f & (FZ | 0x0F)) | ((x_ & 0x0FFF) + (y_ & 0x0FFF) > 0x0FFF ? FH : 0) | (x_ + y_ > 0xFFFF ? FC : 0); SET_HL(x_ + y_); }", pair);
+            break;
+        case 0x02: case 0x12:
+            snprintf(body, sizeof(body), "WRITE(%s, a, 0x%04x)", pair, next);
+            break;
+        case 0x0A: case 0x1A:
+            snprintf(body, sizeof(body), "a = READ(%s);", pair);
+            break;
+        case 0x22: case 0x32:
+            snprintf(body, sizeof(body), "{ uint16_t at_ = HL; SET_HL(at_ %c 1); WRITE(at_, a, 0x%04x) }", opcode == 0x22 ? '+' : '-', next);
+            break;
+        case 0x2A: case 0x3A:
+            snprintf(body, sizeof(body), "a = READ(HL); SET_HL(HL %c 1);", opcode == 0x2A ? '+' : '-');
+            break;
+        case 0x34: case 0x35:
+            snprintf(body, sizeof(body), "{ uint8_t v_ = READ(HL); %s(v_); WRITE(HL, v_, 0x%04x) }", opcode == 0x34 ? "INC8" : "DEC8", next);
+            break;
+        case 0x36:
+            snprintf(body, sizeof(body), "WRITE(HL, 0x%02x, 0x%04x)", imm & 0xFF, next);
+            break;
+        case 0x07:
+            snprintf(body, sizeof(body), "f = (f & 0x0F) | (a & 0x80 ? FC : 0); a = (uint8_t)(a << 1 | a >> 7);");
+            break;
+        case 0x0F:
+            snprintf(body, sizeof(body), "f = (f & 0x0F) | (a & 0x01 ? FC : 0); a = (uint8_t)(a >> 1 | a << 7);");
+            break;
+        case 0x17:
+            snprintf(body, sizeof(body), "{ uint8_t o_ = a; a = (uint8_t)(o_ << 1 | CARRY); f = (f & 0x0F) | (o_ & 0x80 ? FC : 0); }");
+            break;
+        case 0x1F:
+            snprintf(body, sizeof(body), "{ uint8_t o_ = a; a = (uint8_t)(o_ >> 1 | CARRY << 7); f = (f & 0x0F) | (o_ & 0x01 ? FC : 0); }");
+            break;
+        case 0x2F:
+            snprintf(body, sizeof(body), "a = ~a; f |= FN | FH;");
+            break;
+        case 0x37:
+            snprintf(body, sizeof(body), "f = (f & ~(FN | FH)) | FC;");
+            break;
+        case 0x3F:
+            snprintf(body, sizeof(body), "f = (f & ~(FN | FH)) ^ FC;");
+            break;
+        case 0xE0: case 0xEA:
+            snprintf(body, sizeof(body), "WRITE(0x%04x, a, 0x%04x)", opcode == 0xE0 ? 0xFF00 | (imm & 0xFF) : imm, next);
+            break;
+        case 0xE2:
+            snprintf(body, sizeof(body), "WRITE(0xFF00 | c, a, 0x%04x)", next);
+            break;
+        case 0xF0: case 0xFA:
+            snprintf(body, sizeof(body), "a = READ(0x%04x);", opcode == 0xF0 ? 0xFF00 | (imm & 0xFF) : imm);
+            break;
+        case 0xF2:
+            snprintf(body, sizeof(body), "a = READ(0xFF00 | c);");
+            break;
+        case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+            /* Same as the register forms below with n8 as the operand */
+            opcode = 0x80 | (opcode & 0x38) | 0x07;
+            snprintf(operand, sizeof(operand), "0x%02x", imm & 0xFF);
+            break;
+        case 0xCB:
+            return emit_cb(out, imm & 0xFF);
+        case 0x76: /* HALT */
+            return 0;
+        default:
+            if (opcode < 0x40) {
+                int reg = (opcode >> 3) & 7;
+                if (reg == 6) {
+                    return 0;
+                }
+                switch (opcode & 7) {
+                    case 4:
+                        snprintf(body, sizeof(body), "INC8(%s);", regNames[reg]);
+                        break;
+                    case 5:
+                        snprintf(body, sizeof(body), "DEC8(%s);", regNames[reg]);
+                        break;
+                    case 6:
+                        snprintf(body, sizeof(body), "%s = 0x%02x;", regNames[reg], imm & 0xFF);
+                        break;
+                    default:
+                        return 0;
+                }
+            } else if (opcode < 0x80) {
+                int dst = (opcode >> 3) & 7;
+                if (dst == 6) {
+                    snprintf(body, sizeof(body), "WRITE(HL, %s, 0x%04x)", regNames[opcode & 7], next);
+                } else if (dst != (opcode & 7)) {
+                    snprintf(body, sizeof(body), "%s = %s;", regNames[dst], regNames[opcode & 7]);
+                }
+            } else if (opcode < 0xC0) {
+                snprintf(operand, sizeof(operand), "%s", regNames[opcode & 7]);
+            } else {
+                return 0;
+            }
+            break;
+    }
+    if (opcode >= 0x80 && opcode < 0xC0) {
+        static const char *alu[8] = {
+            "ADD8(%s, 0);", "ADD8(%s, CARRY);", "SUB8(%s, 0, 1);", "SUB8(%s, CARRY, 1);",
+            "AND8(%s);", "XOR8(%s);", "OR8(%s);", "SUB8(%s, 0, 0);",
+        };
+        snprintf(body, sizeof(body), alu[(opcode >> 3) & 7], operand);
+    }
+    fprintf(out, "    cycles += %d;\n", cycles);
+    if (body[0]) {
+        fprintf(out, "    %s\n", body);
+    }
+    return 1;
+}
+
+/* Where a JR or JP ends up when taken */
+static uint16_t branch_target(uint8_t opcode, uint16_t imm, uint16_t next) {
+    return (opcode & 0xC0) ? imm : (uint16_t)(next + (int8_t)imm);
+}
+
+/*
+ * JR, JP and their conditional forms as the last op, 0 to use the handler.
+ * A taken branch to start loops in place when the block has a top label.
+ */
+static int emit_branch(FILE *out, uint8_t opcode, uint16_t imm, uint16_t next, uint16_t start, int hasTop) {
+    const opcode_info *info = &opInfo[opcode];
+    uint16_t target = branch_target(opcode, imm, next);
+    const char *leave = hasTop && target == start ? "LOOP" : "EXIT";
+    const char *condition;
+    switch (opcode) {
+        case 0x18: case 0xC3:
+            fprintf(out, "    cycles += %d;\n    %s(0x%04x)\n", info->cycles, leave, target);
+            return 1;
+        case 0xE9: /* JP HL */
+            fprintf(out, "    cycles += %d;\n    EXIT(HL)\n", info->cycles);
+            return 1;
+        case 0x20: case 0xC2: condition = "!(f & FZ)"; break;
+        case 0x28: case 0xCA: condition = "f & FZ"; break;
+        case 0x30: case 0xD2: condition = "!(f & FC)"; break;
+        case 0x38: case 0xDA: condition = "f & FC"; break;
+        default:
+            return 0;
+    }
+    fprintf(out, "    if (%s) {\n        cycles += %d;\n        %s(0x%04x)\n    }\n", condition, info->branchCycles, leave, target);
+    fprintf(out, "    cycles += %d;\n    EXIT(0x%04x)\n", info->cycles, next);
+    return 1;
+}
+
+/*
+ * Whether the block is a loop on itself that can go round without leaving:
+ * it ends in a JR or JP back to start and no op in it needs its handler.
+ * The ops are written out to scratch to find that out.
+ */
+static int block_loops(FILE *scratch, uint16_t start, uint16_t end) {
+    uint16_t addr = start;
+    while (addr < end) {
+        uint8_t opcode = rom[addr];
+        uint16_t imm = op_imm(addr);
+        addr += opLength[opcode];
+        if (addr == end) {
+            return emit_branch(scratch, opcode, imm, addr, start, 0) && branch_target(opcode, imm, addr) == start && opcode != 0xE9;
+        }
+        if (!emit_op(scratch, opcode, imm, addr)) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static int write_source(FILE *out, const char *romPath, uint64_t romHash, int *blockBytes, int *translated, int *handled) {
+    FILE *scratch = tmpfile();
+    if (!scratch) {
+        fprintf(stderr, "honeybun-aot: unable to create a scratch file\n");
+        return -1;
+    }
+    fprintf(out, "/* Generated by honeybun-aot from %s, do not edit */\n\n", romPath);
+    fprintf(out, generatedPrologue, AOT_ABI_VERSION, CODE_PAGE_SHIFT);
+
+    int blockCount = 0;
+    for (uint32_t start = 0; start < 0x8000; start++) {
+        if (!isBlockStart[start] || !blockBytes[start]) {
+            continue;
+        }
+        fprintf(out, "static int block_%04x(int budget) {\n", start);
+        uint16_t addr = (uint16_t)start;
+        uint16_t end = (uint16_t)(start + blockBytes[start]);
+        int hasTop = block_loops(scratch, addr, end);
+        rewind(scratch);
+        fprintf(out, "    int cycles = 0, io = 0;\n    REGS;\n    REGS_IN\n");
+        if (hasTop) {
+            fprintf(out, "top:\n");
+        }
+        while (addr < end) {
+            uint8_t opcode = rom[addr];
+            uint16_t imm = op_imm(addr);
+            char text[32];
+            disassemble(addr, &rom[addr], text, sizeof(text));
+            addr += opLength[opcode];
+            int last = (addr == end);
+            fprintf(out, "    /* %04x: %s */\n", addr - opLength[opcode], text);
+            if (last && emit_branch(out, opcode, imm, addr, (uint16_t)start, hasTop)) {
+                (*translated)++;
+            } else if (emit_op(out, opcode, imm, addr)) {
+                fprintf(out, last ? "    EXIT(0x%04x)\n" : "    CHECK(0x%04x)\n", addr);
+                (*translated)++;
+            } else {
+                fprintf(out, last ? "    LAST_HANDLER(0x%04x, 0x%02x, 0x%04x)\n" : "    HANDLER(0x%04x, 0x%02x, 0x%04x)\n    CHECK(0x%04x)\n", addr, opcode, imm, addr);
+                (*handled)++;
+            }
+        }
+        fprintf(out, "}\n\n");
+        blockCount++;
+    }
+
+    fprintf(out, "const uint32_t aotAbiVersion = AOT_ABI_VERSION;\n");
+    fprintf(out, "const uint64_t aotRomHash = 0x%016llxULL;\n", (unsigned long long)romHash);
+    fprintf(out, "const uint32_t aotBlockCount = %d;\n", blockCount);
+    fprintf(out, "const aot_entry aotBlocks[] = {\n");
+    for (uint32_t start = 0; start < 0x8000; start++) {
+        if (isBlockStart[start] && blockBytes[start]) {
+            fprintf(out, "    { 0x%04x, %d, block_%04x },\n", start, blockBytes[start], start);
+        }
+    }
+    fprintf(out, "    { 0, 0, 0 }\n};\n");
+    fclose(scratch);
+    return blockCount;
+}
+
+static void show_help(void) {
+    printf("Usage: honeybun-aot <options>\n\n");
+    printf(" -i: (required) path to the ROM\n");
+    printf(" -o: (required) shared object to write, load it with honeybun -A\n");
+    printf(" -k: (optional) keep the generated C at this path\n");
+    printf(" -C: (optional) C compiler to build with, defaults to $CC or cc\n");
+    printf(" -h: show usage\n");
+}
+
+int main(int argc, char **argv) {
+    const char *romPath = NULL;
+    const char *outPath = NULL;
+    const char *keepPath = NULL;
+    const char *compiler = getenv("CC");
+    int opt;
+    while ((opt = getopt(argc, argv, OPTSTR)) != EOF) {
+        if (opt == 'i') {
+            romPath = optarg;
+        } else if (opt == 'o') {
+            outPath = optarg;
+        } else if (opt == 'k') {
+            keepPath = optarg;
+        } else if (opt == 'C') {
+            compiler = optarg;
+        } else {
+            show_help();
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (!romPath || !outPath) {
+        show_help();
+        return 1;
+    }
+    if (!compiler || !*compiler) {
+        compiler = "cc";
+    }
+
+    /* The whole file is hashed so the emulator can tell it is the same ROM */
+    FILE *fp = fopen(romPath, "rb");
+    if (!fp) {
+        fprintf(stderr, "unable to open %s\n", romPath);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    size_t romSize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t *file = malloc(romSize ? romSize : 1);
+    if (!file || fread(file, 1, romSize, fp) != romSize) {
+        fprintf(stderr, "unable to read %s\n", romPath);
+        fclose(fp);
+        free(file);
+        return 1;
+    }
+    fclose(fp);
+    uint64_t romHash = rom_hash(file, romSize);
+    memcpy(rom, file, romSize < 0x8000 ? romSize : 0x8000);
+    free(file);
+
+    /* Walk everything reachable */
+    static int blockBytes[0x8000];
+    for (size_t i = 0; i < sizeof(entryPoints) / sizeof(entryPoints[0]); i++) {
+        add_target(entryPoints[i]);
+    }
+    int totalBytes = 0;
+    while (worklistCount) {
+        uint16_t start = worklist[--worklistCount];
+        blockBytes[start] = walk_block(start);
+        totalBytes += blockBytes[start];
+    }
+
+    char defaultPath[4096];
+    const char *sourcePath = keepPath;
+    if (!sourcePath) {
+        snprintf(defaultPath, sizeof(defaultPath), "%s.c", outPath);
+        sourcePath = defaultPath;
+    }
+    FILE *out = fopen(sourcePath, "w");
+    if (!out) {
+        fprintf(stderr, "unable to write %s\n", sourcePath);
+        return 1;
+    }
+    int translated = 0, handled = 0;
+    int blockCount = write_source(out, romPath, romHash, blockBytes, &translated, &handled);
+    fclose(out);
+    if (blockCount < 0) {
+        return 1;
+    }
+    printf("honeybun-aot: %d blocks, %d bytes of code found, %d ops written out, %d left to their handlers\n", blockCount, totalBytes, translated, handled);
+
+    char command[8192];
+    snprintf(command, sizeof(command), "%s -O2 -shared -fPIC -o '%s' '%s'", compiler, outPath, sourcePath);
+    int status = system(command);
+    if (!keepPath) {
+        remove(sourcePath);
+    }
+    if (status != 0) {
+        fprintf(stderr, "honeybun-aot: %s failed\n", compiler);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef AOT_H
+#define AOT_H
+
+#include <stdint.h>
+#include "emu.h"
+
+/*
+ * Interface between the emulator and a shared object made by honeybun-aot.
+ * The generated C spells these out again, bump the version when they change.
+ */
+#define AOT_ABI_VERSION 2
+
+/* Runs one compiled block, returns the cycles it took */
+typedef int (*aot_block_fn)(int budget);
+
+typedef struct {
+    uint16_t pc;
+    uint16_t bytes;
+    aot_block_fn fn;
+} aot_entry;
+
+/* Handed to aotBind() so the object never has to resolve emulator symbols */
+typedef struct {
+    const op_handler *ops;
+    uint16_t *af, *bc, *de, *hl, *pc;
+    uint8_t *const *ram;
+    /* read_byte() and write_byte()'s slow path tests */
+    const uint16_t *slowBase, *slowReads, *slowWrites;
+    const uint8_t *pageHasCode;
+    uint8_t (*read)(uint16_t addr);
+    void (*write)(uint16_t addr, uint8_t value);
+    const volatile int *stop;
+} aot_imports;
+
+int aot_load(const char *path, uint64_t romHash);
+int execute_aot(int budget);
+void aot_report(void);
+
+#endif /* AOT_H */
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <dlfcn.h>
+#include "aot.h"
+#include "codepages.h"
+
+/*
+ * Runs blocks compiled ahead of time by honeybun-aot. Only code the tool
+ * found by walking the ROM is in there, anything else (code in RAM, jumps
+ * through HL it could not follow) goes to the interpreter. Once a store
+ * bumps the generation of a page a block was compiled from, that block
+ * is stale for good and the interpreter decodes the new bytes instead.
+ */
+
+static const aot_entry *aotMap[0x8000];
+/* pageGeneration when the object was loaded, what the blocks were made from */
+static uint32_t aotGenerations[0x80];
+static uint8_t aotPages[0x80];
+static int aotBlocks;
+static unsigned long aotRuns;
+static unsigned long aotMisses;
+
+int aot_load(const char *path, uint64_t romHash) {
+    void *lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!lib) {
+        printf("aot: %s\n", dlerror());
+        return -1;
+    }
+    const uint32_t *abiVersion = dlsym(lib, "aotAbiVersion");
+    const uint64_t *libRomHash = dlsym(lib, "aotRomHash");
+    const uint32_t *blockCount = dlsym(lib, "aotBlockCount");
+    const aot_entry *blocks = dlsym(lib, "aotBlocks");
+    void (*bind)(const aot_imports *) = (void (*)(const aot_imports *))dlsym(lib, "aotBind");
+    if (!abiVersion || !libRomHash || !blockCount || !blocks || !bind) {
+        printf("aot: %s was not made by honeybun-aot\n", path);
+        dlclose(lib);
+        return -1;
+    }
+    if (*abiVersion != AOT_ABI_VERSION) {
+        printf("aot: %s is ABI version %u, expected %u\n", path, *abiVersion, AOT_ABI_VERSION);
+        dlclose(lib);
+        return -1;
+    }
+    if (*libRomHash != romHash) {
+        printf("aot: %s was compiled from a different ROM\n", path);
+        dlclose(lib);
+        return -1;
+    }
+
+    static aot_imports imports;
+    imports.ops = opTable;
+    imports.af = &af;
+    imports.bc = &bc;
+    imports.de = &de;
+    imports.hl = &hl;
+    imports.pc = &pc;
+    imports.ram = &emuRAM;
+    imports.slowBase = &busSlowBase;
+    imports.slowReads = &busSlowReads;
+    imports.slowWrites = &busSlowWrites;
+    imports.pageHasCode = pageHasCode;
+    imports.read = bus_read;
+    imports.write = write_byte;
+    imports.stop = &codeWritten;
+    bind(&imports);
+
+    memset(aotMap, 0, sizeof(aotMap));
+    memset(aotPages, 0, sizeof(aotPages));
+    memcpy(aotGenerations, pageGeneration, sizeof(aotGenerations));
+    for (uint32_t i = 0; i < *blockCount; i++) {
+        const aot_entry *entry = &blocks[i];
+        if (entry->pc >= 0x8000 || !entry->bytes || entry->pc + entry->bytes > 0x8000) {
+            continue;
+        }
+        aotMap[entry->pc] = entry;
+        code_pages_mark(entry->pc, entry->bytes);
+        for (int page = entry->pc >> CODE_PAGE_SHIFT; page <= (entry->pc + entry->bytes - 1) >> CODE_PAGE_SHIFT; page++) {
+            aotPages[page] = 1;
+        }
+    }
+    aotBlocks = *blockCount;
+    /* Never closed, the blocks are used until the emulator exits */
+    return 0;
+}
+
+static inline int aot_current(const aot_entry *entry) {
+    unsigned first = entry->pc >> CODE_PAGE_SHIFT;
+    unsigned last = (entry->pc + entry->bytes - 1) >> CODE_PAGE_SHIFT;
+    return pageGeneration[first] == aotGenerations[first] && pageGeneration[last] == aotGenerations[last];
+}
+
+/* -1 when there is no compiled block at pc */
+int execute_aot(int budget) {
+    if (!cycle) {
+        return 0;
+    }
+    const aot_entry *entry = pc < 0x8000 ? aotMap[pc] : NULL;
+    if (!entry || !aot_current(entry)) {
+        aotMisses++;
+        return -1;
+    }
+    /* Set by a store over code, the block stops after that op */
+    codeWritten = 0;
+    aotRuns++;
+    return entry->fn(budget);
+}
+
+void aot_report(void) {
+    int stale = 0;
+    for (int page = 0; page < 0x80; page++) {
+        stale += aotPages[page] && pageGeneration[page] != aotGenerations[page];
+    }
+    printf("aot: %d blocks loaded, %lu runs, %lu left to the interpreter, %d pages stale\n", aotBlocks, aotRuns, aotMisses, stale);
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "blockcache.h"
+#include "jit.h"
+#include "opcodes.h"
+
+/*
+ * Cached interpreter. Instead of fetching and decoding every instruction
+ * from emuRAM, straight-line code is decoded once into an array of
+ * micro-ops and run from there. The handlers are the same ones
+ * execute_instruction() uses, so both tiers behave the same per
+ * instruction.
+ */
+
+static decoded_block *blockMap[0x10000]; /* keyed by start pc */
+static decoded_block blockArena[BLOCK_ARENA_BLOCKS];
+static micro_op opArena[BLOCK_ARENA_OPS];
+static int blocksUsed = 0;
+static int opsUsed = 0;
+
+/*
+ * Set to 1 to count which opcode pairs run back to back and print the
+ * most common ones at exit. That is where superTable's entries came
+ * from; fusion is off while profiling so every pair gets seen.
+ */
+#define PROFILE_OPCODE_PAIRS 0
+
+#if PROFILE_OPCODE_PAIRS
+static uint64_t pairCounts[0x100][0x100];
+#endif
+
+/* Opcodes that can change pc or need interrupts looked at after them */
+int opcode_ends_block(uint8_t opcode) {
+    switch (opcode) {
+        case 0x10: /* STOP */
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: /* JR */
+        case 0x76: /* HALT */
+        case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9: /* RET, RETI */
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9: /* JP */
+        case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC: /* CALL */
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF: /* RST */
+        case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+        case 0xF3: case 0xFB: /* DI, EI */
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Blocks never span more than two pages, BLOCK_MAX_BYTES is under a page */
+static inline unsigned last_page(const decoded_block *block) {
+    return ((unsigned)block->startPc + block->bytes - 1) >> CODE_PAGE_SHIFT;
+}
+
+/* Whether the bytes under the block are still the ones it was decoded from */
+static inline int block_current(const decoded_block *block) {
+    return block->generations[0] == pageGeneration[block->startPc >> CODE_PAGE_SHIFT] && block->generations[1] == pageGeneration[last_page(block)];
+}
+
+void block_cache_flush(void) {
+    memset(blockMap, 0, sizeof(blockMap));
+    blocksUsed = 0;
+    opsUsed = 0;
+    codeWritten = 1;
+    jit_reset();
+}
+
+/* First superTable entry that matches the ops starting at opPc, if any */
+static const superinstruction *find_superinstruction(const micro_op *ops, int available, uint16_t opPc) {
+    for (int i = 0; i < superTableCount; i++) {
+        const superinstruction *super = &superTable[i];
+        if (super->count > available) {
+            continue;
+        }
+        int j = 0;
+        while (j < super->count && ops[j].opcode == super->opcodes[j]) {
+            j++;
+        }
+        if (j < super->count) {
+            continue;
+        }
+        const micro_op *last = &ops[super->count - 1];
+        if (super->loop && (uint16_t)(last->nextPc + (int8_t)last->imm) != opPc) {
+            continue;
+        }
+        return super;
+    }
+    return NULL;
+}
+
+static decoded_block *decode_block(uint16_t startPc) {
+    if (blocksUsed == BLOCK_ARENA_BLOCKS || opsUsed + BLOCK_MAX_MICRO_OPS > BLOCK_ARENA_OPS) {
+        /* Arena is full, start over rather than track free space */
+        block_cache_flush();
+    }
+    decoded_block *block = &blockArena[blocksUsed];
+    block->startPc = startPc;
+    block->bank = bank_for_pc(startPc);
+    block->ops = &opArena[opsUsed];
+    block->count = 0;
+    block->hits = 0;
+    block->jitTried = 0;
+    block->jitLeadCycles = 0;
+    block->native = NULL;
+
+    micro_op plain[BLOCK_MAX_OPS];
+    int plainCount = 0;
+    uint32_t addr = startPc;
+    while (plainCount < BLOCK_MAX_OPS) {
+        uint8_t opcode = emuRAM[addr];
+        uint8_t length = opLength[opcode];
+        if (!opTable[opcode] || addr + length > 0x10000) {
+            /* Leave it to execute_instruction() to report */
+            break;
+        }
+        micro_op *op = &plain[plainCount++];
+        memset(op, 0, sizeof(*op));
+        op->handler = opTable[opcode];
+        op->opcode = opcode;
+        op->length = length;
+        op->imm = length == 3 ? emuRAM[addr + 1] | (emuRAM[addr + 2] << 8) : length == 2 ? emuRAM[addr + 1] : 0;
+        addr += length;
+        op->nextPc = (uint16_t)addr;
+        if (opcode_ends_block(opcode)) {
+            break;
+        }
+    }
+    if (!plainCount) {
+        return NULL;
+    }
+
+    /* Copy the ops into the arena, putting superinstructions in front of runs that match one */
+    uint16_t opPc = startPc;
+    for (int i = 0; i < plainCount;) {
+        const superinstruction *match = PROFILE_OPCODE_PAIRS ? NULL : find_superinstruction(&plain[i], plainCount - i, opPc);
+        if (match) {
+            micro_op *fusedOp = &block->ops[block->count++];
+            memset(fusedOp, 0, sizeof(*fusedOp));
+            fusedOp->fused = match->fused;
+            fusedOp->opcode = plain[i].opcode;
+            fusedOp->nextPc = plain[i + match->count - 1].nextPc;
+            fusedOp->length = (uint8_t)(fusedOp->nextPc - opPc);
+            fusedOp->fusedOps = match->count;
+            fusedOp->leadCycles = match->leadCycles;
+        }
+        int parts = match ? match->count : 1;
+        for (int j = 0; j < parts; j++) {
+            block->ops[block->count++] = plain[i + j];
+        }
+        i += parts;
+        opPc = plain[i - 1].nextPc;
+    }
+
+    block->bytes = (uint16_t)(addr - startPc);
+    blocksUsed++;
+    opsUsed += block->count;
+    block->generations[0] = pageGeneration[startPc >> CODE_PAGE_SHIFT];
+    block->generations[1] = pageGeneration[last_page(block)];
+    blockMap[startPc] = block;
+    code_pages_mark(startPc, block->bytes);
+    return block;
+}
+
+/*
+ * Runs the block at pc, returns the cycles it took. Stops early once
+ * budget cycles have gone by so frames end where the interpreter ends them.
+ */
+int execute_block(int budget) {
+    if (!cycle) {
+        return 0; /* Emulation is paused */
+    }
+
+    decoded_block *block = blockMap[pc];
+    if (!block || block->bank != bank_for_pc(pc) || !block_current(block)) {
+        block = decode_block(pc);
+        if (!block) {
+            return execute_instruction();
+        }
+    }
+
+    if (emuConfig.jit) {
+        if (!block->native && !block->jitTried && ++block->hits >= JIT_HOT_THRESHOLD) {
+            jit_compile(block);
+        }
+        /* Only if the interpreter would not hit the deadline before the last op */
+        if (block->native && block->jitLeadCycles < budget) {
+            codeWritten = 0;
+            return emuConfig.jitVerify ? jit_run_verified(block) : block->native();
+        }
+    }
+
+    codeWritten = 0;
+    int cycles = 0;
+    const micro_op *op = block->ops;
+    const micro_op *end = op + block->count;
+    while (op < end) {
+        if (op->fusedOps) {
+            if (cycles + op->leadCycles >= budget) {
+                /* The interpreter would stop part way through, run the parts instead */
+                op++;
+                continue;
+            }
+            pc = op->nextPc;
+            cycles += op->fused(op + 1, budget - cycles);
+            op += 1 + op->fusedOps;
+        } else {
+#if PROFILE_OPCODE_PAIRS
+            if (op > block->ops) {
+                pairCounts[op[-1].opcode][op->opcode]++;
+            }
+#endif
+            pc = op->nextPc;
+            cycles += op->handler(op->imm);
+            op++;
+        }
+        if (codeWritten) {
+            /* The block may have just rewritten itself, redecode from pc */
+            break;
+        }
+        if (cycles >= budget) {
+            break;
+        }
+    }
+    return cycles;
+}
+
+/* Prints the hottest opcode pairs when PROFILE_OPCODE_PAIRS is on */
+void block_cache_report(void) {
+#if PROFILE_OPCODE_PAIRS
+    for (int rank = 0; rank < 20; rank++) {
+        int bestFirst = 0, bestSecond = 0;
+        for (int first = 0; first < 0x100; first++) {
+            for (int second = 0; second < 0x100; second++) {
+                if (pairCounts[first][second] > pairCounts[bestFirst][bestSecond]) {
+                    bestFirst = first;
+                    bestSecond = second;
+                }
+            }
+        }
+        if (!pairCounts[bestFirst][bestSecond]) {
+            break;
+        }
+        printf("%02x %02x (%s; %s): %" PRIu64 "\n", bestFirst, bestSecond, opInfo[bestFirst].mnemonic, opInfo[bestSecond].mnemonic, pairCounts[bestFirst][bestSecond]);
+        pairCounts[bestFirst][bestSecond] = 0;
+    }
+#endif
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <stdint.h>
+#include "emu.h"
+#include "codepages.h"
+
+/* Longest straight-line run we decode in one go */
+#define BLOCK_MAX_OPS 64
+/* Room for the superinstructions on top, each one adds a micro-op */
+#define BLOCK_MAX_MICRO_OPS (BLOCK_MAX_OPS * 2)
+/* Worst case span of a block, every op three bytes long */
+#define BLOCK_MAX_BYTES (BLOCK_MAX_OPS * 3)
+
+#define BLOCK_ARENA_BLOCKS 0x4000
+#define BLOCK_ARENA_OPS (BLOCK_ARENA_BLOCKS * 16)
+
+typedef struct micro_op micro_op;
+
+/*
+ * Superinstruction handler. parts are the plain micro-ops it stands for,
+ * budget is how many cycles are left before the caller has to stop.
+ */
+typedef int (*fused_handler)(const micro_op *parts, int budget);
+
+/*
+ * One instruction with its fetch and decode already done, or a
+ * superinstruction. A superinstruction is followed in the block by the
+ * fusedOps plain micro-ops it replaces, so it can fall back to them.
+ */
+struct micro_op {
+    union {
+        op_handler handler;
+        fused_handler fused;
+    };
+    uint16_t imm;
+    uint16_t nextPc; /* pc as the handler expects it, past the instruction */
+    uint8_t opcode;
+    uint8_t length;
+    uint8_t fusedOps;
+    uint8_t leadCycles; /* cycles before the last part, fused ops only */
+};
+
+/* Opcode sequence the decoder replaces with one fused handler */
+typedef struct {
+    uint8_t count;
+    uint8_t opcodes[7];
+    uint8_t leadCycles;
+    uint8_t loop; /* the last part has to be a JR back to the first */
+    fused_handler fused;
+} superinstruction;
+
+extern const superinstruction superTable[];
+extern const int superTableCount;
+
+/*
+ * A basic block, decoded once. It runs up to and including the first
+ * instruction that can change pc (or EI/DI/HALT/STOP, so interrupts get
+ * a look in between blocks).
+ */
+typedef struct {
+    uint16_t startPc;
+    uint16_t bytes;
+    uint8_t bank;
+    uint8_t count; /* micro-ops, superinstructions included */
+    micro_op *ops;
+    /* pageGeneration of the first and last page it was decoded from */
+    uint32_t generations[2];
+
+    /* JIT tier, see jit.c */
+    uint16_t hits;
+    uint8_t jitTried;
+    uint16_t jitLeadCycles; /* most cycles the ops before the last can take */
+    int (*native)(void);
+} decoded_block;
+
+int execute_block(int budget);
+int opcode_ends_block(uint8_t opcode);
+void block_cache_flush(void);
+void block_cache_report(void);
+
+#endif /* BLOCKCACHE_H */
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "callstack.h"
+#include "symbols.h"
+#include "emu.h"
+#include "timer.h"
+
+#define CALLSTACK_MASK (CALLSTACK_SIZE - 1)
+/* Most a sample can hold: the outermost frame, every target and the pc */
+#define SAMPLE_MAX_FRAMES (CALLSTACK_SIZE + 2)
+/* Stands for the frames the ring lost in a sample */
+#define FRAME_LOST UINT32_MAX
+#define FRAME_NAME_SIZE 256
+
+call_stack callStack;
+
+/* Frames pushed at an sp below limit have been returned past */
+static void callstack_unwind(uint32_t limit) {
+    while (callStack.depth > callStack.lost && callStack.frames[(callStack.depth - 1) & CALLSTACK_MASK].sp < limit) {
+        callStack.depth--;
+    }
+    /* Still inside the lost frames until sp is back above the outermost */
+    if (callStack.depth == callStack.lost && (!callStack.lost || limit > callStack.lostSp)) {
+        callStack.depth = 0;
+        callStack.lost = 0;
+    }
+}
+
+void callstack_push(uint16_t site, uint16_t target) {
+    /* Anything at or below the new frame was left without a RET */
+    callstack_unwind((uint32_t)sp + 1);
+    if (callStack.depth - callStack.lost == CALLSTACK_SIZE) {
+        if (!callStack.lost) {
+            callStack.lostSp = callStack.frames[callStack.depth & CALLSTACK_MASK].sp;
+        }
+        callStack.lost++;
+    }
+    call_frame *frame = &callStack.frames[callStack.depth & CALLSTACK_MASK];
+    frame->site = site;
+    frame->target = target;
+    frame->sp = sp;
+    frame->siteBank = bank_for_pc(site);
+    frame->targetBank = bank_for_pc(target);
+    callStack.depth++;
+}
+
+void callstack_pop(void) {
+    callstack_unwind(sp);
+}
+
+/*
+ * Samples are kept per distinct stack, frames being bank << 16 | address:
+ * where the outermost call came from (the pc when there is none), every
+ * call's target, then the pc.
+ */
+typedef struct {
+    uint64_t hash;
+    uint64_t samples;
+    int count;
+    uint32_t *frames;
+} sample_stack;
+
+uint64_t sampleEventAt = SAMPLE_NEVER;
+static uint32_t sampleInterval;
+static sample_stack *stacks; /* open addressing on hash */
+static size_t stackSlots;
+static size_t stackCount;
+static uint64_t samplesDropped;
+
+static uint64_t hash_frames(const uint32_t *frames, int count) {
+    uint64_t hash = 0xCBF29CE484222325ULL; /* FNV-1a */
+    for (int i = 0; i < count; i++) {
+        hash = (hash ^ frames[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static sample_stack *find_stack(sample_stack *table, size_t slots, uint64_t hash, const uint32_t *frames, int count) {
+    for (size_t slot = hash & (slots - 1);; slot = (slot + 1) & (slots - 1)) {
+        sample_stack *stack = &table[slot];
+        if (!stack->frames) {
+            return stack;
+        }
+        if (stack->hash == hash && stack->count == count && !memcmp(stack->frames, frames, sizeof(uint32_t) * count)) {
+            return stack;
+        }
+    }
+}
+
+/* Doubles the table once it is three quarters full */
+static int grow_stacks(void) {
+    size_t slots = stackSlots ? stackSlots * 2 : 1024;
+    sample_stack *table = calloc(slots, sizeof(sample_stack));
+    if (!table) {
+        return -1;
+    }
+    for (size_t i = 0; i < stackSlots; i++) {
+        if (stacks[i].frames) {
+            *find_stack(table, slots, stacks[i].hash, stacks[i].frames, stacks[i].count) = stacks[i];
+        }
+    }
+    free(stacks);
+    stacks = table;
+    stackSlots = slots;
+    return 0;
+}
+
+static void add_sample(const uint32_t *frames, int count, uint64_t samples) {
+    if ((stackCount + 1) * 4 > stackSlots * 3 && grow_stacks() != 0) {
+        samplesDropped += samples;
+        return;
+    }
+    uint64_t hash = hash_frames(frames, count);
+    sample_stack *stack = find_stack(stacks, stackSlots, hash, frames, count);
+    if (!stack->frames) {
+        stack->frames = malloc(sizeof(uint32_t) * count);
+        if (!stack->frames) {
+            samplesDropped += samples;
+            return;
+        }
+        memcpy(stack->frames, frames, sizeof(uint32_t) * count);
+        stack->hash = hash;
+        stack->count = count;
+        stackCount++;
+    }
+    stack->samples += samples;
+}
+
+int callstack_sample_start(uint32_t interval) {
+    sampleInterval = interval ? interval : SAMPLE_DEFAULT_INTERVAL;
+    if (grow_stacks() != 0) {
+        printf("sample: unable to allocate the sample table\n");
+        return -1;
+    }
+    sampleEventAt = cycleCount + sampleInterval;
+    schedule_update();
+    return 0;
+}
+
+void callstack_sample_resync(void) {
+    if (sampleEventAt != SAMPLE_NEVER) {
+        sampleEventAt = cycleCount + sampleInterval;
+        schedule_update();
+    }
+}
+
+void callstack_sample_event(void) {
+    /* An instruction or an idle HALT can run past more than one */
+    uint64_t samples = (cycleCount - sampleEventAt) / sampleInterval + 1;
+    sampleEventAt += samples * sampleInterval;
+    schedule_update();
+    if (speculating) {
+        return;
+    }
+
+    uint32_t frames[SAMPLE_MAX_FRAMES];
+    int count = 0;
+    const call_frame *outermost = &callStack.frames[callStack.lost & CALLSTACK_MASK];
+    if (callStack.lost) {
+        frames[count++] = FRAME_LOST;
+    } else if (callStack.depth) {
+        frames[count++] = (uint32_t)outermost->siteBank << 16 | outermost->site;
+    } else {
+        frames[count++] = (uint32_t)bank_for_pc(pc) << 16 | pc;
+    }
+    for (uint32_t i = callStack.lost; i < callStack.depth; i++) {
+        const call_frame *frame = &callStack.frames[i & CALLSTACK_MASK];
+        frames[count++] = (uint32_t)frame->targetBank << 16 | frame->target;
+    }
+    frames[count++] = (uint32_t)bank_for_pc(pc) << 16 | pc;
+    add_sample(frames, count, samples);
+}
+
+/*
+ * "outer;inner;leaf" for a stack. With symbols every frame is the label
+ * it falls under and the pc is added when it has left the innermost
+ * call's routine. Without, only the call targets can be told apart.
+ */
+static void name_stack(const sample_stack *stack, char *out, size_t size) {
+    int named = symbols_loaded();
+    char name[FRAME_NAME_SIZE];
+    char last[FRAME_NAME_SIZE] = "";
+    size_t used = 0;
+    out[0] = '\0';
+    for (int i = 0; i < stack->count; i++) {
+        uint32_t frame = stack->frames[i];
+        int leaf = (i == stack->count - 1);
+        if (frame == FRAME_LOST) {
+            snprintf(name, sizeof(name), "[truncated]");
+        } else if (leaf && !named) {
+            break;
+        } else if (i == 0 && !named) {
+            snprintf(name, sizeof(name), "[root]");
+        } else {
+            symbols_name(frame >> 16, frame & 0xFFFF, name, sizeof(name));
+        }
+        if (leaf && !strcmp(name, last)) {
+            break;
+        }
+        int length = snprintf(out + used, size - used, "%s%s", used ? ";" : "", name);
+        if (length < 0 || (size_t)length >= size - used) {
+            break;
+        }
+        used += length;
+        memcpy(last, name, sizeof(name));
+    }
+}
+
+typedef struct {
+    char *text;
+    uint64_t samples;
+} folded_stack;
+
+static int compare_folded(const void *a, const void *b) {
+    return strcmp(((const folded_stack *)a)->text, ((const folded_stack *)b)->text);
+}
+
+static void free_samples(void) {
+    for (size_t i = 0; i < stackSlots; i++) {
+        free(stacks[i].frames);
+    }
+    free(stacks);
+    stacks = NULL;
+    stackSlots = 0;
+    stackCount = 0;
+    sampleEventAt = SAMPLE_NEVER;
+}
+
+int callstack_sample_write(const char *path) {
+    /* Stacks that only differ by address can name the same, merge them */
+    folded_stack *lines = malloc(sizeof(folded_stack) * (stackCount ? stackCount : 1));
+    if (!lines) {
+        printf("sample: out of memory writing %s\n", path);
+        free_samples();
+        return -1;
+    }
+    char text[SAMPLE_MAX_FRAMES * (FRAME_NAME_SIZE + 1)];
+    size_t lineCount = 0;
+    for (size_t i = 0; i < stackSlots; i++) {
+        if (!stacks[i].frames) {
+            continue;
+        }
+        name_stack(&stacks[i], text, sizeof(text));
+        lines[lineCount].text = strdup(text);
+        lines[lineCount].samples = stacks[i].samples;
+        if (lines[lineCount].text) {
+            lineCount++;
+        }
+    }
+    qsort(lines, lineCount, sizeof(folded_stack), compare_folded);
+
+    FILE *out = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (!out) {
+        printf("sample: unable to write %s\n", path);
+    }
+    uint64_t total = 0;
+    for (size_t i = 0; i < lineCount; i++) {
+        uint64_t samples = lines[i].samples;
+        while (i + 1 < lineCount && !strcmp(lines[i].text, lines[i + 1].text)) {
+            free(lines[i].text);
+            samples += lines[++i].samples;
+        }
+        if (out) {
+            /* Weighted in cycles so runs at different intervals compare */
+            fprintf(out, "%s %" PRIu64 "\n", lines[i].text, samples * sampleInterval);
+        }
+        total += samples;
+        free(lines[i].text);
+    }
+    free(lines);
+    if (out && out != stdout) {
+        fclose(out);
+    }
+    printf("sample: %" PRIu64 " samples every %u cycles", total, sampleInterval);
+    if (samplesDropped) {
+        printf(", %" PRIu64 " dropped", samplesDropped);
+    }
+    printf("\n");
+    free_samples();
+    return out ? 0 : -1;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef CALLSTACK_H
+#define CALLSTACK_H
+
+#include <stdint.h>
+
+#define CALLSTACK_SIZE 64 /* frames kept, a power of two */
+
+/* Not sampling */
+#define SAMPLE_NEVER UINT64_MAX
+/* Cycles between samples when none is given, about 68 a frame */
+#define SAMPLE_DEFAULT_INTERVAL 1024
+
+/*
+ * Shadow call stack. CALL, RST and interrupts push a frame once the
+ * return address is on the stack, RET and RETI drop it after popping.
+ * Frames are matched up by the sp they pushed at, so code that returns
+ * some other way or moves sp loses its frames at the next call or return
+ * above them instead of leaving the stack out of step for good. Past
+ * CALLSTACK_SIZE deep the outermost frames are overwritten.
+ */
+typedef struct {
+    uint16_t site; /* the CALL or RST, or the pc an interrupt came in at */
+    uint16_t target; /* where it went */
+    uint16_t sp; /* pointing at the return address it pushed */
+    uint8_t siteBank;
+    uint8_t targetBank;
+} call_frame;
+
+typedef struct {
+    call_frame frames[CALLSTACK_SIZE]; /* a ring, the innermost is at depth - 1 */
+    uint32_t depth; /* frames pushed and not yet dropped, lost ones too */
+    uint32_t lost; /* outermost frames the ring has overwritten */
+    uint16_t lostSp; /* the outermost lost frame's sp, gone once sp is back above it */
+    uint16_t pad;
+} call_stack;
+
+extern call_stack callStack;
+
+void callstack_push(uint16_t site, uint16_t target);
+void callstack_pop(void);
+
+/*
+ * Sampling profiler. Every interval cycles the scheduler stops and the
+ * call stack is counted, and at the end the counts are written as folded
+ * stacks, one "outer;inner;leaf cycles" line each, the input
+ * flamegraph.pl and speedscope take. Frames are named from an RGBDS .sym
+ * file when one was loaded (see symbols.h), by address otherwise.
+ */
+extern uint64_t sampleEventAt; /* in cycleCount, SAMPLE_NEVER when not sampling */
+
+int callstack_sample_start(uint32_t interval);
+/* Run by the scheduler once cycleCount reaches sampleEventAt */
+void callstack_sample_event(void);
+/* cycleCount jumped, after a state was loaded */
+void callstack_sample_resync(void);
+/* "-" writes to stdout, the samples are freed either way */
+int callstack_sample_write(const char *path);
+
+#endif /* CALLSTACK_H */
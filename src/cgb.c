@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#include <string.h>
+#include "cgb.h"
+#include "timer.h"
+#include "codepages.h"
+#include "emu.h"
+
+/* Where in a line HBlank starts, after OAM search and drawing */
+#define HBLANK_DOT 252
+/* CPU cycles each 16 byte block holds the CPU for, at normal speed */
+#define HDMA_BLOCK_CYCLES 32
+
+int cgbMode = 0;
+int doubleSpeed = 0;
+uint8_t vramBanks[2][VRAM_BANK_SIZE];
+uint8_t wramBanks[8][WRAM_BANK_SIZE];
+int vramBank = 0;
+int wramBank = 1;
+
+uint8_t bgPaletteRam[64];
+uint8_t objPaletteRam[64];
+uint32_t bgPaletteRgb[32];
+uint32_t objPaletteRgb[32];
+
+int hdmaActive = 0;
+uint32_t hdmaStall = 0;
+int speedSwitchPending = 0;
+uint64_t cgbEventAt = CGB_NEVER;
+
+/* Palette RAM holds little endian 0bbbbbgggggrrrrr, each 5 bits is stretched to 8 */
+static void palette_update(const uint8_t *paletteRam, uint32_t *paletteRgb, int index) {
+    int entry = index >> 1;
+    uint16_t colour = paletteRam[entry * 2] | (paletteRam[entry * 2 + 1] << 8);
+    uint32_t r = colour & 0x1F;
+    uint32_t g = (colour >> 5) & 0x1F;
+    uint32_t b = (colour >> 10) & 0x1F;
+    r = (r << 3) | (r >> 2);
+    g = (g << 3) | (g >> 2);
+    b = (b << 3) | (b >> 2);
+    paletteRgb[entry] = (r << 16) | (g << 8) | b;
+}
+
+/* BCPD and OCPD write through the index in BCPS and OCPS, which can count up */
+static void palette_write(uint16_t specAddr, uint8_t *paletteRam, uint32_t *paletteRgb, uint8_t value) {
+    uint8_t spec = emuRAM[specAddr];
+    int index = spec & 0x3F;
+    paletteRam[index] = value;
+    palette_update(paletteRam, paletteRgb, index);
+    if (spec & 0x80) {
+        index = (index + 1) & 0x3F;
+        emuRAM[specAddr] = (spec & 0x80) | 0x40 | index;
+    }
+    emuRAM[specAddr + 1] = paletteRam[index];
+}
+
+static void vram_switch(int bank) {
+    if (bank == vramBank) {
+        return;
+    }
+    code_pages_invalidate(0x8000, 0x9FFF);
+    memcpy(vramBanks[vramBank], &emuRAM[0x8000], VRAM_BANK_SIZE);
+    memcpy(&emuRAM[0x8000], vramBanks[bank], VRAM_BANK_SIZE);
+    vramBank = bank;
+}
+
+static void wram_switch(int bank) {
+    if (bank == wramBank) {
+        return;
+    }
+    code_pages_invalidate(0xD000, 0xDFFF);
+    memcpy(wramBanks[wramBank], &emuRAM[0xD000], WRAM_BANK_SIZE);
+    memcpy(&emuRAM[0xD000], wramBanks[bank], WRAM_BANK_SIZE);
+    wramBank = bank;
+}
+
+/* When the next HBlank on a visible line starts, LY 144-153 have none */
+static uint64_t next_hblank(void) {
+    uint32_t ahead;
+    if (ly < 144 && ly_counter < HBLANK_DOT) {
+        ahead = HBLANK_DOT - ly_counter;
+    } else {
+        uint32_t lines = ly + 1 < 144 ? 1 : 154 - ly;
+        ahead = lines * 456 - ly_counter + HBLANK_DOT;
+    }
+    return cycleCount + ((uint64_t)ahead << doubleSpeed);
+}
+
+/* Copies blocks of 16 bytes from HDMA1/2 into VRAM at HDMA3/4, moving both on */
+static void hdma_copy(int blocks) {
+    uint16_t source = ((emuRAM[HDMA1_ADDR] << 8) | emuRAM[HDMA2_ADDR]) & 0xFFF0;
+    uint16_t dest = ((emuRAM[HDMA3_ADDR] << 8) | emuRAM[HDMA4_ADDR]) & 0x1FF0;
+    code_pages_invalidate(0x8000, 0x9FFF);
+    for (int i = 0; i < blocks; i++) {
+        memcpy(&emuRAM[0x8000 + dest], &emuRAM[source], 16);
+        source += 16;
+        dest = (dest + 16) & 0x1FF0;
+    }
+    emuRAM[HDMA1_ADDR] = source >> 8;
+    emuRAM[HDMA2_ADDR] = source & 0xFF;
+    emuRAM[HDMA3_ADDR] = dest >> 8;
+    emuRAM[HDMA4_ADDR] = dest & 0xFF;
+}
+
+static void hdma_start(uint8_t value) {
+    if (hdmaActive && !(value & 0x80)) {
+        /* Stops an HBlank copy, HDMA5 keeps what was left */
+        hdmaActive = 0;
+        emuRAM[HDMA5_ADDR] |= 0x80;
+        cgbEventAt = CGB_NEVER;
+    } else if (value & 0x80) {
+        hdmaActive = 1;
+        emuRAM[HDMA5_ADDR] = value & 0x7F;
+        cgbEventAt = next_hblank();
+    } else {
+        /* General purpose, all of it now and the CPU pays for it at the next event */
+        int blocks = (value & 0x7F) + 1;
+        hdma_copy(blocks);
+        emuRAM[HDMA5_ADDR] = 0xFF;
+        hdmaStall += blocks * (HDMA_BLOCK_CYCLES << doubleSpeed);
+        cgbEventAt = cycleCount;
+        /* Whatever block wrote HDMA5 ends here */
+        codeWritten = 1;
+    }
+    schedule_update();
+}
+
+int cgb_event(void) {
+    if (speedSwitchPending) {
+        speedSwitchPending = 0;
+        doubleSpeed ^= 1;
+        emuRAM[KEY1_ADDR] = (doubleSpeed << 7) | 0x7E;
+        /* Everything the PPU times is twice or half as many CPU cycles away now */
+        schedule_speed_changed();
+    }
+    int cycles = hdmaStall;
+    hdmaStall = 0;
+    if (hdmaActive) {
+        hdma_copy(1);
+        cycles += HDMA_BLOCK_CYCLES << doubleSpeed;
+        if (emuRAM[HDMA5_ADDR] == 0) {
+            hdmaActive = 0;
+            emuRAM[HDMA5_ADDR] = 0xFF;
+        } else {
+            emuRAM[HDMA5_ADDR]--;
+        }
+    }
+    cgbEventAt = hdmaActive ? next_hblank() : CGB_NEVER;
+    schedule_update();
+    return cycles;
+}
+
+void cgb_write(uint16_t addr, uint8_t value) {
+    if (!cgbMode) {
+        /* Plain bytes on a DMG */
+        emuRAM[addr] = value;
+        return;
+    }
+    switch (addr) {
+        case KEY1_ADDR: /* Only the prepare bit can be written, STOP does the rest */
+            emuRAM[addr] = (emuRAM[addr] & 0x80) | 0x7E | (value & 0x01);
+            break;
+        case VBK_ADDR:
+            vram_switch(value & 0x01);
+            emuRAM[addr] = 0xFE | vramBank;
+            break;
+        case SVBK_ADDR: /* Bank 0 is not allowed, it picks 1 */
+            wram_switch((value & 0x07) ? (value & 0x07) : 1);
+            emuRAM[addr] = 0xF8 | (value & 0x07);
+            break;
+        case HDMA5_ADDR:
+            hdma_start(value);
+            break;
+        case BCPS_ADDR:
+            emuRAM[addr] = value | 0x40;
+            emuRAM[BCPD_ADDR] = bgPaletteRam[value & 0x3F];
+            break;
+        case OCPS_ADDR:
+            emuRAM[addr] = value | 0x40;
+            emuRAM[OCPD_ADDR] = objPaletteRam[value & 0x3F];
+            break;
+        case BCPD_ADDR:
+            palette_write(BCPS_ADDR, bgPaletteRam, bgPaletteRgb, value);
+            break;
+        case OCPD_ADDR:
+            palette_write(OCPS_ADDR, objPaletteRam, objPaletteRgb, value);
+            break;
+        default: /* HDMA1-4 */
+            emuRAM[addr] = value;
+            break;
+    }
+}
+
+int cgb_speed_switch(void) {
+    if (!cgbMode || !(emuRAM[KEY1_ADDR] & 0x01)) {
+        return 0;
+    }
+    speedSwitchPending = 1;
+    cgbEventAt = cycleCount;
+    schedule_update();
+    /* STOP ends blocks, so this is the last instruction before the switch */
+    return 1;
+}
+
+const uint8_t *cgb_vram(int bank) {
+    return bank == vramBank ? &emuRAM[0x8000] : vramBanks[bank];
+}
+
+void cgb_restored(void) {
+    for (int i = 0; i < 64; i += 2) {
+        palette_update(bgPaletteRam, bgPaletteRgb, i);
+        palette_update(objPaletteRam, objPaletteRgb, i);
+    }
+}
+
+void cgb_reset(int enabled) {
+    cgbMode = enabled;
+    if (!enabled) {
+        return;
+    }
+    emuRAM[KEY1_ADDR] = 0x7E;
+    emuRAM[VBK_ADDR] = 0xFE;
+    emuRAM[SVBK_ADDR] = 0xF9;
+    emuRAM[HDMA5_ADDR] = 0xFF;
+    /* The boot ROM leaves every colour white */
+    memset(bgPaletteRam, 0xFF, sizeof(bgPaletteRam));
+    memset(objPaletteRam, 0xFF, sizeof(objPaletteRam));
+    emuRAM[BCPS_ADDR] = 0x40;
+    emuRAM[BCPD_ADDR] = 0xFF;
+    emuRAM[OCPS_ADDR] = 0x40;
+    emuRAM[OCPD_ADDR] = 0xFF;
+    cgb_restored();
+}
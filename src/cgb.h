@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#ifndef CGB_H
+#define CGB_H
+
+#include <stdint.h>
+
+#define KEY1_ADDR 0xFF4D
+#define VBK_ADDR 0xFF4F
+#define HDMA1_ADDR 0xFF51
+#define HDMA2_ADDR 0xFF52
+#define HDMA3_ADDR 0xFF53
+#define HDMA4_ADDR 0xFF54
+#define HDMA5_ADDR 0xFF55
+#define BCPS_ADDR 0xFF68
+#define BCPD_ADDR 0xFF69
+#define OCPS_ADDR 0xFF6A
+#define OCPD_ADDR 0xFF6B
+#define SVBK_ADDR 0xFF70
+
+/* The header byte that marks a cartridge as made for the CGB */
+#define CGB_FLAG_ADDR 0x0143
+
+#define VRAM_BANK_SIZE 0x2000
+#define WRAM_BANK_SIZE 0x1000
+
+/* Nothing pending */
+#define CGB_NEVER UINT64_MAX
+
+/*
+ * Game Boy Color support. The bank that is switched in always lives in
+ * emuRAM, so the handlers, the JIT and compiled blocks keep indexing it
+ * flat. Switching copies the window out to its bank and the new bank in.
+ * The renderer gets at either VRAM bank through cgb_vram().
+ */
+extern int cgbMode;
+/* 1 in double speed mode, the CPU runs 2 cycles for every PPU dot */
+extern int doubleSpeed;
+extern uint8_t vramBanks[2][VRAM_BANK_SIZE];
+extern uint8_t wramBanks[8][WRAM_BANK_SIZE];
+extern int vramBank;
+extern int wramBank;
+
+/* 8 palettes of 4 colours, as written and as 0x00RRGGBB by palette * 4 + colour */
+extern uint8_t bgPaletteRam[64];
+extern uint8_t objPaletteRam[64];
+extern uint32_t bgPaletteRgb[32];
+extern uint32_t objPaletteRgb[32];
+
+/*
+ * One event run_frame() stops at for HDMA and the speed switch. HBlank
+ * HDMA copies one block per line, a general purpose copy and STOP take
+ * effect right after the instruction, once every tier has counted it.
+ */
+extern int hdmaActive;
+extern uint32_t hdmaStall; /* CPU cycles a general purpose copy still owes */
+extern int speedSwitchPending;
+extern uint64_t cgbEventAt; /* in cycleCount, CGB_NEVER when idle */
+
+/* Sets up the registers the CGB boot ROM leaves, call once the ROM is in */
+void cgb_reset(int enabled);
+void cgb_write(uint16_t addr, uint8_t value);
+/* STOP with KEY1 armed, returns 1 if the speed is going to switch */
+int cgb_speed_switch(void);
+/* Run by the scheduler once cycleCount reaches cgbEventAt, returns the CPU cycles it took */
+int cgb_event(void);
+/* A VRAM bank's bytes, wherever they are right now */
+const uint8_t *cgb_vram(int bank);
+/* Rebuilds the palette tables after loading a state */
+void cgb_restored(void);
+
+#endif /* CGB_H */
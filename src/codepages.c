@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include "codepages.h"
+
+uint8_t pageHasCode[CODE_PAGES];
+uint32_t pageGeneration[CODE_PAGES];
+int codeWritten = 0;
+
+void code_page_written(uint16_t addr) {
+    unsigned page = addr >> CODE_PAGE_SHIFT;
+    pageGeneration[page]++;
+    /* Nothing cached is current any more, later stores go straight through */
+    pageHasCode[page] = 0;
+    codeWritten = 1;
+}
+
+/* A cache now holds code made from the bytes at start */
+void code_pages_mark(uint16_t start, uint32_t bytes) {
+    uint32_t last = (start + bytes - 1) >> CODE_PAGE_SHIFT;
+    for (uint32_t page = start >> CODE_PAGE_SHIFT; page <= last && page < CODE_PAGES; page++) {
+        pageHasCode[page] = 1;
+    }
+}
+
+/* For memory rewritten behind the bus, like loading a state */
+void code_pages_invalidate(uint16_t start, uint16_t end) {
+    for (unsigned page = start >> CODE_PAGE_SHIFT; page <= (unsigned)(end >> CODE_PAGE_SHIFT); page++) {
+        if (pageHasCode[page]) {
+            code_page_written((uint16_t)(page << CODE_PAGE_SHIFT));
+        }
+    }
+}
+
+/* Whether any of the count bytes from start sit on a page with code */
+int code_pages_have_code(uint16_t start, uint32_t count) {
+    uint32_t last = (start + count - 1) >> CODE_PAGE_SHIFT;
+    for (uint32_t page = start >> CODE_PAGE_SHIFT; page <= last && page < CODE_PAGES; page++) {
+        if (pageHasCode[page]) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef CODEPAGES_H
+#define CODEPAGES_H
+
+#include <stdint.h>
+
+/*
+ * Self-modifying code detection for everything that caches code (the
+ * block cache, the JIT, blocks compiled ahead of time). Memory is split
+ * into 256 byte pages, each with a generation and a flag saying some
+ * cache holds code from it. A store to a flagged page bumps the
+ * generation and clears the flag. Caches remember the generations their
+ * code was made from and drop it the next time they look it up, so
+ * stores to pages without code cost one test of the flag.
+ */
+
+#define CODE_PAGE_SHIFT 8
+#define CODE_PAGES (0x10000 >> CODE_PAGE_SHIFT)
+
+extern uint8_t pageHasCode[CODE_PAGES];
+extern uint32_t pageGeneration[CODE_PAGES];
+
+/*
+ * Set when a store hits a page with code, the running code may be stale.
+ * DMA and newly pending interrupts set it too, to end the running block
+ */
+extern int codeWritten;
+
+void code_page_written(uint16_t addr);
+void code_pages_mark(uint16_t start, uint32_t bytes);
+void code_pages_invalidate(uint16_t start, uint16_t end);
+int code_pages_have_code(uint16_t start, uint32_t count);
+
+/* Called from write_byte before the store lands */
+static inline void code_pages_check_write(uint16_t addr) {
+    if (pageHasCode[addr >> CODE_PAGE_SHIFT]) {
+        code_page_written(addr);
+    }
+}
+
+#endif /* CODEPAGES_H */
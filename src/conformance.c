@@ -0,0 +1,483 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "emu.h"
+#include "serial.h"
+#include "core.h"
+#include "profile.h"
+#include "seajson.h"
+#include "alu.h"
+
+/*
+ * honeybun-conformance, runs every ROM under a directory headless and
+ * reports which passed. The machine is process globals, so each ROM gets
+ * a forked child of its own and as many run at once as there are cores.
+ * A ROM is done when one of the usual test ROM conventions says so:
+ *
+ *  - blargg prints "Passed" or "Failed" over the serial port
+ *  - blargg also keeps a status byte at $A000 once $A001 holds DE B0 61,
+ *    0 is a pass and the text follows at $A004
+ *  - mooneye stops at a halt point with B C D E H L holding 3 5 8 13 21 34
+ *    for a pass or all $42 for a failure
+ *
+ * Anything still running after the time limit in emulated seconds is a
+ * timeout, and a child still alive after the wall clock limit is killed.
+ * With -p every child counts into a profile in memory shared with the
+ * parent, which adds each one to the total as the child exits.
+ */
+
+#define OPTSTR "d:o:n:t:w:p:cjh"
+
+#define FRAMES_PER_SECOND 60
+#define MESSAGE_SIZE 192
+
+/* Where blargg keeps its result when there is no serial port to print to */
+#define BLARGG_STATUS_ADDR 0xA000
+#define BLARGG_TEXT_ADDR 0xA004
+#define BLARGG_RUNNING 0x80
+
+enum {
+    RESULT_PASS,
+    RESULT_FAIL,
+    RESULT_TIMEOUT,
+    RESULT_CRASH,
+};
+
+static const char *resultNames[] = { "pass", "fail", "timeout", "crash" };
+
+/* What a child sends back, small enough for one atomic pipe write */
+typedef struct {
+    int result;
+    unsigned long frames;
+    char message[MESSAGE_SIZE];
+} rom_result;
+
+typedef struct {
+    char *path;
+    pid_t pid;
+    int pipe; /* read end while the child runs */
+    rom_result result;
+    core_profile *profile; /* shared with the child, with -p */
+} rom_job;
+
+static rom_job *jobs;
+static int jobCount;
+static int jobCapacity;
+
+static unsigned long frameLimit = 120 * FRAMES_PER_SECOND;
+static unsigned int wallLimit = 60;
+static core_profile *totalProfile;
+
+static int is_rom(const char *name) {
+    const char *dot = strrchr(name, '.');
+    return dot && (!strcmp(dot, ".gb") || !strcmp(dot, ".gbc"));
+}
+
+static void add_job(const char *path) {
+    if (jobCount == jobCapacity) {
+        jobCapacity = jobCapacity ? jobCapacity * 2 : 64;
+        jobs = realloc(jobs, sizeof(rom_job) * jobCapacity);
+        if (!jobs) {
+            fprintf(stderr, "honeybun-conformance: out of memory\n");
+            exit(1);
+        }
+    }
+    memset(&jobs[jobCount], 0, sizeof(rom_job));
+    jobs[jobCount].path = strdup(path);
+    jobs[jobCount].pipe = -1;
+    jobCount++;
+}
+
+/* Every ROM under dir, subdirectories too */
+static void find_roms(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "honeybun-conformance: unable to open %s\n", dir);
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(d))) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        struct stat info;
+        if (stat(path, &info) != 0) {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode)) {
+            find_roms(path);
+        } else if (S_ISREG(info.st_mode) && is_rom(entry->d_name)) {
+            add_job(path);
+        }
+    }
+    closedir(d);
+}
+
+static int compare_jobs(const void *a, const void *b) {
+    return strcmp(((const rom_job *)a)->path, ((const rom_job *)b)->path);
+}
+
+/* Copies printable text, blargg's results are a few lines */
+static void set_message(rom_result *result, const uint8_t *text, size_t length) {
+    size_t used = 0;
+    for (size_t i = 0; i < length && used + 1 < MESSAGE_SIZE; i++) {
+        uint8_t c = text[i];
+        result->message[used++] = (c >= 0x20 && c < 0x7F) ? (char)c : ' ';
+    }
+    result->message[used] = '\0';
+}
+
+static int serial_says(const char *word) {
+    size_t length = strlen(word);
+    for (size_t i = 0; i + length <= serialOutputLength; i++) {
+        if (!memcmp(serialOutput + i, word, length)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Whether the ROM has decided, filling in result if it has */
+static int check_verdict(rom_result *result, uint16_t lastPc) {
+    if (serial_says("Passed") || serial_says("Failed")) {
+        result->result = serial_says("Failed") ? RESULT_FAIL : RESULT_PASS;
+        set_message(result, serialOutput, serialOutputLength);
+        return 1;
+    }
+
+    const uint8_t *status = &emuRAM[BLARGG_STATUS_ADDR];
+    if (status[1] == 0xDE && status[2] == 0xB0 && status[3] == 0x61 && status[0] != BLARGG_RUNNING) {
+        result->result = status[0] ? RESULT_FAIL : RESULT_PASS;
+        const uint8_t *text = &emuRAM[BLARGG_TEXT_ADDR];
+        set_message(result, text, strnlen((const char *)text, MESSAGE_SIZE));
+        return 1;
+    }
+
+    /* A PC that stayed put for a frame is where mooneye stops */
+    if (pc == lastPc) {
+        if (bc == 0x0305 && de == 0x080D && hl == 0x1522) {
+            result->result = RESULT_PASS;
+            return 1;
+        }
+        if (bc == 0x4242 && de == 0x4242 && hl == 0x4242) {
+            result->result = RESULT_FAIL;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Runs in the child, never returns */
+static void run_rom(const char *path, core_profile *profile, int out) {
+    /* A hung core is killed, a hung ROM times out on its own */
+    alarm(wallLimit);
+    /* The core talks on stdout, the report might be going there */
+    int devNull = open("/dev/null", O_WRONLY);
+    if (devNull >= 0) {
+        dup2(devNull, STDOUT_FILENO);
+        close(devNull);
+    }
+
+    coreProfile = profile;
+    rom_result result;
+    memset(&result, 0, sizeof(result));
+    result.result = RESULT_TIMEOUT;
+    if (!power_on(path)) {
+        result.result = RESULT_CRASH;
+        snprintf(result.message, sizeof(result.message), "unable to load the ROM");
+    } else {
+        uint16_t lastPc = pc;
+        while (result.frames < frameLimit) {
+            run_frame();
+            result.frames++;
+            if (check_verdict(&result, lastPc)) {
+                break;
+            }
+            lastPc = pc;
+        }
+    }
+    if (write(out, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+static void start_job(rom_job *job) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("honeybun-conformance: pipe");
+        exit(1);
+    }
+    if (totalProfile) {
+        job->profile = mmap(NULL, sizeof(core_profile), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (job->profile == MAP_FAILED) {
+            perror("honeybun-conformance: mmap");
+            exit(1);
+        }
+    }
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("honeybun-conformance: fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        run_rom(job->path, job->profile, fds[1]);
+    }
+    close(fds[1]);
+    job->pid = pid;
+    job->pipe = fds[0];
+}
+
+/* Collects whatever child exits next, returns its job */
+static rom_job *finish_job(void) {
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0) {
+        if (errno != EINTR) {
+            perror("honeybun-conformance: wait");
+            exit(1);
+        }
+        return NULL;
+    }
+    rom_job *job = NULL;
+    for (int i = 0; i < jobCount; i++) {
+        if (jobs[i].pid == pid && jobs[i].pipe >= 0) {
+            job = &jobs[i];
+            break;
+        }
+    }
+    if (!job) {
+        return NULL;
+    }
+    if (job->profile) {
+        /* Whatever it got through, a timeout's counts are still counts */
+        profile_merge(totalProfile, job->profile);
+        munmap(job->profile, sizeof(core_profile));
+        job->profile = NULL;
+    }
+    ssize_t got = read(job->pipe, &job->result, sizeof(job->result));
+    close(job->pipe);
+    job->pipe = -1;
+    if (got != sizeof(job->result)) {
+        memset(&job->result, 0, sizeof(job->result));
+        if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+            job->result.result = RESULT_TIMEOUT;
+            snprintf(job->result.message, MESSAGE_SIZE, "killed after %us", wallLimit);
+        } else {
+            job->result.result = RESULT_CRASH;
+            if (WIFSIGNALED(status)) {
+                snprintf(job->result.message, MESSAGE_SIZE, "signal %d", WTERMSIG(status));
+            } else {
+                snprintf(job->result.message, MESSAGE_SIZE, "exit status %d", WEXITSTATUS(status));
+            }
+        }
+    }
+    return job;
+}
+
+/* JSON string body, seajson takes values as they are */
+static void json_escape(char *out, size_t size, const char *text) {
+    size_t used = 0;
+    for (; *text && used + 3 < size; text++) {
+        if (*text == '"' || *text == '\\') {
+            out[used++] = '\\';
+        }
+        out[used++] = *text;
+    }
+    out[used] = '\0';
+}
+
+static seajson add_number(seajson json, const char *key, double value, const char *format) {
+    char text[64];
+    snprintf(text, sizeof(text), format, value);
+    seajson grown = add_item_seajson(json, key, text);
+    free_json(json);
+    return grown;
+}
+
+static int write_report(const char *path, int *counts, double seconds) {
+    jarray results = new_jarray();
+    int owned = 0;
+    for (int i = 0; i < jobCount; i++) {
+        char rom[4096 + 512];
+        char message[MESSAGE_SIZE * 2];
+        char item[sizeof(rom) + sizeof(message) + 128];
+        json_escape(rom, sizeof(rom), jobs[i].path);
+        json_escape(message, sizeof(message), jobs[i].result.message);
+        snprintf(item, sizeof(item), "{\"rom\":\"%s\",\"result\":\"%s\",\"frames\":%lu,\"message\":\"%s\"}",
+            rom, resultNames[jobs[i].result.result], jobs[i].result.frames, message);
+        jarray grown = add_item_to_jarray(results, item);
+        if (owned) {
+            free_jarray(results);
+        }
+        results = grown;
+        owned = 1;
+    }
+
+    /* add_item_seajson wants something in the object already */
+    char first[32];
+    snprintf(first, sizeof(first), "{\"roms\":%d}", jobCount);
+    seajson report = strdup(first);
+    for (int i = 0; i <= RESULT_CRASH; i++) {
+        report = add_number(report, resultNames[i], counts[i], "%.0f");
+    }
+    report = add_number(report, "seconds", seconds, "%.3f");
+    seajson full = add_item_seajson(report, "results", results.arrayString);
+    free_json(report);
+    if (owned) {
+        free_jarray(results);
+    }
+
+    FILE *out = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "honeybun-conformance: unable to write %s\n", path);
+        free_json(full);
+        return -1;
+    }
+    fprintf(out, "%s\n", full);
+    if (out != stdout) {
+        fclose(out);
+    }
+    free_json(full);
+    return 0;
+}
+
+static void show_help(void) {
+    printf("Usage: honeybun-conformance <options>\n\n");
+    printf(" -d: (required) directory of test ROMs, searched recursively\n");
+    printf(" -o: (optional) JSON report to write, - for stdout, the default\n");
+    printf(" -n: (optional) ROMs to run at once, defaults to the number of cores\n");
+    printf(" -t: (optional) emulated seconds before a ROM times out, defaults to 120\n");
+    printf(" -w: (optional) wall clock seconds before a ROM is killed, defaults to 60\n");
+    printf(" -p: (optional) profile every ROM in the interpreter and write the merged JSON here\n");
+    printf(" -c: (optional) run the cached interpreter\n");
+    printf(" -j: (optional) run the JIT\n");
+    printf(" -h: show usage\n");
+}
+
+int main(int argc, char **argv) {
+    const char *romDir = NULL;
+    const char *reportPath = "-";
+    const char *profilePath = NULL;
+    long parallel = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    while ((opt = getopt(argc, argv, OPTSTR)) != EOF) {
+        if (opt == 'd') {
+            romDir = optarg;
+        } else if (opt == 'o') {
+            reportPath = optarg;
+        } else if (opt == 'n') {
+            parallel = atol(optarg);
+        } else if (opt == 't') {
+            frameLimit = strtoul(optarg, NULL, 10) * FRAMES_PER_SECOND;
+        } else if (opt == 'w') {
+            wallLimit = (unsigned int)strtoul(optarg, NULL, 10);
+        } else if (opt == 'p') {
+            profilePath = optarg;
+        } else if (opt == 'c') {
+            emuConfig.cachedInterpreter = 1;
+        } else if (opt == 'j') {
+            emuConfig.cachedInterpreter = 1;
+            emuConfig.jit = 1;
+        } else {
+            show_help();
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (!romDir) {
+        show_help();
+        return 1;
+    }
+    if (parallel < 1) {
+        parallel = 1;
+    }
+    emuConfig.headless = 1;
+    /* Filled once here so every child inherits them, power_on() would too */
+    alu_init();
+    if (alu_check() != 0) {
+        fprintf(stderr, "honeybun-conformance: ALU tables disagree with the arithmetic\n");
+        return 1;
+    }
+    if (profilePath) {
+        /* The other tiers never go through the profiled core */
+        if (emuConfig.cachedInterpreter) {
+            fprintf(stderr, "honeybun-conformance: profiling runs in the interpreter, ignoring -c and -j\n");
+        }
+        emuConfig.cachedInterpreter = 0;
+        emuConfig.jit = 0;
+        emuConfig.core = CORE_PROFILED;
+        totalProfile = profile_create();
+        if (!totalProfile) {
+            return 1;
+        }
+    }
+
+    find_roms(romDir);
+    if (!jobCount) {
+        fprintf(stderr, "honeybun-conformance: no ROMs under %s\n", romDir);
+        return 1;
+    }
+    /* Same order every run, whatever finishes first */
+    qsort(jobs, jobCount, sizeof(rom_job), compare_jobs);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int counts[RESULT_CRASH + 1] = { 0 };
+    int next = 0;
+    int running = 0;
+    while (next < jobCount || running) {
+        if (next < jobCount && running < parallel) {
+            start_job(&jobs[next++]);
+            running++;
+            continue;
+        }
+        rom_job *job = finish_job();
+        if (!job) {
+            continue;
+        }
+        running--;
+        counts[job->result.result]++;
+        fprintf(stderr, "%-7s %s (%.1fs)\n", resultNames[job->result.result], job->path,
+            (double)job->result.frames / FRAMES_PER_SECOND);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    fprintf(stderr, "honeybun-conformance: %d of %d passed in %.2fs\n", counts[RESULT_PASS], jobCount, seconds);
+    if (write_report(reportPath, counts, seconds) != 0) {
+        return 1;
+    }
+    if (totalProfile) {
+        /* The report may be on stdout */
+        profile_print_top(totalProfile, stderr, PROFILE_TOP);
+        if (profile_write_json(totalProfile, profilePath) != 0) {
+            return 1;
+        }
+    }
+    return counts[RESULT_PASS] == jobCount ? 0 : 1;
+}
@@ -0,0 +1,485 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core.h"
+#include "emu.h"
+#include "opcodes.h"
+#include "log.h"
+#include "profile.h"
+
+#define CONTINUE_INVALID_OPCODE 0
+
+/* Masks the two bytes after the opcode down to the immediate, by length */
+static const uint16_t immMasks[4] = { 0, 0, 0x00FF, 0xFFFF };
+
+static FILE *traceFile;
+static int traceFormat;
+
+/*
+ * The doctor and binary traces skip stdio per instruction, records are
+ * built straight into this and it goes out in one write when full.
+ */
+#define TRACE_BUFFER_SIZE (1 << 20)
+static uint8_t *traceBuffer;
+static size_t traceUsed;
+
+/* gameboy-doctor's line, the digits get filled in for every instruction */
+static const char doctorTemplate[] = "A:00 F:00 B:00 C:00 D:00 E:00 H:00 L:00 SP:0000 PC:0000 PCMEM:00,00,00,00\n";
+#define DOCTOR_LINE_SIZE (sizeof(doctorTemplate) - 1)
+
+/* A binary trace starts with this, then a record per instruction */
+static const char traceMagic[8] = "HBTRACE\1";
+
+/* A F B C D E H L, SP and PC little endian, then the four bytes at PC */
+#define TRACE_RECORD_SIZE 16
+
+static char hexPairs[256][2];
+
+static void trace_hex_init(void) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (int i = 0; i < 256; i++) {
+        hexPairs[i][0] = digits[i >> 4];
+        hexPairs[i][1] = digits[i & 0xF];
+    }
+}
+
+/* Writes DOCTOR_LINE_SIZE bytes, the newline included */
+static void format_doctor_line(char *out, const uint8_t *record) {
+    static const uint8_t bytePositions[8] = { 2, 7, 12, 17, 22, 27, 32, 37 };
+    static const uint8_t pcmemPositions[4] = { 62, 65, 68, 71 };
+    memcpy(out, doctorTemplate, DOCTOR_LINE_SIZE);
+    for (int i = 0; i < 8; i++) {
+        memcpy(out + bytePositions[i], hexPairs[record[i]], 2);
+    }
+    memcpy(out + 43, hexPairs[record[9]], 2); /* SP */
+    memcpy(out + 45, hexPairs[record[8]], 2);
+    memcpy(out + 51, hexPairs[record[11]], 2); /* PC */
+    memcpy(out + 53, hexPairs[record[10]], 2);
+    for (int i = 0; i < 4; i++) {
+        memcpy(out + pcmemPositions[i], hexPairs[record[12 + i]], 2);
+    }
+}
+
+static void trace_flush(void) {
+    if (traceUsed) {
+        fwrite(traceBuffer, 1, traceUsed, traceFile);
+        traceUsed = 0;
+    }
+}
+
+static uint8_t breakpoints[0x10000];
+/* A breakpoint we stopped on lets the next step through */
+static int resumePc = -1;
+
+typedef struct {
+    uint16_t addr;
+    uint8_t value;
+} watchpoint;
+
+static watchpoint watchpoints[CORE_MAX_WATCHPOINTS];
+static int watchpointCount;
+
+int core_trace_open(const char *path, int format) {
+    traceFormat = format;
+    if (!strcmp(path, "-")) {
+        traceFile = stdout;
+    } else {
+        traceFile = fopen(path, "wb");
+        if (!traceFile) {
+            printf("core: unable to open %s\n", path);
+            return -1;
+        }
+        /* A line per instruction, let it batch */
+        setvbuf(traceFile, NULL, _IOFBF, 1 << 20);
+    }
+    if (format != TRACE_DISASSEMBLY) {
+        traceBuffer = malloc(TRACE_BUFFER_SIZE);
+        if (!traceBuffer) {
+            printf("core: unable to allocate the trace buffer\n");
+            core_trace_close();
+            return -1;
+        }
+        trace_hex_init();
+    }
+    if (format == TRACE_BINARY) {
+        fwrite(traceMagic, 1, sizeof(traceMagic), traceFile);
+    }
+    return 0;
+}
+
+void core_trace_close(void) {
+    if (traceBuffer) {
+        trace_flush();
+        free(traceBuffer);
+        traceBuffer = NULL;
+    }
+    if (traceFile && traceFile != stdout) {
+        fclose(traceFile);
+    }
+    traceFile = NULL;
+}
+
+void core_add_breakpoint(uint16_t addr) {
+    breakpoints[addr] = 1;
+}
+
+int core_add_watchpoint(uint16_t addr) {
+    if (watchpointCount == CORE_MAX_WATCHPOINTS) {
+        printf("core: only %d watchpoints, ignoring $%04X\n", CORE_MAX_WATCHPOINTS, addr);
+        return -1;
+    }
+    watchpoints[watchpointCount++].addr = addr;
+    return 0;
+}
+
+void core_watch_sync(void) {
+    for (int i = 0; i < watchpointCount; i++) {
+        watchpoints[i].value = emuRAM[watchpoints[i].addr];
+    }
+}
+
+static void print_instruction(FILE *out, uint16_t addr) {
+    char text[32];
+    disassemble(addr, &emuRAM[addr], text, sizeof(text));
+    fprintf(out, "%04X  %-20s AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X\n", addr, text, af, bc, de, hl, sp);
+}
+
+/* State before the instruction at addr runs */
+static void trace_instruction(uint16_t addr) {
+    if (traceFormat == TRACE_DISASSEMBLY) {
+        print_instruction(traceFile, addr);
+        return;
+    }
+    if (traceUsed + DOCTOR_LINE_SIZE > TRACE_BUFFER_SIZE) {
+        trace_flush();
+    }
+    uint8_t record[TRACE_RECORD_SIZE] = {
+        af >> 8, af & 0xFF, bc >> 8, bc & 0xFF, de >> 8, de & 0xFF, hl >> 8, hl & 0xFF,
+        sp & 0xFF, sp >> 8, addr & 0xFF, addr >> 8,
+        emuRAM[addr], emuRAM[(uint16_t)(addr + 1)], emuRAM[(uint16_t)(addr + 2)], emuRAM[(uint16_t)(addr + 3)],
+    };
+    if (traceFormat == TRACE_DOCTOR) {
+        format_doctor_line((char *)traceBuffer + traceUsed, record);
+        traceUsed += DOCTOR_LINE_SIZE;
+    } else {
+        memcpy(traceBuffer + traceUsed, record, TRACE_RECORD_SIZE);
+        traceUsed += TRACE_RECORD_SIZE;
+    }
+}
+
+/* Pauses like a keypress would resume, see handle_events() */
+static void core_break(void) {
+    if (traceFile == stdout && traceBuffer) {
+        trace_flush();
+    }
+    printf("breakpoint: ");
+    print_instruction(stdout, pc);
+    resumePc = pc;
+    cycle = 0;
+}
+
+/* Watchpoints see changes in value, a store of the same byte goes unseen */
+static void core_check_watchpoints(uint16_t addr) {
+    for (int i = 0; i < watchpointCount; i++) {
+        watchpoint *watch = &watchpoints[i];
+        uint8_t value = emuRAM[watch->addr];
+        if (value != watch->value) {
+            printf("watchpoint: $%04X $%02X -> $%02X by ", watch->addr, watch->value, value);
+            print_instruction(stdout, addr);
+            watch->value = value;
+            cycle = 0;
+        }
+    }
+}
+
+/*
+ * One instruction. Every caller passes constants, so each copy below is
+ * compiled with the features it does not use gone entirely.
+ */
+static inline __attribute__((always_inline)) int core_step(const int traced, const int debug, const int profiled) {
+    if (!cycle) {
+        return 0; /* Emulation is paused */
+    }
+
+    uint16_t addr = pc;
+    if (debug) {
+        if (breakpoints[addr] && addr != resumePc) {
+            core_break();
+            return 0;
+        }
+        resumePc = -1;
+    }
+
+    /* Fetch and decode instruction */
+    /* https://gbdev.io/gb-opcodes/optables/ */
+    uint8_t instr = emuRAM[addr];
+    op_handler handler = opTable[instr];
+    if (!handler) {
+        log_stop(); /* Whatever was logged before it comes out first */
+        printf("Unrecognized opcode: %02x at %04x\n", instr, addr);
+#if CONTINUE_INVALID_OPCODE
+        pc++;
+        return 4;
+#else
+        exit(1);
+#endif
+    }
+    if (traced && traceFile && !speculating) {
+        trace_instruction(addr);
+    }
+    uint16_t imm = (emuRAM[addr + 1] | (emuRAM[addr + 2] << 8)) & immMasks[opLength[instr]];
+    pc += opLength[instr];
+    int cycles = handler(imm);
+    if (profiled && !speculating) {
+        /* For a CB opcode imm is the byte that says which */
+        profile_count(coreProfile, bank_for_pc(addr), addr, instr, (uint8_t)imm, cycles);
+    }
+    if (debug && watchpointCount) {
+        core_check_watchpoints(addr);
+    }
+    return cycles;
+}
+
+int execute_instruction(void) {
+    return core_step(0, 0, 0);
+}
+
+int execute_instruction_traced(void) {
+    return core_step(1, 0, 0);
+}
+
+int execute_instruction_debug(void) {
+    return core_step(1, 1, 0);
+}
+
+int execute_instruction_profiled(void) {
+    return core_step(0, 0, 1);
+}
+
+/*
+ * Reads a trace back a line at a time, a binary one comes out as the
+ * doctor lines it stands for. Lines lose their line ending.
+ */
+typedef struct {
+    FILE *file;
+    int binary;
+    uint8_t *buffer;
+    size_t length;
+    size_t position;
+    int ended;
+    char line[DOCTOR_LINE_SIZE];
+} trace_reader;
+
+static int trace_is_binary(FILE *file) {
+    char magic[sizeof(traceMagic)];
+    if (fread(magic, 1, sizeof(magic), file) == sizeof(magic) && !memcmp(magic, traceMagic, sizeof(magic))) {
+        return 1;
+    }
+    rewind(file);
+    return 0;
+}
+
+/* offset counts from past the binary header, where lines start */
+static int reader_open(trace_reader *reader, const char *path, long offset) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    reader->buffer = malloc(TRACE_BUFFER_SIZE);
+    if (!reader->file || !reader->buffer) {
+        printf("core: unable to open %s\n", path);
+        if (reader->file) {
+            fclose(reader->file);
+        }
+        free(reader->buffer);
+        return -1;
+    }
+    reader->binary = trace_is_binary(reader->file);
+    if (reader->binary) {
+        trace_hex_init();
+    }
+    if (offset) {
+        fseek(reader->file, offset, SEEK_CUR);
+    }
+    return 0;
+}
+
+static void reader_close(trace_reader *reader) {
+    fclose(reader->file);
+    free(reader->buffer);
+}
+
+static const char *reader_next(trace_reader *reader, size_t *length) {
+    if (reader->binary) {
+        uint8_t record[TRACE_RECORD_SIZE];
+        if (fread(record, sizeof(record), 1, reader->file) != 1) {
+            return NULL;
+        }
+        format_doctor_line(reader->line, record);
+        *length = DOCTOR_LINE_SIZE - 1;
+        return reader->line;
+    }
+    while (1) {
+        uint8_t *start = reader->buffer + reader->position;
+        size_t left = reader->length - reader->position;
+        uint8_t *newline = memchr(start, '\n', left);
+        if (newline || reader->ended || left == TRACE_BUFFER_SIZE) {
+            if (!newline && !left) {
+                return NULL;
+            }
+            /* The last line may have no newline, an overlong one comes back in pieces */
+            size_t used = newline ? (size_t)(newline - start) + 1 : left;
+            *length = newline ? (size_t)(newline - start) : left;
+            if (*length && start[*length - 1] == '\r') {
+                (*length)--;
+            }
+            reader->position += used;
+            return (const char *)start;
+        }
+        memmove(reader->buffer, start, left);
+        reader->length = left;
+        reader->position = 0;
+        size_t got = fread(reader->buffer + left, 1, TRACE_BUFFER_SIZE - left, reader->file);
+        reader->length += got;
+        reader->ended = (got == 0);
+    }
+}
+
+/*
+ * Line by line, for traces in different formats, line endings that
+ * differ, or to find the line a byte compare stopped in. That one knows
+ * both agree up to offset, the start of line number lines.
+ */
+static int compare_lines(const char *pathA, const char *pathB, long offset, unsigned long long lines) {
+    trace_reader a, b;
+    if (reader_open(&a, pathA, offset) != 0) {
+        return -1;
+    }
+    if (reader_open(&b, pathB, offset) != 0) {
+        reader_close(&a);
+        return -1;
+    }
+    char previous[DOCTOR_LINE_SIZE * 2] = "";
+    int result = 0;
+    while (1) {
+        size_t lengthA, lengthB;
+        const char *lineA = reader_next(&a, &lengthA);
+        const char *lineB = reader_next(&b, &lengthB);
+        if (!lineA || !lineB) {
+            if (lineA || lineB) {
+                printf("traces match for %llu instructions, then %s ends\n", lines, lineA ? pathB : pathA);
+                result = 1;
+            }
+            break;
+        }
+        if (lengthA != lengthB || memcmp(lineA, lineB, lengthA)) {
+            printf("first divergence at instruction %llu\n", lines);
+            if (lines) {
+                printf("  after: %s\n", previous);
+            }
+            printf("  %s: %.*s\n", pathA, (int)lengthA, lineA);
+            printf("  %s: %.*s\n", pathB, (int)lengthB, lineB);
+            result = 1;
+            break;
+        }
+        snprintf(previous, sizeof(previous), "%.*s", (int)lengthA, lineA);
+        lines++;
+    }
+    if (!result) {
+        printf("traces match (%llu instructions)\n", lines);
+    }
+    reader_close(&a);
+    reader_close(&b);
+    return result;
+}
+
+int core_trace_compare(const char *pathA, const char *pathB) {
+    FILE *a = fopen(pathA, "rb");
+    FILE *b = fopen(pathB, "rb");
+    if (!a || !b) {
+        printf("core: unable to open %s\n", a ? pathB : pathA);
+        if (a) {
+            fclose(a);
+        }
+        if (b) {
+            fclose(b);
+        }
+        return -1;
+    }
+    int binary = trace_is_binary(a);
+    if (binary != trace_is_binary(b)) {
+        /* A binary trace against a reference log, go through the text */
+        fclose(a);
+        fclose(b);
+        return compare_lines(pathA, pathB, 0, 0);
+    }
+
+    /*
+     * Same format, compare bytes a chunk at a time and count lines as they
+     * go. The line before the one being compared is where the line by line
+     * compare picks up if they differ, it prints that one as well.
+     */
+    uint8_t *bufferA = malloc(TRACE_BUFFER_SIZE);
+    uint8_t *bufferB = malloc(TRACE_BUFFER_SIZE);
+    unsigned long long lines = 0;
+    unsigned long long offset = 0;
+    unsigned long long lineStart = 0, previousStart = 0;
+    int result = (!bufferA || !bufferB) ? -1 : 0;
+    while (!result) {
+        size_t gotA = fread(bufferA, 1, TRACE_BUFFER_SIZE, a);
+        size_t gotB = fread(bufferB, 1, TRACE_BUFFER_SIZE, b);
+        size_t same = gotA < gotB ? gotA : gotB;
+        size_t match = same;
+        if (memcmp(bufferA, bufferB, same)) {
+            match = 0;
+            while (bufferA[match] == bufferB[match]) {
+                match++;
+            }
+        }
+        if (!binary) {
+            for (uint8_t *p = bufferA, *end = bufferA + match; (p = memchr(p, '\n', end - p)); p++) {
+                previousStart = lineStart;
+                lineStart = offset + (p - bufferA) + 1;
+                lines++;
+            }
+        }
+        offset += match;
+        if (match != same || gotA != gotB) {
+            result = 1;
+            break;
+        }
+        if (!gotA) {
+            break;
+        }
+    }
+    free(bufferA);
+    free(bufferB);
+    fclose(a);
+    fclose(b);
+    if (result < 0) {
+        printf("core: unable to allocate the compare buffers\n");
+        return -1;
+    }
+    if (binary) {
+        /* offset counts from past the header */
+        lines = offset / TRACE_RECORD_SIZE;
+        lineStart = lines * TRACE_RECORD_SIZE;
+        previousStart = lineStart - (lines ? TRACE_RECORD_SIZE : 0);
+    }
+    if (result) {
+        /* Only the line it stopped in and the one before go a line at a time */
+        return compare_lines(pathA, pathB, (long)previousStart, lines ? lines - 1 : 0);
+    }
+    printf("traces match (%llu instructions)\n", lines);
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#ifndef CORE_H
+#define CORE_H
+
+#include <stdint.h>
+
+/*
+ * The interpreter is built four times from one step function, each copy
+ * with a different set of features compiled in. Which one runs is picked
+ * per run with emuConfig.core, the fast one pays for none of them.
+ */
+typedef enum {
+    CORE_FAST, /* fetch, decode, execute, nothing else */
+    CORE_TRACED, /* writes every instruction to a trace file first */
+    CORE_DEBUG, /* traced, plus breakpoints and watchpoints */
+    CORE_PROFILED, /* counts every instruction into coreProfile, see profile.h */
+} core_variant;
+
+#define CORE_MAX_WATCHPOINTS 16
+
+/* execute_instruction() in emu.h is the fast core */
+int execute_instruction_traced(void);
+int execute_instruction_debug(void);
+int execute_instruction_profiled(void);
+
+/* What the traced core writes for every instruction */
+typedef enum {
+    TRACE_DISASSEMBLY, /* the instruction in rgbds syntax and the registers */
+    TRACE_DOCTOR, /* gameboy-doctor's log line, registers and the bytes at PC */
+    TRACE_BINARY, /* what TRACE_DOCTOR prints as 16 byte records */
+} trace_format;
+
+/* "-" traces to stdout */
+int core_trace_open(const char *path, int format);
+void core_trace_close(void);
+/* Stops at the first instruction two traces differ on, in any mix of formats */
+int core_trace_compare(const char *pathA, const char *pathB);
+
+void core_add_breakpoint(uint16_t addr);
+int core_add_watchpoint(uint16_t addr);
+/* Takes the current value of every watched byte, so it is not a change */
+void core_watch_sync(void);
+
+#endif /* CORE_H */
@@ -13,16 +13,18 @@
 #define DEFS_H
 
 #include <stdio.h>
+#include "log.h"
+
+/* Off unless built with -DDEBUGLOG=1, the traced core (-t) covers the CPU */
+#ifndef DEBUGLOG
+#define DEBUGLOG 0
+#endif /* DEBUGLOG */
 
-#define DEBUGLOG 1
 /* Peppermint Errors */
 #define PMError(...) \
-            do { fprintf(stderr, __VA_ARGS__); exit(1); } while (0)
+            do { log_stop(); fprintf(stderr, __VA_ARGS__); exit(1); } while (0)
 
-#if DEBUGLOG
-#define PMDLog(fmt, ...) printf("%s: " fmt, __FUNCTION__, __VA_ARGS__);
-#else /* DEBUGLOG */
-#define PMDLog(fmt, ...)
-#endif /* DEBUGLOG */
+/* Debug messages go through the log thread, see log.h, and are compiled out below LOG_DEBUG */
+#define PMDLog(fmt, ...) PMLog(LOG_DEBUG, "%s: " fmt, __FUNCTION__, __VA_ARGS__)
 
 #endif /* DEFS_H */
\ No newline at end of file
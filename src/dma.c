@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#include <string.h>
+#include "dma.h"
+#include "timer.h"
+#include "codepages.h"
+#include "emu.h"
+
+int dmaActive = 0;
+uint64_t dmaEndsAt = DMA_NEVER;
+
+void dma_start(uint8_t value) {
+    emuRAM[DMA_ADDR] = value;
+    uint16_t source = value << 8;
+    if (source >= 0xE000) {
+        /* Echo RAM, the DMG reads WRAM for the pages past it too */
+        source -= 0x2000;
+    }
+    code_pages_invalidate(OAM_ADDR, OAM_ADDR + OAM_SIZE - 1);
+    memcpy(&emuRAM[OAM_ADDR], &emuRAM[source], OAM_SIZE);
+
+    dmaActive = 1;
+    dmaEndsAt = cycleCount + DMA_CYCLES;
+    bus_lock(1);
+    /* Whatever block wrote 0xFF46 ends here, the interpreter runs the window */
+    codeWritten = 1;
+    schedule_update();
+}
+
+void dma_finish(void) {
+    dmaActive = 0;
+    dmaEndsAt = DMA_NEVER;
+    bus_lock(0);
+    schedule_update();
+}
+
+void dma_restored(void) {
+    dmaActive = dmaEndsAt != DMA_NEVER;
+    bus_lock(dmaActive);
+}
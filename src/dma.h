@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#ifndef DMA_H
+#define DMA_H
+
+#include <stdint.h>
+
+#define DMA_ADDR 0xFF46
+#define OAM_ADDR 0xFE00
+#define OAM_SIZE 0xA0
+
+/* 160 M-cycles of copying plus the one it takes to start */
+#define DMA_CYCLES 644
+
+/* No transfer running */
+#define DMA_NEVER UINT64_MAX
+
+/*
+ * OAM DMA. The 160 bytes are copied in one go when 0xFF46 is written,
+ * then the bus stays locked until dmaEndsAt, an event run_frame() stops
+ * at. While it is locked the CPU only sees HRAM, see bus_lock().
+ */
+extern int dmaActive;
+extern uint64_t dmaEndsAt; /* in cycleCount, DMA_NEVER when idle */
+
+void dma_start(uint8_t value);
+/* Run by the scheduler once cycleCount reaches dmaEndsAt */
+void dma_finish(void);
+/* Brings the lock back in line with dmaEndsAt after loading a state */
+void dma_restored(void);
+
+/* The only addresses the CPU can reach while a transfer runs */
+static inline int dma_bus_free(uint16_t addr) {
+    return (uint16_t)(addr - 0xFF80) < 0x7F;
+}
+
+#endif /* DMA_H */
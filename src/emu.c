@@ -19,20 +19,42 @@
 #include <SDL2/SDL_image.h>
 #include <inttypes.h>
 #include "resource_management.h"
+#include "savestate.h"
+#include "rewind.h"
+#include "input.h"
+#include "movie.h"
+#include "statehash.h"
+#include "blockcache.h"
+#include "jit.h"
+#include "aot.h"
+#include "opcodes.h"
+#include "core.h"
+#include "profile.h"
+#include "alu.h"
+#include "interrupts.h"
+#include "timer.h"
+#include "dma.h"
+#include "cgb.h"
+#include "serial.h"
+#include "callstack.h"
+#include "symbols.h"
+#include "emu.h"
 #include "defs.h"
 
 /* Cartridge Size, min 0xFFFF */
 #define CART_SIZE 0x1FFFFF
 
-#define CONTINUE_INVALID_OPCODE 0
+/* CPU cycles per frame (4.19 MHz / 60 FPS) */
+#define CYCLES_PER_FRAME 70224
 
 /* Global variables */
 SDL_Renderer* rend;
 int running = 1;
 uint8_t *emuRAM;
 uint16_t ri; /* The 16-bit register I */
-uint8_t keyPressed = 0;
 int cycle = 1;
+int rewinding = 0;
+emu_config emuConfig;
 
 /* Registers */
 uint16_t af = 0;
@@ -42,12 +64,6 @@ uint16_t hl = 0;
 uint16_t sp = 0xFFFE; /* stack pointer */
 uint16_t pc = 0x100;
 
-/* Condition codes */
-#define Z_FLAG 0x80
-#define N_FLAG 0x40
-#define H_FLAG 0x20
-#define C_FLAG 0x10
-
 /* LCD Status Registers */
 uint8_t ly = 0; /* Current scanline (LY register) */
 int ly_counter = 0; /* Counter to track cycles per scanline */
@@ -129,9 +145,51 @@ void render_old(void) {
     SDL_RenderPresent(rend);
 }
 
-void render(void) {
-    SDL_SetRenderDrawColor(rend, 0, 0, 0, 255);
-    SDL_RenderClear(rend);
+/* Shade (0-3) of every pixel of the last rendered frame, palette * 4 + colour on a CGB */
+uint8_t framebuffer[144][160];
+
+/*
+ * The CGB background. Each map entry has an attribute byte at the same
+ * spot in VRAM bank 1 picking the palette, the tile's bank and flips.
+ */
+static void render_framebuffer_cgb(void) {
+    const uint8_t *banks[2] = { cgb_vram(0), cgb_vram(1) };
+    uint8_t scx = emuRAM[0xFF43];
+    uint8_t scy = emuRAM[0xFF42];
+    int tileDataMode = (emuRAM[0xFF40] & 0x10) != 0;
+
+    for (int screenY = 0; screenY < 144; screenY++) {
+        uint8_t mapY = scy + screenY;
+        int mapRow = 0x1800 + (mapY / 8) * 32;
+        for (int screenX = 0; screenX < 160; screenX++) {
+            uint8_t mapX = scx + screenX;
+            uint8_t tileIndex = banks[0][mapRow + mapX / 8];
+            uint8_t attributes = banks[1][mapRow + mapX / 8];
+
+            /* Offsets into VRAM, same addressing modes as the DMG */
+            int tileAddr;
+            if (tileDataMode) {
+                tileAddr = tileIndex * 16;
+            } else {
+                tileAddr = tileIndex < 128 ? 0x1000 + tileIndex * 16 : (tileIndex - 128) * 16;
+            }
+            int tilePixelY = (attributes & 0x40) ? 7 - (mapY % 8) : mapY % 8;
+            int tilePixelX = (attributes & 0x20) ? 7 - (mapX % 8) : mapX % 8;
+            const uint8_t *tile = banks[(attributes >> 3) & 1] + tileAddr + tilePixelY * 2;
+
+            uint8_t bit1 = (tile[0] >> (7 - tilePixelX)) & 1;
+            uint8_t bit2 = (tile[1] >> (7 - tilePixelX)) & 1;
+            framebuffer[screenY][screenX] = (attributes & 0x07) * 4 + ((bit2 << 1) | bit1);
+        }
+    }
+}
+
+/* Draws the background into framebuffer, touches nothing in SDL */
+void render_framebuffer(void) {
+    if (cgbMode) {
+        render_framebuffer_cgb();
+        return;
+    }
 
     /* Game Boy screen dimensions */
     const int SCREEN_WIDTH = 160;
@@ -152,16 +210,24 @@ void render(void) {
     uint8_t lcdc = emuRAM[0xFF40]; /* LCDC (LCD Control) */
     bool tile_data_mode = (lcdc & 0x10) != 0; /* 0: 8800-97FF, 1: 8000-8FFF */
 
-    /* Iterate over the visible screen area (20x18 tiles) */
+    /* Background palette, color index -> shade */
+    uint8_t bgp = emuRAM[0xFF47]; /* BGP (Background Palette) */
+    uint8_t palette[4];
+    for (int i = 0; i < 4; i++) {
+        palette[i] = (bgp >> (i * 2)) & 0x03;
+    }
+
+    /* Walk each scanline a tile row (8 pixels) at a time */
     for (int screenY = 0; screenY < SCREEN_HEIGHT; screenY++) {
-        for (int screenX = 0; screenX < SCREEN_WIDTH; screenX++) {
-            /* Calculate the corresponding tile map coordinates */
-            int mapX = (scx + screenX) % (MAP_WIDTH * TILE_SIZE);
-            int mapY = (scy + screenY) % (MAP_HEIGHT * TILE_SIZE);
+        /* Calculate the corresponding tile map row */
+        int mapY = (scy + screenY) % (MAP_HEIGHT * TILE_SIZE);
+        const uint8_t *mapRow = &emuRAM[0x9800 + ((mapY / TILE_SIZE) * MAP_WIDTH)];
+        int tilePixelY = mapY % TILE_SIZE;
 
-            /* Calculate the tile index in the background map */
-            uint16_t mapAddr = 0x9800 + ((mapY / TILE_SIZE) * MAP_WIDTH) + (mapX / TILE_SIZE);
-            uint8_t tileIndex = emuRAM[mapAddr];
+        int mapX = scx;
+        int screenX = 0;
+        while (screenX < SCREEN_WIDTH) {
+            uint8_t tileIndex = mapRow[mapX / TILE_SIZE];
 
             /* Calculate the address of the tile data */
             uint16_t tileAddr;
@@ -177,31 +243,43 @@ void render(void) {
                 }
             }
 
-            /* Calculate the pixel position within the tile */
-            int tilePixelX = mapX % TILE_SIZE;
-            int tilePixelY = mapY % TILE_SIZE;
-
             /* Read the tile data (2 bytes per line) */
             uint8_t byte1 = emuRAM[tileAddr + (tilePixelY * 2)];
             uint8_t byte2 = emuRAM[tileAddr + (tilePixelY * 2) + 1];
 
-            /* Extract the color index for the pixel */
-            uint8_t bit1 = (byte1 >> (7 - tilePixelX)) & 1;
-            uint8_t bit2 = (byte2 >> (7 - tilePixelX)) & 1;
-            uint8_t colorIndex = (bit2 << 1) | bit1;
-
-            /* Map the color index to an actual color using the background palette */
-            uint8_t r, g, b;
-            uint8_t bgp = emuRAM[0xFF47]; /* BGP (Background Palette) */
-            switch ((bgp >> (colorIndex * 2)) & 0x03) {
-                case 0: r = 255; g = 255; b = 255; break; /* White */
-                case 1: r = 192; g = 192; b = 192; break; /* Light gray */
-                case 2: r = 96;  g = 96;  b = 96;  break; /* Dark gray */
-                case 3: r = 0;   g = 0;   b = 0;   break; /* Black */
+            /* Emit the rest of this tile's row */
+            for (int tilePixelX = mapX % TILE_SIZE; tilePixelX < TILE_SIZE && screenX < SCREEN_WIDTH; tilePixelX++) {
+                uint8_t bit1 = (byte1 >> (7 - tilePixelX)) & 1;
+                uint8_t bit2 = (byte2 >> (7 - tilePixelX)) & 1;
+                framebuffer[screenY][screenX] = palette[(bit2 << 1) | bit1];
+                screenX++;
+                mapX++;
             }
+            mapX %= MAP_WIDTH * TILE_SIZE;
+        }
+    }
+}
+
+void render(void) {
+    render_framebuffer();
+
+    SDL_SetRenderDrawColor(rend, 0, 0, 0, 255);
+    SDL_RenderClear(rend);
+
+    /* White, light gray, dark gray, black */
+    static const uint8_t shades[4] = { 255, 192, 96, 0 };
+    for (int screenY = 0; screenY < 144; screenY++) {
+        for (int screenX = 0; screenX < 160; screenX++) {
+            uint8_t pixel = framebuffer[screenY][screenX];
 
             /* Draw the pixel */
-            SDL_SetRenderDrawColor(rend, r, g, b, 255);
+            if (cgbMode) {
+                uint32_t rgb = bgPaletteRgb[pixel];
+                SDL_SetRenderDrawColor(rend, (rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF, 255);
+            } else {
+                uint8_t shade = shades[pixel];
+                SDL_SetRenderDrawColor(rend, shade, shade, shade, 255);
+            }
             SDL_RenderDrawPoint(rend, screenX, screenY);
         }
     }
@@ -209,2006 +287,2743 @@ void render(void) {
     SDL_RenderPresent(rend);
 }
 
-int interrupts_enabled = 1;
-int pending_vblank_interrupt = 0;
+/* I/O register writes that do more than store a byte */
+void io_write(uint16_t addr, uint8_t value) {
+    switch (addr) {
+        case 0xFF00: /* P1/JOYP */
+            joypad_write(value);
+            break;
+        case SB_ADDR: case SC_ADDR:
+            serial_write(addr, value);
+            break;
+        case IF_ADDR: /* The top three bits always read back set */
+            emuRAM[addr] = value | 0xE0;
+            interrupts_changed();
+            break;
+        case IE_ADDR:
+            emuRAM[addr] = value;
+            interrupts_changed();
+            break;
+        case DIV_ADDR: case TIMA_ADDR: case TMA_ADDR: case TAC_ADDR:
+            timer_write(addr, value);
+            break;
+        case DMA_ADDR:
+            dma_start(value);
+            break;
+        case 0xFF41: case 0xFF45: /* STAT and LYC move the next LYC=LY interrupt */
+            emuRAM[addr] = value;
+            ly_schedule();
+            break;
+        case KEY1_ADDR: case VBK_ADDR: case SVBK_ADDR:
+        case HDMA1_ADDR: case HDMA2_ADDR: case HDMA3_ADDR: case HDMA4_ADDR: case HDMA5_ADDR:
+        case BCPS_ADDR: case BCPD_ADDR: case OCPS_ADDR: case OCPD_ADDR:
+            cgb_write(addr, value);
+            break;
+        default:
+            emuRAM[addr] = value;
+            break;
+    }
+}
+
+/* Registers that are worked out when read, the rest are kept in emuRAM */
+uint8_t io_read(uint16_t addr) {
+    switch (addr) {
+        case DIV_ADDR: case TIMA_ADDR:
+            return timer_read(addr);
+        case 0xFF44: /* LY, gameboy-doctor logs are made with it stuck at $90 */
+            return emuConfig.tracePath && emuConfig.traceFormat != TRACE_DISASSEMBLY ? 0x90 : emuRAM[addr];
+        default:
+            return emuRAM[addr];
+    }
+}
+
+uint16_t busSlowBase = 0xFF00;
+uint16_t busSlowReads = 0x80;
+/* Stores to HRAM and IE take the slow way too */
+uint16_t busSlowWrites = 0x100;
 
-void handle_vblank_interrupt(void) {
-    printf("vblank interrupt\n");
-    /* Push PC onto the stack */
-    sp -= 2;
-    emuRAM[sp] = (pc >> 8) & 0xFF;
-    emuRAM[sp + 1] = pc & 0xFF;
+/* From 0xFFFF round to 0xFF7F, all but HRAM */
+void bus_lock(int locked) {
+    busSlowBase = locked ? 0xFFFF : 0xFF00;
+    busSlowReads = locked ? 0xFF81 : 0x80;
+    busSlowWrites = locked ? 0xFF81 : 0x100;
+}
 
-    /* Jump to the V-Blank interrupt handler (address 0x0040) */
-    pc = 0x0040;
+/* CPU tests want a flat 64KB, nothing behind any address but memory */
+void bus_flat(void) {
+    busSlowReads = 0;
+    busSlowWrites = 0;
+}
 
-    /* Clear the pending interrupt */
-    pending_vblank_interrupt = 0;
+/* Loads read_byte() cannot do from emuRAM */
+uint8_t bus_read(uint16_t addr) {
+    if (dmaActive && !dma_bus_free(addr)) {
+        return 0xFF; /* OAM DMA has the bus */
+    }
+    return addr >= 0xFF00 ? io_read(addr) : emuRAM[addr];
+}
 
-    /* Disable further interrupts until explicitly re-enabled */
-    interrupts_enabled = 0;
+/* Every CPU store goes through here */
+void write_byte(uint16_t addr, uint8_t value) {
+    if ((uint16_t)(addr - busSlowBase) < busSlowWrites) {
+        if (dmaActive && !dma_bus_free(addr)) {
+            return; /* OAM DMA has the bus */
+        }
+        code_pages_check_write(addr);
+        if (addr >= 0xFF00) {
+            io_write(addr, value);
+        } else {
+            emuRAM[addr] = value;
+        }
+        return;
+    }
+    code_pages_check_write(addr);
+    emuRAM[addr] = value;
+}
+
+/*
+ * Raises VBlank and the line based STAT interrupts as LY moves on. There
+ * are no PPU modes yet, so of the STAT sources only LYC=LY and the VBlank
+ * mode (bits 6 and 4 of 0xFF41) can fire.
+ */
+static void update_stat(void) {
+    uint8_t stat = emuRAM[0xFF41];
+    if (ly == emuRAM[0xFF45]) {
+        stat |= 0x04;
+        if (stat & 0x40) {
+            interrupt_request(INT_STAT);
+        }
+    } else {
+        stat &= ~0x04;
+    }
+    if (ly == 144) {
+        interrupt_request(INT_VBLANK);
+        if (stat & 0x10) {
+            interrupt_request(INT_STAT);
+        }
+    }
+    emuRAM[0xFF41] = stat;
 }
 
-void check_interrupts(void) {
-    if (interrupts_enabled) {
-        /* Check for pending interrupts and handle them */
-        if (pending_vblank_interrupt) {
-            handle_vblank_interrupt();
+/* When update_ly() next raises an interrupt, in cycleCount */
+static uint64_t lyEventAt;
+
+/*
+ * Finds the next line update_stat() raises something on: 144 for VBlank
+ * and the LYC=LY line when STAT has it enabled. Blocks and fused loops
+ * run to the next event, so without this they would carry on past it.
+ */
+void ly_schedule(void) {
+    uint8_t lyc = emuRAM[0xFF45];
+    int lines = (144 - ly + 154) % 154;
+    if (!lines) {
+        lines = 154;
+    }
+    if ((emuRAM[0xFF41] & 0x40) && lyc <= 153) {
+        int toLyc = (lyc - ly + 154) % 154;
+        if (toLyc && toLyc < lines) {
+            lines = toLyc;
         }
-        /* Add other interrupt checks here (e.g., LCD STAT, Timer, Serial, Joypad) */
     }
+    lyEventAt = cycleCount + ((uint64_t)(lines * 456 - ly_counter) << doubleSpeed);
+    schedule_update();
 }
 
 void update_ly(int cycles) {
     ly_counter += cycles;
-    if (ly_counter >= 456) { /* Each scanline takes 456 cycles */
+    while (ly_counter >= 456) { /* Each scanline takes 456 cycles */
         ly_counter -= 456;
         ly++;
         if (ly > 153) { /* Wrap around after 153 */
             ly = 0;
         }
         emuRAM[0xFF44] = ly; /* Update LY register in memory */
+        update_stat();
     }
 }
 
+/* Loading a state rewrites RAM behind the bus, drop code decoded from it */
+static void state_restored(void) {
+    code_pages_invalidate(SAVESTATE_RAM_START, 0xFFFF);
+    core_watch_sync();
+    callstack_sample_resync();
+}
+
+/* Quick save slot (F5 saves, F8 loads) */
+gb_savestate quickState;
+int hasQuickState = 0;
+/* F8 is off while a movie records or plays, a load would leave it behind */
+int quickLoadLocked = 0;
+
 void handle_events(void) {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) {
             running = 0;
+        } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F5) {
+            savestate_capture(&quickState);
+            hasQuickState = 1;
+        } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F8) {
+            if (hasQuickState && !quickLoadLocked) {
+                savestate_restore(&quickState);
+                state_restored();
+            }
+        } else if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.keysym.sym == SDLK_BACKSPACE) {
+            /* Rewind for as long as backspace is held */
+            rewinding = (event.type == SDL_KEYDOWN);
         } else if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
-            const char *key = SDL_GetKeyName(event.key.keysym.sym);
-            const char keyfast = *key;
-
+            SDL_Scancode scancode = event.key.keysym.scancode;
             if (event.type == SDL_KEYDOWN) {
                 cycle = 1; /* Resume emulation if paused */
-                if (keyfast == '1') keyPressed = 1;
-                else if (keyfast == '2') keyPressed = 2;
-                else if (keyfast == '3') keyPressed = 3;
-                else if (keyfast == '4') keyPressed = 12;
-                else if (keyfast == 'q') keyPressed = 4;
-                else if (keyfast == 'w') keyPressed = 5;
-                else if (keyfast == 'e') keyPressed = 6;
-                else if (keyfast == 'r') keyPressed = 13;
-                else if (keyfast == 'a') keyPressed = 7;
-                else if (keyfast == 's') keyPressed = 8;
-                else if (keyfast == 'd') keyPressed = 9;
-                else if (keyfast == 'f') keyPressed = 14;
-                else if (keyfast == 'z') keyPressed = 10;
-                else if (keyfast == 'x') keyPressed = 0;
-                else if (keyfast == 'c') keyPressed = 11;
-                else if (keyfast == 'v') keyPressed = 15;
-            } else if (event.type == SDL_KEYUP) {
-                /* Handle key releases if needed */
-                if (keyfast == '1' && keyPressed == 1) keyPressed = 0;
-                else if (keyfast == '2' && keyPressed == 2) keyPressed = 0;
-                /* Add other key mappings... */
+            }
+            if (scancode < 0 || scancode >= SDL_NUM_SCANCODES || !keymap[scancode]) {
+                continue;
+            }
+            if (event.type == SDL_KEYDOWN) {
+                joypad_set_buttons(joypadButtons | keymap[scancode]);
+            } else {
+                joypad_set_buttons(joypadButtons & ~keymap[scancode]);
             }
         }
     }
 }
 
-/* Dumb hack */
-uint16_t lastpc[64] = {0};
-int lastpccount;
-void signal_function_call(uint16_t pc) {
-    uint16_t lastpc2[64];
-    lastpc2[0] = pc;
-    memcpy((uint8_t *)lastpc2 + 2, lastpc, sizeof(lastpc2) - 2);
-    memcpy(lastpc, lastpc2, 128);
-}
-uint16_t signal_function_ret() {
-    uint16_t ret = lastpc[0];
-    memcpy(lastpc, (uint8_t *)lastpc + 2, sizeof(lastpc) - 2);
-    lastpc[63] = 0;
-    return ret;
-}
-
-int execute_instruction(void) {
-    if (!cycle) {
-        return 0; /* Emulation is paused */
-    }
+/* Opcode handlers, called with PC already past the instruction */
 
-    /* Fetch and execute instruction */
-    /* https://gbdev.io/gb-opcodes/optables/ */
-    uint8_t instr = emuRAM[pc];
-    pc++;
-    /* printf("instr: %02x (%02x)\n", instr, pc); */
+/*
+ * Their cycles come from SM83_OPCODES as constants, OP_CYCLES(20) is the
+ * 20 row's cycles and OP_BRANCH_CYCLES(20) its branchCycles, taken when
+ * the condition holds.
+ */
+#define OP_CYCLE_CONSTANTS(hex, mnemonic, length, cycles, branchCycles, flags) \
+    OP_CYCLES_##hex = cycles, OP_BRANCH_CYCLES_##hex = branchCycles,
+enum {
+    SM83_OPCODES(OP_CYCLE_CONSTANTS)
+};
+#define OP_CYCLES(hex) OP_CYCLES_##hex
+#define OP_BRANCH_CYCLES(hex) OP_BRANCH_CYCLES_##hex
+
+/* NOP */
+int op_00(uint16_t imm) {
+    return OP_CYCLES(00);
+}
 
-    switch (instr) {
-        case 0x00: /* NOP */
-            return 4;
+/* LD BC, n16 */
+int op_01(uint16_t imm) {
+    uint16_t n16 = imm; /* Read the 16-bit immediate value */
+    bc = n16; /* Load n16 into BC */
+    return OP_CYCLES(01);
+}
 
-        case 0x01: /* LD BC, n16 */
-            {
-                uint16_t n16 = (emuRAM[pc + 1] << 8) | emuRAM[pc]; /* Read the 16-bit immediate value */
-                pc += 2;
-                bc = n16; /* Load n16 into BC */
-            }
-            return 12;
+/* LD [BC], A */
+int op_02(uint16_t imm) {
+    write_byte(bc, (af >> 8) & 0xFF); /* Store A at the address in BC */
+    return OP_CYCLES(02);
+}
 
-        case 0x02: /* LD [BC], A */
-            {
-                emuRAM[bc] = (af >> 8) & 0xFF; /* Store A at the address in BC */
-            }
-            return 8;
-
-        case 0x03: /* INC BC */
-            bc++;
-            return 8;
-
-        case 0x04: /* INC B */
-            {
-                uint8_t b = ((bc >> 8) & 0xFF) + 1;
-                set_flag(Z_FLAG, b == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (b & 0x0F) == 0);
-                bc = (b << 8) | (bc & 0x00FF);
-            }
-            return 4;
-
-        case 0x05: /* DEC B */
-            {
-                uint8_t b = (bc >> 8) & 0xFF;
-                b--;
-                set_flag(Z_FLAG, b == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (b & 0x0F) == 0x0F);
-                bc = (b << 8) | (bc & 0x00FF);
-            }
-            return 4;
-
-        case 0x06: /* LD B, n8 */
-            bc = (bc & 0x00FF) | (emuRAM[pc] << 8);
-            pc++;
-            return 8;
-
-        case 0x07: /* RLCA */
-            {
-                uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
-                uint8_t new_carry = (a >> 7) & 0x01; /* Get the bit that will be shifted into the carry flag */
-                a = (a << 1) | new_carry; /* Perform the rotation */
-                set_flag(C_FLAG, new_carry);
-                set_flag(Z_FLAG, 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 0);
-                af = (a << 8) | (af & 0x00FF); /* Update A in the AF register */
-            }
-            return 4;
+/* INC BC */
+int op_03(uint16_t imm) {
+    bc++;
+    return OP_CYCLES(03);
+}
 
-        case 0x08: /* LD [a16], SP */
-            {
-                uint16_t address = emuRAM[pc] | (emuRAM[pc + 1] << 8); /* Read the 16-bit address */
-                pc += 2;
+/* INC B */
+int op_04(uint16_t imm) {
+    bc = (alu_inc(bc >> 8) << 8) | (bc & 0x00FF);
+    return OP_CYCLES(04);
+}
 
-                /* Store the low byte of SP at the address */
-                emuRAM[address] = sp & 0xFF;
-                /* Store the high byte of SP at the address + 1 */
-                emuRAM[address + 1] = (sp >> 8) & 0xFF;
-            }
-            return 20;
-
-        case 0x09: /* ADD HL, BC */
-            {
-                uint32_t result = hl + bc;
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (hl & 0x0FFF) + (bc & 0x0FFF) > 0x0FFF);
-                set_flag(C_FLAG, result > 0xFFFF);
-                hl = result & 0xFFFF;
-            }
-            return 8;
+/* DEC B */
+int op_05(uint16_t imm) {
+    bc = (alu_dec(bc >> 8) << 8) | (bc & 0x00FF);
+    return OP_CYCLES(05);
+}
 
-        case 0x0A: /* LD A, [BC] */
-            {
-                uint8_t value = emuRAM[bc];
-                af = (value << 8) | (af & 0x00FF); 
-            }
-            return 8;
-
-        case 0x0B: /* DEC BC */
-            bc--;
-            return 8;
-
-        case 0x0C: /* INC C */
-            {
-                uint8_t c = (bc & 0xFF) + 1;
-                set_flag(Z_FLAG, c == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (c & 0x0F) == 0);
-                bc = (bc & 0xFF00) | c;
-            }
-            return 4;
-
-        case 0x0D: /* DEC C */
-            {
-                uint8_t c = bc & 0xFF;
-                c--;
-                set_flag(Z_FLAG, c == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (c & 0x0F) == 0x0F);
-                bc = (bc & 0xFF00) | c;
-            }
-            return 4;
-
-        case 0x0E: /* LD C, n8 */
-            bc = (bc & 0xFF00) | emuRAM[pc];
-            pc++;
-            return 8;
-
-        case 0x0F: /* RRCA */
-            {
-                uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
-                uint8_t new_carry = a & 0x01; /* Get the bit that will be shifted into the carry flag */
-                a = (a >> 1) | (new_carry << 7); /* Perform the rotation */
-                set_flag(C_FLAG, new_carry);
-                set_flag(Z_FLAG, 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 0);
-                af = (a << 8) | (af & 0x00FF); /* Update A in the AF register */
-            }
-            return 4;
-
-        case 0x10: /* STOP n8 */
-            {
-                /* TODO: Finish stop instruction */
-                pc++;
-                /* Halt the CPU until an interrupt occurs */
-                /* STOP not yet implemented, for now just log it */
-                printf("STOP instruction executed. Waiting for interrupt.\n");
-            }
-            return 4;
+/* LD B, n8 */
+int op_06(uint16_t imm) {
+    bc = (bc & 0x00FF) | (imm << 8);
+    return OP_CYCLES(06);
+}
 
-        case 0x11: /* LD DE, n16 */
-            de = (emuRAM[pc + 1] << 8) | emuRAM[pc];
-            pc += 2;
-            return 12;
+/* RLCA */
+int op_07(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
+    uint8_t new_carry = (a >> 7) & 0x01; /* Get the bit that will be shifted into the carry flag */
+    a = (a << 1) | new_carry; /* Perform the rotation */
+    set_flag(C_FLAG, new_carry);
+    set_flag(Z_FLAG, 0);
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, 0);
+    af = (a << 8) | (af & 0x00FF); /* Update A in the AF register */
+    return OP_CYCLES(07);
+}
 
-        case 0x12: /* LD [DE], A */
-            {
-                emuRAM[de] = (af >> 8) & 0xFF; /* Store A at the address in BC */
-            }
-            return 8;
-
-        case 0x13: /* INC DE */
-            de++;
-            return 8;
-
-        case 0x14: /* INC D */
-            {
-                uint8_t d = ((de >> 8) & 0xFF) + 1;
-                set_flag(Z_FLAG, d == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (d & 0x0F) == 0);
-                de = (d << 8) | (de & 0x00FF);
-            }
-            return 4;
-
-        case 0x15: /* DEC D */
-            {
-                uint8_t d = ((de >> 8) & 0xFF) - 1;
-                set_flag(Z_FLAG, d == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (d & 0x0F) == 0x0F);
-                de = (d << 8) | (de & 0x00FF);
-            }
-            return 4;
+/* LD [a16], SP */
+int op_08(uint16_t imm) {
+    uint16_t address = imm; /* Read the 16-bit address */
 
-        case 0x16: /* LD D, n8 */
-            {
-                uint8_t n8 = emuRAM[pc]; /* Read the 8-bit immediate value */
-                pc++;
-                de = (de & 0x00FF) | (n8 << 8); /* Load n8 into D (upper 8 bits of DE) */
-            }
-            return 8;
-
-        case 0x17: /* RLA */
-            {
-                uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
-                uint8_t old_carry = get_flag(C_FLAG); /* Get the current carry flag */
-                uint8_t new_carry = (a >> 7) & 0x01; /* Get the bit that will be shifted into the carry flag */
-                a = (a << 1) | old_carry; /* Perform the rotation */
-                set_flag(C_FLAG, new_carry);
-                set_flag(Z_FLAG, 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 0);
-                af = (a << 8) | (af & 0x00FF); /* Update A in the AF register */
-            }
-            return 4;
+    /* Store the low byte of SP at the address */
+    write_byte(address, sp & 0xFF);
+    /* Store the high byte of SP at the address + 1 */
+    write_byte(address + 1, (sp >> 8) & 0xFF);
+    return OP_CYCLES(08);
+}
 
-        case 0x18: /* JR e8 */
-            {
-                int8_t e8 = emuRAM[pc]; /* Read the signed 8-bit offset */
-                pc++; /* Move past the offset byte */
-        
-                /* Add the signed offset to the current pc */
-                pc += e8; /* This will jump relative to the current program counter */
-            }
-            return 12;
-
-        case 0x19: /* ADD HL, DE */
-            {
-                uint32_t result = hl + de;
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (hl & 0x0FFF) + (de & 0x0FFF) > 0x0FFF);
-                set_flag(C_FLAG, result > 0xFFFF);
-                hl = result & 0xFFFF; /* Store lower 16 bits in HL */
-            }
-            return 8;
-
-        case 0x1A: /* LD A, [DE] */
-            af = (af & 0x00FF) | (emuRAM[de] << 8);
-            return 8;
-
-        case 0x1B: /* DEC DE */
-            de--;
-            return 8;
-
-        case 0x1C: /* INC E */
-            {
-                uint8_t e = (de & 0xFF) + 1;
-                set_flag(Z_FLAG, e == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (e & 0x0F) == 0);
-                de = (de & 0xFF00) | e;
-            }
-            return 4;
-
-        case 0x1D: /* DEC E */
-            {
-                uint8_t e = (de & 0xFF) - 1;
-                set_flag(Z_FLAG, e == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (e & 0x0F) == 0x0F);
-                de = (de & 0xFF00) | e;
-            }
-            return 4;
-
-        case 0x1E: /* LD E, n8 */
-            de = (de & 0xFF00) | emuRAM[pc];
-            pc++;
-            return 8;
-
-        case 0x1F: /* RRA */
-            {
-                uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
-                uint8_t old_carry = get_flag(C_FLAG);
-                uint8_t new_carry = a & 0x01;
-                a = (a >> 1) | (old_carry << 7);
-                set_flag(C_FLAG, new_carry);
-                set_flag(Z_FLAG, 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 0);
-                af = (a << 8) | (af & 0x00FF); /* Update A in the AF register */
-            }
-            return 4;
+/* ADD HL, BC */
+int op_09(uint16_t imm) {
+    uint32_t result = hl + bc;
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, (hl & 0x0FFF) + (bc & 0x0FFF) > 0x0FFF);
+    set_flag(C_FLAG, result > 0xFFFF);
+    hl = result & 0xFFFF;
+    return OP_CYCLES(09);
+}
 
-        case 0x20: /* JR NZ, e8 */
-            if (!get_flag(Z_FLAG)) {
-                int8_t offset = (int8_t)emuRAM[pc];
-                pc += offset;
-            }
-            pc++;
-            return 12;
-
-        case 0x21: /* LD HL, n16 */
-            hl = (emuRAM[pc + 1] << 8) | emuRAM[pc];
-            pc += 2;
-            return 12;
-
-        case 0x22: /* LD [HL+], A */
-            emuRAM[hl] = (af >> 8) & 0xFF;
-            hl++;
-            return 8;
-
-        case 0x23: /* INC HL */
-            hl++;
-            return 8;
-
-        case 0x24: /* INC H */
-            {
-                uint8_t h = ((hl >> 8) & 0xFF) + 1;
-                set_flag(Z_FLAG, h == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (h & 0x0F) == 0);
-                hl = (h << 8) | (hl & 0x00FF);
-            }
-            return 4;
-
-        case 0x25: /* DEC H */
-            {
-                uint8_t h = ((hl >> 8) & 0xFF) - 1;
-                set_flag(Z_FLAG, h == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (h & 0x0F) == 0x0F);
-                hl = (h << 8) | (hl & 0x00FF);
-            }
-            return 4;
+/* LD A, [BC] */
+int op_0a(uint16_t imm) {
+    uint8_t value = read_byte(bc);
+    af = (value << 8) | (af & 0x00FF); 
+    return OP_CYCLES(0a);
+}
 
-        case 0x26: /* LD H, n8 */
-            {
-                uint8_t n8 = emuRAM[pc];
-                pc++;
-                hl = (hl & 0x00FF) | (n8 << 8);
-            }
-            return 8;
+/* DEC BC */
+int op_0b(uint16_t imm) {
+    bc--;
+    return OP_CYCLES(0b);
+}
 
-        case 0x27: /* DAA */
-            {
-                uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
-                uint8_t correction = 0;
-                uint8_t carry = 0;
+/* INC C */
+int op_0c(uint16_t imm) {
+    bc = (bc & 0xFF00) | alu_inc(bc & 0xFF);
+    return OP_CYCLES(0c);
+}
 
-                if (get_flag(H_FLAG) || (!get_flag(N_FLAG) && (a & 0x0F) > 9)) {
-                    correction |= 0x06; /* Adjust lower nibble */
-                }
-                if (get_flag(C_FLAG) || (!get_flag(N_FLAG) && a > 0x99)) {
-                    correction |= 0x60; /* Adjust upper nibble */
-                    carry = 1; /* Set carry flag */
-                }
+/* DEC C */
+int op_0d(uint16_t imm) {
+    bc = (bc & 0xFF00) | alu_dec(bc & 0xFF);
+    return OP_CYCLES(0d);
+}
 
-                if (get_flag(N_FLAG)) {
-                    a -= correction; /* Adjust for subtraction */
-                } else {
-                    a += correction; /* Adjust for addition */
-                }
+/* LD C, n8 */
+int op_0e(uint16_t imm) {
+    bc = (bc & 0xFF00) | imm;
+    return OP_CYCLES(0e);
+}
 
-                set_flag(C_FLAG, carry); /* Update carry flag */
-                set_flag(Z_FLAG, a == 0); /* Update zero flag */
-                set_flag(H_FLAG, 0); /* Reset half-carry flag */
-                af = (a << 8) | (af & 0x00FF); /* Update A in the AF register */
-            }
-            return 4;
+/* RRCA */
+int op_0f(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
+    uint8_t new_carry = a & 0x01; /* Get the bit that will be shifted into the carry flag */
+    a = (a >> 1) | (new_carry << 7); /* Perform the rotation */
+    set_flag(C_FLAG, new_carry);
+    set_flag(Z_FLAG, 0);
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, 0);
+    af = (a << 8) | (af & 0x00FF); /* Update A in the AF register */
+    return OP_CYCLES(0f);
+}
 
-        case 0x28: /* JR Z, e8 */
-            {
-                int8_t offset = (int8_t)emuRAM[pc]; /* Read the signed 8-bit offset */
-                pc++;
+/* STOP n8 */
+int op_10(uint16_t imm) {
+    if (cgb_speed_switch()) {
+        return OP_CYCLES(10);
+    }
+    /* TODO: Finish stop instruction */
+    /* Halt the CPU until an interrupt occurs */
+    /* STOP not yet implemented, for now just log it */
+    PMLog(LOG_INFO, "STOP instruction executed. Waiting for interrupt.\n");
+    return OP_CYCLES(10);
+}
 
-                if (get_flag(Z_FLAG)) { /* Check if the Zero flag is set */
-                    pc += offset; /* Add the offset to the program counter */
-                    return 12;
-                } else {
-                    return 8;
-                }
-            }
+/* LD DE, n16 */
+int op_11(uint16_t imm) {
+    de = imm;
+    return OP_CYCLES(11);
+}
 
-        case 0x29: /* ADD HL, HL */
-            {
-                uint32_t result = hl + hl;
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (hl & 0x0FFF) + (hl & 0x0FFF) > 0x0FFF);
-                set_flag(C_FLAG, result > 0xFFFF);
-                hl = result & 0xFFFF; /* Store lower 16 bits in HL */
-            }
-            return 8;
-
-        case 0x2A: /* LD A, [HL+] */
-            af = (af & 0x00FF) | (emuRAM[hl] << 8);
-            hl++;
-            return 8;
-
-        case 0x2B: /* DEC HL */
-            hl--;
-            return 8;
-
-        case 0x2C: /* INC L */
-            {
-                uint8_t l = (hl & 0xFF) + 1;
-                set_flag(Z_FLAG, l == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (l & 0x0F) == 0);
-                hl = (hl & 0xFF00) | l;
-            }
-            return 4;
-
-        case 0x2D: /* DEC L */
-            {
-                uint8_t l = (hl & 0xFF) - 1; /* Decrement L */
-                set_flag(Z_FLAG, l == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (l & 0x0F) == 0x0F); /* Set if borrow from bit 4 */
-                hl = (hl & 0xFF00) | l; /* Update L in HL */
-            }
-            return 4;
-
-        case 0x2E: /* LD L, n8 */
-            hl = (hl & 0xFF00) | emuRAM[pc];
-            pc++;
-            return 8;
-
-        case 0x2F: /* CPL */
-            {
-                uint8_t a = (af >> 8) & 0xFF; /* Get the value of A */
-                a = ~a; /* Complement A */
-                af = (af & 0x00FF) | (a << 8); /* Store the result in A */
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, 1);
-            }
-            return 4;
+/* LD [DE], A */
+int op_12(uint16_t imm) {
+    write_byte(de, (af >> 8) & 0xFF); /* Store A at the address in BC */
+    return OP_CYCLES(12);
+}
 
-        case 0x30: /* JR NC, e8 */
-            {
-                int8_t offset = (int8_t)emuRAM[pc]; /* Read the signed 8-bit offset */
-                pc++;
+/* INC DE */
+int op_13(uint16_t imm) {
+    de++;
+    return OP_CYCLES(13);
+}
 
-                if (!get_flag(C_FLAG)) { /* Check if the Carry flag is NOT set */
-                    pc += offset; /* Add the offset to the program counter */
-                    return 12;
-                } else {
-                    return 8;
-                }
-            }
+/* INC D */
+int op_14(uint16_t imm) {
+    de = (alu_inc(de >> 8) << 8) | (de & 0x00FF);
+    return OP_CYCLES(14);
+}
 
-        case 0x31: /* LD [HL+], A */
-            emuRAM[hl] = (af >> 8) & 0xFF;
-            hl++;
-            pc += 2;
-            return 8;
-
-        case 0x32: /* LD [HL-], A */
-            emuRAM[hl] = (af >> 8) & 0xFF;
-            hl--;
-            return 8;
-
-        case 0x33: /* INC SP */
-            sp++;
-            return 8;
-
-        case 0x34: /* INC [HL] */
-            {
-                uint8_t value = emuRAM[hl] + 1; /* Increment the value at [HL] */
-                set_flag(Z_FLAG, value == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (value & 0x0F) == 0); /* Set if carry from bit 3 */
-                emuRAM[hl] = value; /* Store the updated value back to [HL] */
-            }
-            return 12;
-
-        case 0x35: /* DEC [HL] */
-            {
-                uint8_t value = emuRAM[hl] - 1;
-                set_flag(Z_FLAG, value == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (value & 0x0F) == 0x0F);
-                emuRAM[hl] = value;
-            }
-            return 12;
+/* DEC D */
+int op_15(uint16_t imm) {
+    de = (alu_dec(de >> 8) << 8) | (de & 0x00FF);
+    return OP_CYCLES(15);
+}
 
-        case 0x36: /* LD [HL], n8 */
-            {
-                uint8_t n8 = emuRAM[pc];
-                pc++;
-                emuRAM[hl] = n8;
-            }
-            return 12;
+/* LD D, n8 */
+int op_16(uint16_t imm) {
+    uint8_t n8 = imm; /* Read the 8-bit immediate value */
+    de = (de & 0x00FF) | (n8 << 8); /* Load n8 into D (upper 8 bits of DE) */
+    return OP_CYCLES(16);
+}
 
-        case 0x37: /* SCF */
-            {
-                set_flag(C_FLAG, 1);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 0);
-            }
-            return 4;
+/* RLA */
+int op_17(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
+    uint8_t old_carry = get_flag(C_FLAG); /* Get the current carry flag */
+    uint8_t new_carry = (a >> 7) & 0x01; /* Get the bit that will be shifted into the carry flag */
+    a = (a << 1) | old_carry; /* Perform the rotation */
+    set_flag(C_FLAG, new_carry);
+    set_flag(Z_FLAG, 0);
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, 0);
+    af = (a << 8) | (af & 0x00FF); /* Update A in the AF register */
+    return OP_CYCLES(17);
+}
 
-        case 0x38: /* JR C, e8 */
-            {
-                uint8_t e8 = emuRAM[pc];
-                pc++;
+/* JR e8 */
+int op_18(uint16_t imm) {
+    int8_t e8 = imm; /* Read the signed 8-bit offset */
         
-                if (get_flag(C_FLAG)) {
-                    pc += (int8_t)e8;
-                }
-            }
-            return 12;
-
-        case 0x39: /* ADD HL, SP */
-            {
-                uint32_t result = hl + sp;
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (hl & 0x0FFF) + (sp & 0x0FFF) > 0x0FFF);
-                set_flag(C_FLAG, result > 0xFFFF);
-                hl = result & 0xFFFF; /* Store lower 16 bits in HL */
-            }
-            return 8;
+    /* Add the signed offset to the current pc */
+    pc += e8; /* This will jump relative to the current program counter */
+    return OP_CYCLES(18);
+}
 
-        case 0x3A: /* LD A, [HL-] */
-            {
-                uint8_t value = emuRAM[hl];
-                af = (value << 8) | (af & 0x00FF);
-                hl--;
-            }
-            return 8;
-
-        case 0x3B: /* DEC SP */
-            sp--;
-            return 8;
-
-        case 0x3C: /* INC A */
-            {
-                uint8_t a = ((af >> 8) & 0xFF) + 1;
-                set_flag(Z_FLAG, a == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (a & 0x0F) == 0);
-                af = (a << 8) | (af & 0x00FF);
-            }
-            return 4;
-
-        case 0x3D: /* DEC A */
-            {
-                uint8_t a = ((af >> 8) & 0xFF) - 1;
-                set_flag(Z_FLAG, a == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (a & 0x0F) == 0x0F);
-                af = (a << 8) | (af & 0x00FF);
-            }
-            return 4;
-
-        case 0x3E: /* LD A, n8 */
-            af = (af & 0x00FF) | (emuRAM[pc] << 8);
-            pc++;
-            return 8;
-
-        case 0x3F: /* CCF */
-            {
-                uint8_t current_c_flag = get_flag(C_FLAG);
-                set_flag(C_FLAG, !current_c_flag); /* Complement the carry flag */
-                set_flag(N_FLAG, 0); /* Reset the subtract flag */
-                set_flag(H_FLAG, 0); /* Reset the half-carry flag */
-            }
-            return 4;
+/* ADD HL, DE */
+int op_19(uint16_t imm) {
+    uint32_t result = hl + de;
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, (hl & 0x0FFF) + (de & 0x0FFF) > 0x0FFF);
+    set_flag(C_FLAG, result > 0xFFFF);
+    hl = result & 0xFFFF; /* Store lower 16 bits in HL */
+    return OP_CYCLES(19);
+}
 
-        case 0x40: /* LD B, B */
-            /* TODO: This is stupid */
-            printf("called 40 instruction\n");
-            return 4;
+/* LD A, [DE] */
+int op_1a(uint16_t imm) {
+    af = (af & 0x00FF) | (read_byte(de) << 8);
+    return OP_CYCLES(1a);
+}
 
-        case 0x42: /* LD B, D */
-            {
-                uint8_t d = (de >> 8) & 0xFF;
-                bc = (bc & 0x00FF) | (d << 8);
-            }
-            return 4;
+/* DEC DE */
+int op_1b(uint16_t imm) {
+    de--;
+    return OP_CYCLES(1b);
+}
 
-        case 0x44: /* LD B, H */
-            {
-                uint8_t h = (hl >> 8) & 0xFF;
-                bc = (bc & 0x00FF) | (h << 8);
-            }
-            return 4;
+/* INC E */
+int op_1c(uint16_t imm) {
+    de = (de & 0xFF00) | alu_inc(de & 0xFF);
+    return OP_CYCLES(1c);
+}
 
-        case 0x46: /* LD B, [HL] */
-            {
-                uint8_t value = emuRAM[hl]; /* Read value from memory at address HL */
-                bc = (value << 8) | (bc & 0x00FF); /* Load value into B */
-            }
-            return 8;
+/* DEC E */
+int op_1d(uint16_t imm) {
+    de = (de & 0xFF00) | alu_dec(de & 0xFF);
+    return OP_CYCLES(1d);
+}
 
-        case 0x47: /* LD B, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                bc = (bc & 0x00FF) | (a << 8);
-            }
-            return 4;
+/* LD E, n8 */
+int op_1e(uint16_t imm) {
+    de = (de & 0xFF00) | imm;
+    return OP_CYCLES(1e);
+}
 
-        case 0x4E: /* LD C, [HL] */
-            {
-                uint8_t value = emuRAM[hl]; /* Read value from memory at address HL */
-                bc = (bc & 0xFF00) | value; /* Load value into C */
-            }
-            return 8;
+/* RRA */
+int op_1f(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
+    uint8_t old_carry = get_flag(C_FLAG);
+    uint8_t new_carry = a & 0x01;
+    a = (a >> 1) | (old_carry << 7);
+    set_flag(C_FLAG, new_carry);
+    set_flag(Z_FLAG, 0);
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, 0);
+    af = (a << 8) | (af & 0x00FF); /* Update A in the AF register */
+    return OP_CYCLES(1f);
+}
 
-        case 0x4F: /* LD C, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                bc = (bc & 0xFF00) | a;
-            }
-            return 4;
+/* JR NZ, e8 */
+int op_20(uint16_t imm) {
+    if (!get_flag(Z_FLAG)) {
+        int8_t offset = (int8_t)imm;
+        pc += offset;
+        return OP_BRANCH_CYCLES(20);
+    }
+    return OP_CYCLES(20);
+}
 
-        case 0x50: /* LD D, B */
-            {
-                uint8_t b = (bc >> 8) & 0xFF;
-                de = (de & 0x00FF) | (b << 8);
-            }
-            return 4;
+/* LD HL, n16 */
+int op_21(uint16_t imm) {
+    hl = imm;
+    return OP_CYCLES(21);
+}
 
-        case 0x53: /* LD D, E */
-            {
-                uint8_t e = de & 0xFF;
-                de = (de & 0x00FF) | (e << 8);
-            }
-            return 4;
+/* LD [HL+], A */
+int op_22(uint16_t imm) {
+    write_byte(hl, (af >> 8) & 0xFF);
+    hl++;
+    return OP_CYCLES(22);
+}
 
-        case 0x54: /* LD D, H */
-            {
-                uint8_t h = (hl >> 8) & 0xFF;
-                de = (de & 0x00FF) | (h << 8);
-            }
-            return 4;
+/* INC HL */
+int op_23(uint16_t imm) {
+    hl++;
+    return OP_CYCLES(23);
+}
 
-        case 0x56: /* LD D, [HL] */
-            {
-                uint8_t value = emuRAM[hl]; /* Read value from memory at address HL */
-                de = (value << 8) | (de & 0x00FF); /* Load value into D */
-            }
-            return 8;
+/* INC H */
+int op_24(uint16_t imm) {
+    hl = (alu_inc(hl >> 8) << 8) | (hl & 0x00FF);
+    return OP_CYCLES(24);
+}
 
-        case 0x57: /* LD D, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                de = (de & 0x00FF) | (a << 8);
-            }
-            return 4;
+/* DEC H */
+int op_25(uint16_t imm) {
+    hl = (alu_dec(hl >> 8) << 8) | (hl & 0x00FF);
+    return OP_CYCLES(25);
+}
 
-        case 0x58: /* LD E, B */
-            {
-                uint8_t b = (bc >> 8) & 0xFF;
-                de = (de & 0xFF00) | b;
-            }
-            return 4;
+/* LD H, n8 */
+int op_26(uint16_t imm) {
+    uint8_t n8 = imm;
+    hl = (hl & 0x00FF) | (n8 << 8);
+    return OP_CYCLES(26);
+}
 
-        case 0x59: /* LD E, C */
-            {
-                uint8_t c = bc & 0xFF;
-                de = (de & 0xFF00) | c;
-            }
-            return 4;
+/* DAA */
+int op_27(uint16_t imm) {
+    alu_daa();
+    return OP_CYCLES(27);
+}
 
-        case 0x5A: /* LD E, D */
-            {
-                uint8_t d = (de >> 8) & 0xFF;
-                de = (de & 0xFF00) | d;
-            }
-            return 4;
+/* JR Z, e8 */
+int op_28(uint16_t imm) {
+    int8_t offset = (int8_t)imm; /* Read the signed 8-bit offset */
 
-        case 0x5E: /* LD E, [HL] */
-            {
-                uint8_t value = emuRAM[hl]; /* Read value from memory at address HL */
-                de = (de & 0xFF00) | value; /* Load value into E */
-            }
-            return 8;
+    if (get_flag(Z_FLAG)) { /* Check if the Zero flag is set */
+        pc += offset; /* Add the offset to the program counter */
+        return OP_BRANCH_CYCLES(28);
+    } else {
+        return OP_CYCLES(28);
+    }
+}
 
-        case 0x5F: /* LD E, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                de = (de & 0xFF00) | a;
-            }
-            return 4;
+/* ADD HL, HL */
+int op_29(uint16_t imm) {
+    uint32_t result = hl + hl;
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, (hl & 0x0FFF) + (hl & 0x0FFF) > 0x0FFF);
+    set_flag(C_FLAG, result > 0xFFFF);
+    hl = result & 0xFFFF; /* Store lower 16 bits in HL */
+    return OP_CYCLES(29);
+}
 
-        case 0x60: /* LD H, B */
-            {
-                uint8_t b = (bc >> 8) & 0xFF;
-                hl = (hl & 0x00FF) | (b << 8);
-            }
-            return 4;
+/* LD A, [HL+] */
+int op_2a(uint16_t imm) {
+    af = (af & 0x00FF) | (read_byte(hl) << 8);
+    hl++;
+    return OP_CYCLES(2a);
+}
 
-        case 0x66: /* LD H, [HL] */
-            {
-                uint8_t value = emuRAM[hl]; /* Read value from memory at address HL */
-                hl = (value << 8) | (hl & 0x00FF); /* Load value into H */
-            }
-            return 8;
+/* DEC HL */
+int op_2b(uint16_t imm) {
+    hl--;
+    return OP_CYCLES(2b);
+}
 
-        case 0x67: /* LD H, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                hl = (hl & 0x00FF) | (a << 8);
-            }
-            return 4;
+/* INC L */
+int op_2c(uint16_t imm) {
+    hl = (hl & 0xFF00) | alu_inc(hl & 0xFF);
+    return OP_CYCLES(2c);
+}
 
-        case 0x6B: /* LD H, E */
-            {
-                uint8_t e = de & 0xFF;
-                hl = (hl & 0x00FF) | (e << 8);
-            }
-            return 4;
+/* DEC L */
+int op_2d(uint16_t imm) {
+    hl = (hl & 0xFF00) | alu_dec(hl & 0xFF);
+    return OP_CYCLES(2d);
+}
 
-        case 0x6D: /* LD L, L */
-            /* TODO: This is stupid */
-            printf("called 6d instruction\n");
-            return 4;
+/* LD L, n8 */
+int op_2e(uint16_t imm) {
+    hl = (hl & 0xFF00) | imm;
+    return OP_CYCLES(2e);
+}
 
-        case 0x6E: /* LD L, [HL] */
-            {
-                uint8_t value = emuRAM[hl]; /* Read value from memory at address HL */
-                hl = (hl & 0xFF00) | value; /* Load value into L */
-            }
-            return 8;
+/* CPL */
+int op_2f(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF; /* Get the value of A */
+    a = ~a; /* Complement A */
+    af = (af & 0x00FF) | (a << 8); /* Store the result in A */
+    set_flag(N_FLAG, 1);
+    set_flag(H_FLAG, 1);
+    return OP_CYCLES(2f);
+}
 
-        case 0x6F: /* LD L, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                hl = (hl & 0xFF00) | a;
-            }
-            return 4;
+/* JR NC, e8 */
+int op_30(uint16_t imm) {
+    int8_t offset = (int8_t)imm; /* Read the signed 8-bit offset */
 
-        case 0x70: /* LD [HL], B */
-            {
-                uint8_t b = (bc >> 8) & 0xFF;
-                emuRAM[hl] = b; /* Store B at the memory address pointed to by HL */
-            }
-            return 8;
+    if (!get_flag(C_FLAG)) { /* Check if the Carry flag is NOT set */
+        pc += offset; /* Add the offset to the program counter */
+        return OP_BRANCH_CYCLES(30);
+    } else {
+        return OP_CYCLES(30);
+    }
+}
 
-        case 0x74: /* LD [HL], H */
-            {
-                uint8_t h = (hl >> 8) & 0xFF;
-                emuRAM[hl] = h; /* Store H at the memory address pointed to by HL */
-            }
-            return 8;
+/* LD SP, n16 */
+int op_31(uint16_t imm) {
+    sp = imm;
+    return OP_CYCLES(31);
+}
 
-        case 0x75: /* LD [HL], L */
-            {
-                uint8_t l = hl & 0xFF;
-                emuRAM[hl] = l; /* Store L at the memory address pointed to by HL */
-            }
-            return 8;
+/* LD [HL-], A */
+int op_32(uint16_t imm) {
+    write_byte(hl, (af >> 8) & 0xFF);
+    hl--;
+    return OP_CYCLES(32);
+}
 
-        case 0x77: /* LD [HL], A */
-            emuRAM[hl] = (af >> 8) & 0xFF;
-            return 8;
+/* INC SP */
+int op_33(uint16_t imm) {
+    sp++;
+    return OP_CYCLES(33);
+}
 
-        case 0x78: /* LD A, B */
-            {
-                uint8_t b = (bc >> 8) & 0xFF;
-                af = (af & 0x00FF) | (b << 8);
-            }
-            return 4;
+/* INC [HL] */
+int op_34(uint16_t imm) {
+    write_byte(hl, alu_inc(read_byte(hl)));
+    return OP_CYCLES(34);
+}
 
-        case 0x79: /* LD A, C */
-            {
-                uint8_t c = bc & 0xFF;
-                af = (af & 0x00FF) | (c << 8);
-            }
-            return 4;
+/* DEC [HL] */
+int op_35(uint16_t imm) {
+    write_byte(hl, alu_dec(read_byte(hl)));
+    return OP_CYCLES(35);
+}
 
-        case 0x7A: /* LD A, D */
-            {
-                uint8_t d = (de >> 8) & 0xFF;
-                af = (af & 0x00FF) | (d << 8);
-            }
-            return 4;
+/* LD [HL], n8 */
+int op_36(uint16_t imm) {
+    uint8_t n8 = imm;
+    write_byte(hl, n8);
+    return OP_CYCLES(36);
+}
 
-        case 0x7B: /* LD A, E */
-            af = (af & 0x00FF) | ((de & 0xFF) << 8);
-            return 4;
+/* SCF */
+int op_37(uint16_t imm) {
+    set_flag(C_FLAG, 1);
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, 0);
+    return OP_CYCLES(37);
+}
 
-        case 0x7C: /* LD A, H */
-            {
-                uint8_t h = (hl >> 8) & 0xFF;
-                af = (af & 0x00FF) | (h << 8);
-            }
-            return 4;
+/* JR C, e8 */
+int op_38(uint16_t imm) {
+    uint8_t e8 = imm;
+        
+    if (get_flag(C_FLAG)) {
+        pc += (int8_t)e8;
+        return OP_BRANCH_CYCLES(38);
+    }
+    return OP_CYCLES(38);
+}
 
-        case 0x7D: /* LD A, L */
-            {
-                uint8_t l = hl & 0xFF;
-                af = (af & 0x00FF) | (l << 8);
-            }
-            return 4;
+/* ADD HL, SP */
+int op_39(uint16_t imm) {
+    uint32_t result = hl + sp;
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, (hl & 0x0FFF) + (sp & 0x0FFF) > 0x0FFF);
+    set_flag(C_FLAG, result > 0xFFFF);
+    hl = result & 0xFFFF; /* Store lower 16 bits in HL */
+    return OP_CYCLES(39);
+}
 
-        case 0x7E: /* LD A, [HL] */
-            {
-                uint8_t value = emuRAM[hl]; /* Read value from memory at address HL */
-                af = (value << 8) | (af & 0x00FF); /* Load value into A */
-            }
-            return 8;
-
-        case 0x7F: /* LD A, A */
-            /* TODO: This is stupid */
-            printf("called 7f instruction\n");
-            return 4;
-
-        case 0x80: /* ADD A, B */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t b = (bc >> 8) & 0xFF;
-                uint8_t result = a + b;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (a & 0x0F) + (b & 0x0F) > 0x0F);
-                set_flag(C_FLAG, result < a);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x81: /* ADD A, C */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t c = bc & 0xFF;
-                uint8_t result = a + c;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (a & 0x0F) + (c & 0x0F) > 0x0F);
-                set_flag(C_FLAG, result < a);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x82: /* ADD A, D */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t d = (de >> 8) & 0xFF;
-                uint8_t result = a + d;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (a & 0x0F) + (d & 0x0F) > 0x0F);
-                set_flag(C_FLAG, result < a);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x83: /* ADD A, E */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t e = de & 0xFF;
-                uint8_t result = a + e;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (a & 0x0F) + (e & 0x0F) > 0x0F);
-                set_flag(C_FLAG, result < a);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x84: /* ADD A, H */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t h = (hl >> 8) & 0xFF;
-                uint8_t result = a + h;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (a & 0x0F) + (h & 0x0F) > 0x0F);
-                set_flag(C_FLAG, result < a);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x85: /* ADD A, L */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t l = hl & 0xFF;
-                uint8_t result = a + l;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (a & 0x0F) + (l & 0x0F) > 0x0F);
-                set_flag(C_FLAG, result < a);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x87: /* ADD A, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t result = a + a;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, (a & 0x0F) + (a & 0x0F) > 0x0F);
-                set_flag(C_FLAG, result < a); /* Carry if result overflows */
-                af = (result << 8) | (af & 0x00FF); /* Update A register */
-            }
-            return 4;
+/* LD A, [HL-] */
+int op_3a(uint16_t imm) {
+    uint8_t value = read_byte(hl);
+    af = (value << 8) | (af & 0x00FF);
+    hl--;
+    return OP_CYCLES(3a);
+}
 
-        case 0x88: /* ADC A, B */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t b = (bc >> 8) & 0xFF;
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a + b + carry;
+/* DEC SP */
+int op_3b(uint16_t imm) {
+    sp--;
+    return OP_CYCLES(3b);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, ((a & 0x0F) + (b & 0x0F) + carry > 0x0F));
-                set_flag(C_FLAG, result > 0xFF);
+/* INC A */
+int op_3c(uint16_t imm) {
+    uint8_t a = alu_inc(af >> 8);
+    af = (a << 8) | (af & 0x00FF);
+    return OP_CYCLES(3c);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 4;
+/* DEC A */
+int op_3d(uint16_t imm) {
+    uint8_t a = alu_dec(af >> 8);
+    af = (a << 8) | (af & 0x00FF);
+    return OP_CYCLES(3d);
+}
 
-        case 0x8C: /* ADC A, H */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t h = (hl >> 8) & 0xFF;
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a + h + carry;
+/* LD A, n8 */
+int op_3e(uint16_t imm) {
+    af = (af & 0x00FF) | (imm << 8);
+    return OP_CYCLES(3e);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, ((a & 0x0F) + (h & 0x0F) + carry > 0x0F));
-                set_flag(C_FLAG, result > 0xFF);
+/* CCF */
+int op_3f(uint16_t imm) {
+    uint8_t current_c_flag = get_flag(C_FLAG);
+    set_flag(C_FLAG, !current_c_flag); /* Complement the carry flag */
+    set_flag(N_FLAG, 0); /* Reset the subtract flag */
+    set_flag(H_FLAG, 0); /* Reset the half-carry flag */
+    return OP_CYCLES(3f);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 4;
+/* LD B, B */
+int op_40(uint16_t imm) {
+    /* Loads a register into itself, nothing to do */
+    return OP_CYCLES(40);
+}
 
-        case 0x8E: /* ADC A, [HL] */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t value = emuRAM[hl];
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a + value + carry;
+/* LD B, C */
+int op_41(uint16_t imm) {
+    uint8_t c = bc & 0xFF;
+    bc = (bc & 0x00FF) | (c << 8);
+    return OP_CYCLES(41);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, ((a & 0x0F) + (value & 0x0F) + carry > 0x0F));
-                set_flag(C_FLAG, result > 0xFF);
+/* LD B, D */
+int op_42(uint16_t imm) {
+    uint8_t d = (de >> 8) & 0xFF;
+    bc = (bc & 0x00FF) | (d << 8);
+    return OP_CYCLES(42);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 8;
-
-        case 0x90: /* SUB B */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t b = (bc >> 8) & 0xFF;
-                uint8_t result = a - b;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (a & 0x0F) < (b & 0x0F));
-                set_flag(C_FLAG, a < b);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x91: /* SUB A, C */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t c = bc & 0xFF;
-                uint8_t result = a - c;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (a & 0x0F) < (c & 0x0F));
-                set_flag(C_FLAG, a < c);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x92: /* SUB A, D */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t d = (de >> 8) & 0xFF;
-                uint8_t result = a - d;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (a & 0x0F) < (d & 0x0F));
-                set_flag(C_FLAG, a < d);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x93: /* SUB A, E */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t e = de & 0xFF;
-                uint8_t result = a - e;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (a & 0x0F) < (e & 0x0F));
-                set_flag(C_FLAG, a < e);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x94: /* SUB A, H */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t h = (hl >> 8) & 0xFF;
-                uint8_t result = a - h;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (a & 0x0F) < (h & 0x0F));
-                set_flag(C_FLAG, a < h);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
-
-        case 0x95: /* SUB A, L */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t l = hl & 0xFF;
-                uint8_t result = a - l;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (a & 0x0F) < (l & 0x0F));
-                set_flag(C_FLAG, a < l);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
+/* LD B, E */
+int op_43(uint16_t imm) {
+    uint8_t e = de & 0xFF;
+    bc = (bc & 0x00FF) | (e << 8);
+    return OP_CYCLES(43);
+}
 
-        case 0x96: /* SUB A, [HL] */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t value = emuRAM[hl];
-                uint16_t result = a - value;
+/* LD B, H */
+int op_44(uint16_t imm) {
+    uint8_t h = (hl >> 8) & 0xFF;
+    bc = (bc & 0x00FF) | (h << 8);
+    return OP_CYCLES(44);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (value & 0x0F)));
-                set_flag(C_FLAG, a < value);
+/* LD B, L */
+int op_45(uint16_t imm) {
+    uint8_t l = hl & 0xFF;
+    bc = (bc & 0x00FF) | (l << 8);
+    return OP_CYCLES(45);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 8;
+/* LD B, [HL] */
+int op_46(uint16_t imm) {
+    uint8_t value = read_byte(hl); /* Read value from memory at address HL */
+    bc = (value << 8) | (bc & 0x00FF); /* Load value into B */
+    return OP_CYCLES(46);
+}
 
-        case 0x97: /* SUB A, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint16_t result = a - a;
+/* LD B, A */
+int op_47(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF;
+    bc = (bc & 0x00FF) | (a << 8);
+    return OP_CYCLES(47);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, 0);
-                set_flag(C_FLAG, 0);
+/* LD C, B */
+int op_48(uint16_t imm) {
+    uint8_t b = (bc >> 8) & 0xFF;
+    bc = (bc & 0xFF00) | b;
+    return OP_CYCLES(48);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 4;
+/* LD C, C */
+int op_49(uint16_t imm) {
+    /* Loads a register into itself, nothing to do */
+    return OP_CYCLES(49);
+}
 
-        case 0x98: /* SBC A, B */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t b = (bc >> 8) & 0xFF;
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a - b - carry;
+/* LD C, D */
+int op_4a(uint16_t imm) {
+    uint8_t d = (de >> 8) & 0xFF;
+    bc = (bc & 0xFF00) | d;
+    return OP_CYCLES(4a);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (b & 0x0F) + carry)); /* Set half-carry flag if there is a borrow from bit 4 */
-                set_flag(C_FLAG, result > 0xFF); /* Set carry flag if there is a borrow */
+/* LD C, E */
+int op_4b(uint16_t imm) {
+    uint8_t e = de & 0xFF;
+    bc = (bc & 0xFF00) | e;
+    return OP_CYCLES(4b);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 4;
+/* LD C, H */
+int op_4c(uint16_t imm) {
+    uint8_t h = (hl >> 8) & 0xFF;
+    bc = (bc & 0xFF00) | h;
+    return OP_CYCLES(4c);
+}
 
-        case 0x99: /* SBC A, C */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t c = bc & 0xFF;
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a - c - carry;
+/* LD C, L */
+int op_4d(uint16_t imm) {
+    uint8_t l = hl & 0xFF;
+    bc = (bc & 0xFF00) | l;
+    return OP_CYCLES(4d);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (c & 0x0F) + carry));
-                set_flag(C_FLAG, result > 0xFF);
+/* LD C, [HL] */
+int op_4e(uint16_t imm) {
+    uint8_t value = read_byte(hl); /* Read value from memory at address HL */
+    bc = (bc & 0xFF00) | value; /* Load value into C */
+    return OP_CYCLES(4e);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 4;
+/* LD C, A */
+int op_4f(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF;
+    bc = (bc & 0xFF00) | a;
+    return OP_CYCLES(4f);
+}
 
-        case 0x9A: /* SBC A, D */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t d = (de >> 8) & 0xFF;
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a - d - carry;
+/* LD D, B */
+int op_50(uint16_t imm) {
+    uint8_t b = (bc >> 8) & 0xFF;
+    de = (de & 0x00FF) | (b << 8);
+    return OP_CYCLES(50);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (d & 0x0F) + carry));
-                set_flag(C_FLAG, result > 0xFF);
+/* LD D, C */
+int op_51(uint16_t imm) {
+    uint8_t c = bc & 0xFF;
+    de = (de & 0x00FF) | (c << 8);
+    return OP_CYCLES(51);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 4;
+/* LD D, D */
+int op_52(uint16_t imm) {
+    /* Loads a register into itself, nothing to do */
+    return OP_CYCLES(52);
+}
 
-        case 0x9B: /* SBC A, E */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t e = de & 0xFF;
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a - e - carry;
+/* LD D, E */
+int op_53(uint16_t imm) {
+    uint8_t e = de & 0xFF;
+    de = (de & 0x00FF) | (e << 8);
+    return OP_CYCLES(53);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (e & 0x0F) + carry));
-                set_flag(C_FLAG, result > 0xFF);
+/* LD D, H */
+int op_54(uint16_t imm) {
+    uint8_t h = (hl >> 8) & 0xFF;
+    de = (de & 0x00FF) | (h << 8);
+    return OP_CYCLES(54);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 4;
+/* LD D, L */
+int op_55(uint16_t imm) {
+    uint8_t l = hl & 0xFF;
+    de = (de & 0x00FF) | (l << 8);
+    return OP_CYCLES(55);
+}
 
-        case 0x9C: /* SBC A, H */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t h = (hl >> 8) & 0xFF;
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a - h - carry;
+/* LD D, [HL] */
+int op_56(uint16_t imm) {
+    uint8_t value = read_byte(hl); /* Read value from memory at address HL */
+    de = (value << 8) | (de & 0x00FF); /* Load value into D */
+    return OP_CYCLES(56);
+}
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (h & 0x0F) + carry));
-                set_flag(C_FLAG, result > 0xFF);
+/* LD D, A */
+int op_57(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF;
+    de = (de & 0x00FF) | (a << 8);
+    return OP_CYCLES(57);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 4;
-
-        case 0xA0: /* AND A, B */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t b = (bc >> 8) & 0xFF;
-                uint8_t result = a & b;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 1);
-                set_flag(C_FLAG, 0);
-                af = (result << 8) | (af & 0x00FF); /* Update A register */
-            }
-            return 4;
-
-        case 0xA1: /* AND A, C */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t c = bc & 0xFF;
-                uint8_t result = a & c;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 1);
-                set_flag(C_FLAG, 0);
-                af = (result << 8) | (af & 0x00FF); /* Update A register */
-            }
-            return 4;
+/* LD E, B */
+int op_58(uint16_t imm) {
+    uint8_t b = (bc >> 8) & 0xFF;
+    de = (de & 0xFF00) | b;
+    return OP_CYCLES(58);
+}
+
+/* LD E, C */
+int op_59(uint16_t imm) {
+    uint8_t c = bc & 0xFF;
+    de = (de & 0xFF00) | c;
+    return OP_CYCLES(59);
+}
+
+/* LD E, D */
+int op_5a(uint16_t imm) {
+    uint8_t d = (de >> 8) & 0xFF;
+    de = (de & 0xFF00) | d;
+    return OP_CYCLES(5a);
+}
+
+/* LD E, E */
+int op_5b(uint16_t imm) {
+    /* Loads a register into itself, nothing to do */
+    return OP_CYCLES(5b);
+}
+
+/* LD E, H */
+int op_5c(uint16_t imm) {
+    uint8_t h = (hl >> 8) & 0xFF;
+    de = (de & 0xFF00) | h;
+    return OP_CYCLES(5c);
+}
+
+/* LD E, L */
+int op_5d(uint16_t imm) {
+    uint8_t l = hl & 0xFF;
+    de = (de & 0xFF00) | l;
+    return OP_CYCLES(5d);
+}
+
+/* LD E, [HL] */
+int op_5e(uint16_t imm) {
+    uint8_t value = read_byte(hl); /* Read value from memory at address HL */
+    de = (de & 0xFF00) | value; /* Load value into E */
+    return OP_CYCLES(5e);
+}
+
+/* LD E, A */
+int op_5f(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF;
+    de = (de & 0xFF00) | a;
+    return OP_CYCLES(5f);
+}
+
+/* LD H, B */
+int op_60(uint16_t imm) {
+    uint8_t b = (bc >> 8) & 0xFF;
+    hl = (hl & 0x00FF) | (b << 8);
+    return OP_CYCLES(60);
+}
+
+/* LD H, C */
+int op_61(uint16_t imm) {
+    uint8_t c = bc & 0xFF;
+    hl = (hl & 0x00FF) | (c << 8);
+    return OP_CYCLES(61);
+}
+
+/* LD H, D */
+int op_62(uint16_t imm) {
+    uint8_t d = (de >> 8) & 0xFF;
+    hl = (hl & 0x00FF) | (d << 8);
+    return OP_CYCLES(62);
+}
+
+/* LD H, E */
+int op_63(uint16_t imm) {
+    uint8_t e = de & 0xFF;
+    hl = (hl & 0x00FF) | (e << 8);
+    return OP_CYCLES(63);
+}
+
+/* LD H, H */
+int op_64(uint16_t imm) {
+    /* Loads a register into itself, nothing to do */
+    return OP_CYCLES(64);
+}
+
+/* LD H, L */
+int op_65(uint16_t imm) {
+    uint8_t l = hl & 0xFF;
+    hl = (hl & 0x00FF) | (l << 8);
+    return OP_CYCLES(65);
+}
+
+/* LD H, [HL] */
+int op_66(uint16_t imm) {
+    uint8_t value = read_byte(hl); /* Read value from memory at address HL */
+    hl = (value << 8) | (hl & 0x00FF); /* Load value into H */
+    return OP_CYCLES(66);
+}
+
+/* LD H, A */
+int op_67(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF;
+    hl = (hl & 0x00FF) | (a << 8);
+    return OP_CYCLES(67);
+}
+
+/* LD L, B */
+int op_68(uint16_t imm) {
+    uint8_t b = (bc >> 8) & 0xFF;
+    hl = (hl & 0xFF00) | b;
+    return OP_CYCLES(68);
+}
+
+/* LD L, C */
+int op_69(uint16_t imm) {
+    uint8_t c = bc & 0xFF;
+    hl = (hl & 0xFF00) | c;
+    return OP_CYCLES(69);
+}
+
+/* LD L, D */
+int op_6a(uint16_t imm) {
+    uint8_t d = (de >> 8) & 0xFF;
+    hl = (hl & 0xFF00) | d;
+    return OP_CYCLES(6a);
+}
+
+/* LD L, E */
+int op_6b(uint16_t imm) {
+    uint8_t e = de & 0xFF;
+    hl = (hl & 0xFF00) | e;
+    return OP_CYCLES(6b);
+}
+
+/* LD L, H */
+int op_6c(uint16_t imm) {
+    uint8_t h = (hl >> 8) & 0xFF;
+    hl = (hl & 0xFF00) | h;
+    return OP_CYCLES(6c);
+}
+
+/* LD L, L */
+int op_6d(uint16_t imm) {
+    /* Loads a register into itself, nothing to do */
+    return OP_CYCLES(6d);
+}
+
+/* LD L, [HL] */
+int op_6e(uint16_t imm) {
+    uint8_t value = read_byte(hl); /* Read value from memory at address HL */
+    hl = (hl & 0xFF00) | value; /* Load value into L */
+    return OP_CYCLES(6e);
+}
+
+/* LD L, A */
+int op_6f(uint16_t imm) {
+    uint8_t a = (af >> 8) & 0xFF;
+    hl = (hl & 0xFF00) | a;
+    return OP_CYCLES(6f);
+}
+
+/* LD [HL], B */
+int op_70(uint16_t imm) {
+    uint8_t b = (bc >> 8) & 0xFF;
+    write_byte(hl, b); /* Store B at the memory address pointed to by HL */
+    return OP_CYCLES(70);
+}
+
+/* LD [HL], C */
+int op_71(uint16_t imm) {
+    uint8_t c = bc & 0xFF;
+    write_byte(hl, c); /* Store C at the memory address pointed to by HL */
+    return OP_CYCLES(71);
+}
+
+/* LD [HL], D */
+int op_72(uint16_t imm) {
+    uint8_t d = (de >> 8) & 0xFF;
+    write_byte(hl, d); /* Store D at the memory address pointed to by HL */
+    return OP_CYCLES(72);
+}
+
+/* LD [HL], E */
+int op_73(uint16_t imm) {
+    uint8_t e = de & 0xFF;
+    write_byte(hl, e); /* Store E at the memory address pointed to by HL */
+    return OP_CYCLES(73);
+}
+
+/* LD [HL], H */
+int op_74(uint16_t imm) {
+    uint8_t h = (hl >> 8) & 0xFF;
+    write_byte(hl, h); /* Store H at the memory address pointed to by HL */
+    return OP_CYCLES(74);
+}
+
+/* LD [HL], L */
+int op_75(uint16_t imm) {
+    uint8_t l = hl & 0xFF;
+    write_byte(hl, l); /* Store L at the memory address pointed to by HL */
+    return OP_CYCLES(75);
+}
+
+/* HALT */
+int op_76(uint16_t imm) {
+    /* Sleeps until IF & IE is nonzero, see interrupt_step() */
+    halted = 1;
+    interrupts_changed();
+    return OP_CYCLES(76);
+}
+
+/* LD [HL], A */
+int op_77(uint16_t imm) {
+    write_byte(hl, (af >> 8) & 0xFF);
+    return OP_CYCLES(77);
+}
+
+/* LD A, B */
+int op_78(uint16_t imm) {
+    uint8_t b = (bc >> 8) & 0xFF;
+    af = (af & 0x00FF) | (b << 8);
+    return OP_CYCLES(78);
+}
+
+/* LD A, C */
+int op_79(uint16_t imm) {
+    uint8_t c = bc & 0xFF;
+    af = (af & 0x00FF) | (c << 8);
+    return OP_CYCLES(79);
+}
+
+/* LD A, D */
+int op_7a(uint16_t imm) {
+    uint8_t d = (de >> 8) & 0xFF;
+    af = (af & 0x00FF) | (d << 8);
+    return OP_CYCLES(7a);
+}
+
+/* LD A, E */
+int op_7b(uint16_t imm) {
+    af = (af & 0x00FF) | ((de & 0xFF) << 8);
+    return OP_CYCLES(7b);
+}
+
+/* LD A, H */
+int op_7c(uint16_t imm) {
+    uint8_t h = (hl >> 8) & 0xFF;
+    af = (af & 0x00FF) | (h << 8);
+    return OP_CYCLES(7c);
+}
+
+/* LD A, L */
+int op_7d(uint16_t imm) {
+    uint8_t l = hl & 0xFF;
+    af = (af & 0x00FF) | (l << 8);
+    return OP_CYCLES(7d);
+}
+
+/* LD A, [HL] */
+int op_7e(uint16_t imm) {
+    uint8_t value = read_byte(hl); /* Read value from memory at address HL */
+    af = (value << 8) | (af & 0x00FF); /* Load value into A */
+    return OP_CYCLES(7e);
+}
+
+/* LD A, A */
+int op_7f(uint16_t imm) {
+    /* Loads a register into itself, nothing to do */
+    return OP_CYCLES(7f);
+}
+
+/* ADD A, B */
+int op_80(uint16_t imm) {
+    alu_add((bc >> 8) & 0xFF, 0);
+    return OP_CYCLES(80);
+}
+
+/* ADD A, C */
+int op_81(uint16_t imm) {
+    alu_add(bc & 0xFF, 0);
+    return OP_CYCLES(81);
+}
+
+/* ADD A, D */
+int op_82(uint16_t imm) {
+    alu_add((de >> 8) & 0xFF, 0);
+    return OP_CYCLES(82);
+}
+
+/* ADD A, E */
+int op_83(uint16_t imm) {
+    alu_add(de & 0xFF, 0);
+    return OP_CYCLES(83);
+}
+
+/* ADD A, H */
+int op_84(uint16_t imm) {
+    alu_add((hl >> 8) & 0xFF, 0);
+    return OP_CYCLES(84);
+}
+
+/* ADD A, L */
+int op_85(uint16_t imm) {
+    alu_add(hl & 0xFF, 0);
+    return OP_CYCLES(85);
+}
+
+/* ADD A, [HL] */
+int op_86(uint16_t imm) {
+    alu_add(read_byte(hl), 0);
+    return OP_CYCLES(86);
+}
+
+/* ADD A, A */
+int op_87(uint16_t imm) {
+    alu_add((af >> 8) & 0xFF, 0);
+    return OP_CYCLES(87);
+}
+
+/* ADC A, B */
+int op_88(uint16_t imm) {
+    alu_add((bc >> 8) & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(88);
+}
+
+/* ADC A, C */
+int op_89(uint16_t imm) {
+    alu_add(bc & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(89);
+}
+
+/* ADC A, D */
+int op_8a(uint16_t imm) {
+    alu_add((de >> 8) & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(8a);
+}
+
+/* ADC A, E */
+int op_8b(uint16_t imm) {
+    alu_add(de & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(8b);
+}
+
+/* ADC A, H */
+int op_8c(uint16_t imm) {
+    alu_add((hl >> 8) & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(8c);
+}
+
+/* ADC A, L */
+int op_8d(uint16_t imm) {
+    alu_add(hl & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(8d);
+}
+
+/* ADC A, [HL] */
+int op_8e(uint16_t imm) {
+    alu_add(read_byte(hl), get_flag(C_FLAG));
+    return OP_CYCLES(8e);
+}
+
+/* ADC A, A */
+int op_8f(uint16_t imm) {
+    alu_add((af >> 8) & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(8f);
+}
+
+/* SUB B */
+int op_90(uint16_t imm) {
+    alu_sub((bc >> 8) & 0xFF, 0);
+    return OP_CYCLES(90);
+}
+
+/* SUB A, C */
+int op_91(uint16_t imm) {
+    alu_sub(bc & 0xFF, 0);
+    return OP_CYCLES(91);
+}
+
+/* SUB A, D */
+int op_92(uint16_t imm) {
+    alu_sub((de >> 8) & 0xFF, 0);
+    return OP_CYCLES(92);
+}
+
+/* SUB A, E */
+int op_93(uint16_t imm) {
+    alu_sub(de & 0xFF, 0);
+    return OP_CYCLES(93);
+}
+
+/* SUB A, H */
+int op_94(uint16_t imm) {
+    alu_sub((hl >> 8) & 0xFF, 0);
+    return OP_CYCLES(94);
+}
+
+/* SUB A, L */
+int op_95(uint16_t imm) {
+    alu_sub(hl & 0xFF, 0);
+    return OP_CYCLES(95);
+}
+
+/* SUB A, [HL] */
+int op_96(uint16_t imm) {
+    alu_sub(read_byte(hl), 0);
+    return OP_CYCLES(96);
+}
+
+/* SUB A, A */
+int op_97(uint16_t imm) {
+    alu_sub((af >> 8) & 0xFF, 0);
+    return OP_CYCLES(97);
+}
+
+/* SBC A, B */
+int op_98(uint16_t imm) {
+    alu_sub((bc >> 8) & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(98);
+}
+
+/* SBC A, C */
+int op_99(uint16_t imm) {
+    alu_sub(bc & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(99);
+}
+
+/* SBC A, D */
+int op_9a(uint16_t imm) {
+    alu_sub((de >> 8) & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(9a);
+}
+
+/* SBC A, E */
+int op_9b(uint16_t imm) {
+    alu_sub(de & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(9b);
+}
+
+/* SBC A, H */
+int op_9c(uint16_t imm) {
+    alu_sub((hl >> 8) & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(9c);
+}
+
+/* SBC A, L */
+int op_9d(uint16_t imm) {
+    alu_sub(hl & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(9d);
+}
+
+/* SBC A, [HL] */
+int op_9e(uint16_t imm) {
+    alu_sub(read_byte(hl), get_flag(C_FLAG));
+    return OP_CYCLES(9e);
+}
+
+/* SBC A, A */
+int op_9f(uint16_t imm) {
+    alu_sub((af >> 8) & 0xFF, get_flag(C_FLAG));
+    return OP_CYCLES(9f);
+}
+
+/* AND A, B */
+int op_a0(uint16_t imm) {
+    alu_and((bc >> 8) & 0xFF);
+    return OP_CYCLES(a0);
+}
+
+/* AND A, C */
+int op_a1(uint16_t imm) {
+    alu_and(bc & 0xFF);
+    return OP_CYCLES(a1);
+}
+
+/* AND A, D */
+int op_a2(uint16_t imm) {
+    alu_and((de >> 8) & 0xFF);
+    return OP_CYCLES(a2);
+}
+
+/* AND A, E */
+int op_a3(uint16_t imm) {
+    alu_and(de & 0xFF);
+    return OP_CYCLES(a3);
+}
+
+/* AND A, H */
+int op_a4(uint16_t imm) {
+    alu_and((hl >> 8) & 0xFF);
+    return OP_CYCLES(a4);
+}
+
+/* AND A, L */
+int op_a5(uint16_t imm) {
+    alu_and(hl & 0xFF);
+    return OP_CYCLES(a5);
+}
+
+/* AND A, [HL] */
+int op_a6(uint16_t imm) {
+    alu_and(read_byte(hl));
+    return OP_CYCLES(a6);
+}
+
+/* AND A, A */
+int op_a7(uint16_t imm) {
+    alu_and((af >> 8) & 0xFF);
+    return OP_CYCLES(a7);
+}
+
+/* XOR A, B */
+int op_a8(uint16_t imm) {
+    alu_xor((bc >> 8) & 0xFF);
+    return OP_CYCLES(a8);
+}
+
+/* XOR A, C */
+int op_a9(uint16_t imm) {
+    alu_xor(bc & 0xFF);
+    return OP_CYCLES(a9);
+}
+
+/* XOR A, D */
+int op_aa(uint16_t imm) {
+    alu_xor((de >> 8) & 0xFF);
+    return OP_CYCLES(aa);
+}
+
+/* XOR A, E */
+int op_ab(uint16_t imm) {
+    alu_xor(de & 0xFF);
+    return OP_CYCLES(ab);
+}
+
+/* XOR A, H */
+int op_ac(uint16_t imm) {
+    alu_xor((hl >> 8) & 0xFF);
+    return OP_CYCLES(ac);
+}
+
+/* XOR A, L */
+int op_ad(uint16_t imm) {
+    alu_xor(hl & 0xFF);
+    return OP_CYCLES(ad);
+}
+
+/* XOR A, [HL] */
+int op_ae(uint16_t imm) {
+    alu_xor(read_byte(hl));
+    return OP_CYCLES(ae);
+}
+
+/* XOR A, A */
+int op_af(uint16_t imm) {
+    alu_xor((af >> 8) & 0xFF);
+    return OP_CYCLES(af);
+}
+
+/* OR A, B */
+int op_b0(uint16_t imm) {
+    alu_or((bc >> 8) & 0xFF);
+    return OP_CYCLES(b0);
+}
+
+/* OR A, C */
+int op_b1(uint16_t imm) {
+    alu_or(bc & 0xFF);
+    return OP_CYCLES(b1);
+}
+
+/* OR A, D */
+int op_b2(uint16_t imm) {
+    alu_or((de >> 8) & 0xFF);
+    return OP_CYCLES(b2);
+}
+
+/* OR A, E */
+int op_b3(uint16_t imm) {
+    alu_or(de & 0xFF);
+    return OP_CYCLES(b3);
+}
+
+/* OR A, H */
+int op_b4(uint16_t imm) {
+    alu_or((hl >> 8) & 0xFF);
+    return OP_CYCLES(b4);
+}
+
+/* OR A, L */
+int op_b5(uint16_t imm) {
+    alu_or(hl & 0xFF);
+    return OP_CYCLES(b5);
+}
+
+/* OR A, [HL] */
+int op_b6(uint16_t imm) {
+    alu_or(read_byte(hl));
+    return OP_CYCLES(b6);
+}
+
+/* OR A, A */
+int op_b7(uint16_t imm) {
+    alu_or((af >> 8) & 0xFF);
+    return OP_CYCLES(b7);
+}
+
+/* CP A, B */
+int op_b8(uint16_t imm) {
+    alu_cp((bc >> 8) & 0xFF);
+    return OP_CYCLES(b8);
+}
+
+/* CP A, C */
+int op_b9(uint16_t imm) {
+    alu_cp(bc & 0xFF);
+    return OP_CYCLES(b9);
+}
+
+/* CP A, D */
+int op_ba(uint16_t imm) {
+    alu_cp((de >> 8) & 0xFF);
+    return OP_CYCLES(ba);
+}
+
+/* CP A, E */
+int op_bb(uint16_t imm) {
+    alu_cp(de & 0xFF);
+    return OP_CYCLES(bb);
+}
+
+/* CP A, H */
+int op_bc(uint16_t imm) {
+    alu_cp((hl >> 8) & 0xFF);
+    return OP_CYCLES(bc);
+}
+
+/* CP A, L */
+int op_bd(uint16_t imm) {
+    alu_cp(hl & 0xFF);
+    return OP_CYCLES(bd);
+}
+
+/* CP A, [HL] */
+int op_be(uint16_t imm) {
+    alu_cp(read_byte(hl));
+    return OP_CYCLES(be);
+}
+
+/* CP A, A */
+int op_bf(uint16_t imm) {
+    alu_cp((af >> 8) & 0xFF);
+    return OP_CYCLES(bf);
+}
+
+/* RET NZ */
+int op_c0(uint16_t imm) {
+    if (!get_flag(Z_FLAG)) {
+        /* Pop return address from stack */
+        uint16_t return_addr = emuRAM[sp] | (emuRAM[sp + 1] << 8);
+        sp += 2;
+        PMDLog("Doing ret at %02x to %02x\n", pc, return_addr);
+        callstack_pop();
+        pc = return_addr;
+        return OP_BRANCH_CYCLES(c0);
+    } else {
+        return OP_CYCLES(c0);
+    }
+}
+
+/* POP BC */
+int op_c1(uint16_t imm) {
+    uint16_t value = emuRAM[sp] | (emuRAM[sp + 1] << 8);
+    sp += 2;
+    bc = value;
+    return OP_CYCLES(c1);
+}
+
+/* JP NZ, a16 */
+int op_c2(uint16_t imm) {
+    uint16_t address = imm;
+
+    if (!get_flag(Z_FLAG)) {
+        pc = address;
+        return OP_BRANCH_CYCLES(c2);
+    } else {
+        return OP_CYCLES(c2);
+    }
+}
+
+/* JP a16 */
+int op_c3(uint16_t imm) {
+    pc = imm;
+    return OP_CYCLES(c3);
+}
+
+/* CALL NZ, a16 */
+int op_c4(uint16_t imm) {
+    uint16_t address = imm;
+
+    if (!get_flag(Z_FLAG)) {
+        /* Push current PC onto the stack */
+        sp -= 2;
+        write_byte(sp, pc & 0xFF);
+        write_byte(sp + 1, (pc >> 8) & 0xFF);
+        callstack_push(pc - 3, address);
+
+        pc = address;
+        return OP_BRANCH_CYCLES(c4);
+    } else {
+        return OP_CYCLES(c4);
+    }
+}
+
+/* PUSH BC */
+int op_c5(uint16_t imm) {
+    /* Decrement stack pointer by 2 */
+    sp -= 2;
+
+    /* Push DE onto the stack */
+    write_byte(sp, bc & 0xFF);         /* Push low byte (C) */
+    write_byte(sp + 1, (bc >> 8) & 0xFF); /* Push high byte (B) */
+    return OP_CYCLES(c5);
+}
+
+/* ADD A, n8 */
+int op_c6(uint16_t imm) {
+    alu_add(imm, 0);
+    return OP_CYCLES(c6);
+}
+
+/* RST $00 */
+int op_c7(uint16_t imm) {
+    /* Decrement stack pointer and push current PC onto the stack */
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);         /* Push low byte of PC */
+    write_byte(sp + 1, (pc >> 8) & 0xFF); /* Push high byte of PC */
+    callstack_push(pc - 1, 0x00);
+
+    /* Jump to address 0x00 */
+    pc = 0x00;
+    return OP_CYCLES(c7);
+}
+
+/* RET Z */
+int op_c8(uint16_t imm) {
+    if (get_flag(Z_FLAG)) {
+        /* Pop return address from stack */
+        uint16_t return_addr = emuRAM[sp] | (emuRAM[sp + 1] << 8);
+        sp += 2; /* Increment stack pointer */
+        PMDLog("Doing ret at %02x to %02x\n", pc, return_addr);
+        callstack_pop();
+        pc = return_addr; /* Jump to return address */
+        return OP_BRANCH_CYCLES(c8);
+    } else {
+        return OP_CYCLES(c8);
+    }
+}
+
+/* RET */
+int op_c9(uint16_t imm) {
+    /* Pop the return address from the stack */
+    uint16_t return_addr = (emuRAM[sp + 1] << 8) | emuRAM[sp];
+    sp += 2;
+
+    /* Jump to the return address */
+    callstack_pop();
+    pc = return_addr;
+    return OP_CYCLES(c9);
+}
+
+/* JP Z, a16 */
+int op_ca(uint16_t imm) {
+    uint16_t address = imm;
+
+    if (get_flag(Z_FLAG)) {
+        pc = address;
+        return OP_BRANCH_CYCLES(ca);
+    } else {
+        return OP_CYCLES(ca);
+    }
+}
+
+/* CB opcode cycles, [HL] ones take longer */
+#define CB_CYCLES(hex, mnemonic, length, cycles, branchCycles, flags) [0x##hex] = cycles,
+static const uint8_t cbCycles[256] = {
+    SM83_CB_OPCODES(CB_CYCLES)
+};
+
+/* Operand of a CB opcode from its low 3 bits: B, C, D, E, H, L, [HL], A */
+static uint8_t cb_read(int reg) {
+    switch (reg) {
+        case 0: return (bc >> 8) & 0xFF;
+        case 1: return bc & 0xFF;
+        case 2: return (de >> 8) & 0xFF;
+        case 3: return de & 0xFF;
+        case 4: return (hl >> 8) & 0xFF;
+        case 5: return hl & 0xFF;
+        case 6: return read_byte(hl);
+        default: return (af >> 8) & 0xFF;
+    }
+}
+
+static void cb_write(int reg, uint8_t value) {
+    switch (reg) {
+        case 0: bc = (bc & 0x00FF) | (value << 8); break;
+        case 1: bc = (bc & 0xFF00) | value; break;
+        case 2: de = (de & 0x00FF) | (value << 8); break;
+        case 3: de = (de & 0xFF00) | value; break;
+        case 4: hl = (hl & 0x00FF) | (value << 8); break;
+        case 5: hl = (hl & 0xFF00) | value; break;
+        case 6: write_byte(hl, value); break;
+        default: af = (af & 0x00FF) | (value << 8); break;
+    }
+}
+
+/* RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL in CB opcode order */
+static uint8_t cb_shift(int kind, uint8_t value) {
+    uint8_t old_carry = get_flag(C_FLAG);
+    uint8_t new_carry;
+    uint8_t result;
+    switch (kind) {
+        case 0: new_carry = value >> 7; result = (value << 1) | new_carry; break;
+        case 1: new_carry = value & 0x01; result = (value >> 1) | (new_carry << 7); break;
+        case 2: new_carry = value >> 7; result = (value << 1) | old_carry; break;
+        case 3: new_carry = value & 0x01; result = (value >> 1) | (old_carry << 7); break;
+        case 4: new_carry = value >> 7; result = value << 1; break;
+        case 5: new_carry = value & 0x01; result = (value >> 1) | (value & 0x80); break;
+        case 6: new_carry = 0; result = (value << 4) | (value >> 4); break;
+        default: new_carry = value & 0x01; result = value >> 1; break;
+    }
+    set_flag(Z_FLAG, result == 0);
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, 0);
+    set_flag(C_FLAG, new_carry);
+    return result;
+}
+
+/* PREFIX */
+int op_cb(uint16_t imm) {
+    uint8_t cb_instr = imm;
+    int reg = cb_instr & 0x07;
+    int bit = (cb_instr >> 3) & 0x07;
+    uint8_t value = cb_read(reg);
+
+    switch (cb_instr >> 6) {
+        case 0: /* Rotates and shifts, bit picks which one */
+            cb_write(reg, cb_shift(bit, value));
+            break;
+        case 1: /* BIT */
+            set_flag(Z_FLAG, !(value & (1 << bit)));
+            set_flag(N_FLAG, 0);
+            set_flag(H_FLAG, 1);
+            break;
+        case 2: /* RES */
+            cb_write(reg, value & ~(1 << bit));
+            break;
+        default: /* SET */
+            cb_write(reg, value | (1 << bit));
+            break;
+    }
+    return cbCycles[cb_instr];
+}
+
+/* CALL Z, a16 */
+int op_cc(uint16_t imm) {
+    uint16_t address = imm;
+
+    if (get_flag(Z_FLAG)) {
+        /* Push current PC onto the stack */
+        sp -= 2;
+        write_byte(sp, pc & 0xFF);
+        write_byte(sp + 1, (pc >> 8) & 0xFF);
+        callstack_push(pc - 3, address);
+
+        pc = address;
+        return OP_BRANCH_CYCLES(cc);
+    } else {
+        return OP_CYCLES(cc);
+    }
+}
+
+/* CALL a16 */
+int op_cd(uint16_t imm) {
+    /* Read the 16-bit address */
+    uint16_t a16 = imm;
+
+    /* Push the return address (current PC) onto the stack, low byte first like PUSH */
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);
+    write_byte(sp + 1, (pc >> 8) & 0xFF);
+    callstack_push(pc - 3, a16);
+
+    /* Jump to the address */
+    pc = a16;
+    return OP_CYCLES(cd);
+}
+
+/* ADC A, n8 */
+int op_ce(uint16_t imm) {
+    alu_add(imm, get_flag(C_FLAG));
+    return OP_CYCLES(ce);
+}
+
+/* RST $08 */
+int op_cf(uint16_t imm) {
+    /* Decrement stack pointer and push current PC onto the stack */
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);         /* Push low byte of PC */
+    write_byte(sp + 1, (pc >> 8) & 0xFF); /* Push high byte of PC */
+    callstack_push(pc - 1, 0x08);
+
+    /* Jump to address 0x08 */
+    pc = 0x08;
+    return OP_CYCLES(cf);
+}
+
+/* RET NC */
+int op_d0(uint16_t imm) {
+    if (!get_flag(C_FLAG)) {
+        /* Pop return address from stack */
+        uint16_t return_addr = emuRAM[sp] | (emuRAM[sp + 1] << 8);
+        sp += 2;
+        PMDLog("Doing ret at %02x to %02x\n", pc, return_addr);
+        callstack_pop();
+        pc = return_addr;
+        return OP_BRANCH_CYCLES(d0);
+    } else {
+        return OP_CYCLES(d0);
+    }
+}
+
+/* POP DE */
+int op_d1(uint16_t imm) {
+    uint16_t value = emuRAM[sp] | (emuRAM[sp + 1] << 8); /* Read 16-bit value from stack */
+    sp += 2; /* Increment stack pointer */
+    de = value; /* Load value into HL */
+    return OP_CYCLES(d1);
+}
+
+/* JP NC, a16 */
+int op_d2(uint16_t imm) {
+    uint16_t address = imm;
+
+    if (!get_flag(C_FLAG)) {
+        pc = address;
+        return OP_BRANCH_CYCLES(d2);
+    } else {
+        return OP_CYCLES(d2);
+    }
+}
+
+/* CALL NC, a16 */
+int op_d4(uint16_t imm) {
+    uint16_t address = imm;
+
+    if (!get_flag(C_FLAG)) {
+        /* Push current PC onto the stack */
+        sp -= 2;
+        write_byte(sp, pc & 0xFF);
+        write_byte(sp + 1, (pc >> 8) & 0xFF);
+        callstack_push(pc - 3, address);
+
+        pc = address;
+        return OP_BRANCH_CYCLES(d4);
+    } else {
+        return OP_CYCLES(d4);
+    }
+}
+
+/* PUSH DE */
+int op_d5(uint16_t imm) {
+    /* Decrement stack pointer by 2 */
+    sp -= 2;
+
+    /* Push DE onto the stack */
+    write_byte(sp, de & 0xFF);         /* Push low byte (E) */
+    write_byte(sp + 1, (de >> 8) & 0xFF); /* Push high byte (D) */
+    return OP_CYCLES(d5);
+}
+
+/* SUB A, n8 */
+int op_d6(uint16_t imm) {
+    alu_sub(imm, 0);
+    return OP_CYCLES(d6);
+}
 
-        case 0xA7: /* AND A, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t result = a & a;
+/* RST $10 */
+int op_d7(uint16_t imm) {
+    /* Decrement stack pointer and push current PC onto the stack */
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);         /* Push low byte of PC */
+    write_byte(sp + 1, (pc >> 8) & 0xFF); /* Push high byte of PC */
+    callstack_push(pc - 1, 0x10);
 
-                af = (af & 0xFF00) | result;
+    /* Jump to address 0x10 */
+    pc = 0x10;
+    return OP_CYCLES(d7);
+}
 
-                /* Update flags */
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 1);
-                set_flag(C_FLAG, 0);
-            }
-            return 4;
-
-        case 0xA9: /* XOR A, C */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t c = bc & 0xFF;
-                uint8_t result = a ^ c;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 0);
-                set_flag(C_FLAG, 0);
-                af = (result << 8) | (af & 0x00FF); /* Update A register */
-            }
-            return 4;
+/* RET C */
+int op_d8(uint16_t imm) {
+    if (get_flag(C_FLAG)) {
+        /* Pop return address from stack */
+        uint16_t return_addr = emuRAM[sp] | (emuRAM[sp + 1] << 8);
+        sp += 2;
+        PMDLog("Doing ret at %02x to %02x\n", pc, return_addr);
+        callstack_pop();
+        pc = return_addr;
+        return OP_BRANCH_CYCLES(d8);
+    } else {
+        return OP_CYCLES(d8);
+    }
+}
 
-        case 0xAF: /* XOR A, A */
-            af = (af & 0x00FF) | 0x0000;
-            set_flag(Z_FLAG, 1);
-            set_flag(N_FLAG, 0);
-            set_flag(H_FLAG, 0);
-            set_flag(C_FLAG, 0);
-            return 4;
+/* RETI */
+int op_d9(uint16_t imm) {
+    /* Pop the return address from the stack */
+    uint16_t return_addr = emuRAM[sp] | (emuRAM[sp + 1] << 8);
+    sp += 2;
+    callstack_pop();
+    pc = return_addr;
+
+    /* Interrupts come back on straight away, unlike EI */
+    interrupts_enabled = 1;
+    interrupts_changed();
+    return OP_CYCLES(d9);
+}
 
-        case 0xB0: /* OR A, B */
-            af = (af & 0x00FF) | ((af >> 8 | (bc >> 8) & 0xFF) & 0xFF);
-            set_flag(Z_FLAG, (af >> 8) == 0);
-            set_flag(N_FLAG, 0);
-            set_flag(H_FLAG, 0);
-            set_flag(C_FLAG, 0);
-            return 4;
-
-        case 0xB1: /* OR A, C */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t c = bc & 0xFF;
-                uint8_t result = a | c;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 0);
-                set_flag(C_FLAG, 0);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 4;
+/* JP C, a16 */
+int op_da(uint16_t imm) {
+    uint16_t address = imm;
 
-        case 0xB2: /* OR A, D */
-            af = (af & 0x00FF) | ((af >> 8 | (de >> 8) & 0xFF) & 0xFF);
-            set_flag(Z_FLAG, (af >> 8) == 0);
-            set_flag(N_FLAG, 0);
-            set_flag(H_FLAG, 0);
-            set_flag(C_FLAG, 0);
-            return 4;
+    if (get_flag(C_FLAG)) {
+        pc = address;
+        return OP_BRANCH_CYCLES(da);
+    } else {
+        return OP_CYCLES(da);
+    }
+}
 
-        case 0xB3: /* OR A, E */
-            af = (af & 0x00FF) | ((af >> 8 | (de & 0xFF)) & 0xFF);
-            set_flag(Z_FLAG, (af >> 8) == 0);
-            set_flag(N_FLAG, 0);
-            set_flag(H_FLAG, 0);
-            set_flag(C_FLAG, 0);
-            return 4;
+/* CALL C, a16 */
+int op_dc(uint16_t imm) {
+    uint16_t address = imm;
 
-        case 0xB4: /* OR A, H */
-            af = (af & 0x00FF) | ((af >> 8 | (hl >> 8) & 0xFF) & 0xFF);
-            set_flag(Z_FLAG, (af >> 8) == 0);
-            set_flag(N_FLAG, 0);
-            set_flag(H_FLAG, 0);
-            set_flag(C_FLAG, 0);
-            return 4;
+    if (get_flag(C_FLAG)) {
+        /* Push current PC onto the stack */
+        sp -= 2;
+        write_byte(sp, pc & 0xFF);
+        write_byte(sp + 1, (pc >> 8) & 0xFF);
+        callstack_push(pc - 3, address);
 
-        case 0xB7: /* OR A, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t result = a | a;
+        pc = address;
+        return OP_BRANCH_CYCLES(dc);
+    } else {
+        return OP_CYCLES(dc);
+    }
+}
 
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 0);
-                set_flag(C_FLAG, 0);
+/* SBC A, n8 */
+int op_de(uint16_t imm) {
+    alu_sub(imm, get_flag(C_FLAG));
+    return OP_CYCLES(de);
+}
 
-                af = (result << 8) | (af & 0x00FF);
-            }
-            return 4;
-
-        case 0xBA: /* CP A, D */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t d = (de >> 8) & 0xFF;
-                uint8_t result = a - d;
-
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (d & 0x0F)));
-                set_flag(C_FLAG, a < d);
-            }
-            return 4;
-
-        case 0xBE: /* CP A, [HL] */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t value = emuRAM[hl];
-                uint8_t result = a - value;
-
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (value & 0x0F)));
-                set_flag(C_FLAG, a < value);
-            }
-            return 8;
-
-        case 0xBF: /* CP A, A */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t result = a - a; /* A - A */
-                set_flag(Z_FLAG, result == 0); /* Always true */
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, 0);
-                set_flag(C_FLAG, 0);
-            }
-            return 4;
-
-        case 0xC0: /* RET NZ */
-            {
-                if (!get_flag(Z_FLAG)) {
-                    /* Pop return address from stack */
-                    uint16_t return_addr = emuRAM[sp] | (emuRAM[sp + 1] << 8);
-                    sp += 2;
-                    PMDLog("Doing ret at %02x to %02x\n", pc, return_addr);
-                    signal_function_ret();
-                    pc = return_addr;
-                    return 20;
-                } else {
-                    return 8;
-                }
-            }
+/* RST $18 */
+int op_df(uint16_t imm) {
+    /* Decrement stack pointer and push current PC onto the stack */
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);         /* Push low byte of PC */
+    write_byte(sp + 1, (pc >> 8) & 0xFF); /* Push high byte of PC */
+    callstack_push(pc - 1, 0x18);
 
-        case 0xC1: /* POP BC */
-            {
-                uint16_t value = emuRAM[sp] | (emuRAM[sp + 1] << 8);
-                sp += 2;
-                bc = value;
-            }
-            return 12;
+    /* Jump to address 0x18 */
+    pc = 0x18;
+    return OP_CYCLES(df);
+}
 
-        case 0xC2: /* JP NZ, a16 */
-            {
-                uint16_t address = emuRAM[pc] | (emuRAM[pc + 1] << 8);
-                pc += 2;
+/* LDH [a8], A */
+int op_e0(uint16_t imm) {
+    uint8_t a8 = imm; /* Read the 8-bit immediate value */
+    uint16_t addr = 0xFF00 + a8; /* Calculate the address */
+    write_byte(addr, (af >> 8) & 0xFF); /* Write A to [0xFF00 + a8] */
+    return OP_CYCLES(e0);
+}
 
-                if (!get_flag(Z_FLAG)) {
-                    pc = address;
-                    return 16;
-                } else {
-                    return 12;
-                }
-            }
+/* POP HL */
+int op_e1(uint16_t imm) {
+    uint16_t value = emuRAM[sp] | (emuRAM[sp + 1] << 8); /* Read 16-bit value from stack */
+    sp += 2; /* Increment stack pointer */
+    hl = value; /* Load value into HL */
+    return OP_CYCLES(e1);
+}
 
-        case 0xC3: /* JP a16 */
-            pc = (emuRAM[pc + 1] << 8) | emuRAM[pc];
-            return 16;
+/* LDH [C], A */
+int op_e2(uint16_t imm) {
+    uint16_t addr = 0xFF00 + (bc & 0xFF); /* Calculate the address (0xFF00 + C) */
+    write_byte(addr, (af >> 8) & 0xFF); /* Store A at the address */
+    return OP_CYCLES(e2);
+}
 
-        case 0xC4: /* CALL NZ, a16 */
-            {
-                uint16_t address = emuRAM[pc] | (emuRAM[pc + 1] << 8);
-                pc += 2;
+/* PUSH HL */
+int op_e5(uint16_t imm) {
+    /* Decrement stack pointer by 2 */
+    sp -= 2;
 
-                if (!get_flag(Z_FLAG)) {
-                    /* Push current PC onto the stack */
-                    sp -= 2;
-                    emuRAM[sp] = pc & 0xFF;
-                    emuRAM[sp + 1] = (pc >> 8) & 0xFF;
+    /* Push DE onto the stack */
+    write_byte(sp, hl & 0xFF);         /* Push low byte (L) */
+    write_byte(sp + 1, (hl >> 8) & 0xFF); /* Push high byte (H) */
+    return OP_CYCLES(e5);
+}
 
-                    pc = address;
-                    return 24;
-                } else {
-                    return 12;
-                }
-            }
+/* AND A, n8 */
+int op_e6(uint16_t imm) {
+    alu_and(imm);
+    return OP_CYCLES(e6);
+}
 
-        case 0xC5: /* PUSH BC */
-            {
-                /* Decrement stack pointer by 2 */
-                sp -= 2;
+/* RST $20 */
+int op_e7(uint16_t imm) {
+    /* Decrement stack pointer and push current PC onto the stack */
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);         /* Push low byte of PC */
+    write_byte(sp + 1, (pc >> 8) & 0xFF); /* Push high byte of PC */
+    callstack_push(pc - 1, 0x20);
 
-                /* Push DE onto the stack */
-                emuRAM[sp] = bc & 0xFF;         /* Push low byte (C) */
-                emuRAM[sp + 1] = (bc >> 8) & 0xFF; /* Push high byte (B) */
-            }
-            return 16;
+    /* Jump to address 0x20 */
+    pc = 0x20;
+    return OP_CYCLES(e7);
+}
 
-        case 0xC6: /* ADD A, n8 */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t n8 = emuRAM[pc];
-                pc++;
-                uint16_t result = a + n8;
+/* ADD SP, e8 */
+int op_e8(uint16_t imm) {
+    int8_t offset = (int8_t)imm;
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, ((a & 0x0F) + (n8 & 0x0F) > 0x0F));
-                set_flag(C_FLAG, result > 0xFF);
+    /* Flags come from the low byte, as an unsigned add */
+    set_flag(Z_FLAG, 0);
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, ((sp & 0x0F) + (offset & 0x0F)) > 0x0F);
+    set_flag(C_FLAG, ((sp & 0xFF) + (offset & 0xFF)) > 0xFF);
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 8;
-
-        case 0xC8: /* RET Z */
-            {
-                if (get_flag(Z_FLAG)) {
-                    /* Pop return address from stack */
-                    uint16_t return_addr = emuRAM[sp] | (emuRAM[sp + 1] << 8);
-                    sp += 2; /* Increment stack pointer */
-                    PMDLog("Doing ret at %02x to %02x\n", pc, return_addr);
-                    signal_function_ret();
-                    pc = return_addr; /* Jump to return address */
-                    return 20;
-                } else {
-                    return 8;
-                }
-            }
+    sp = sp + offset;
+    return OP_CYCLES(e8);
+}
 
-        case 0xC9: /* RET */
-            {
-                /* Pop the return address from the stack */
-                uint16_t return_addr = (emuRAM[sp + 1] << 8) | emuRAM[sp];
-                sp += 2;
+/* JP HL */
+int op_e9(uint16_t imm) {
+    pc = hl;
+    return OP_CYCLES(e9); 
+}
 
-                /* Jump to the return address */
-                pc = return_addr;
-                /* TODO: implement this instruction rather than this hack */
-                pc = signal_function_ret();
-            }
-            return 16;
+/* LD [a16], A */
+int op_ea(uint16_t imm) {
+    uint16_t a16 = imm; /* Read the 16-bit address */
+    write_byte(a16, (af >> 8) & 0xFF); /* Store A at the address */
+    return OP_CYCLES(ea);
+}
+
+/* XOR A, n8 */
+int op_ee(uint16_t imm) {
+    alu_xor(imm);
+    return OP_CYCLES(ee);
+}
 
-        case 0xCA: /* JP Z, a16 */
-            {
-                uint16_t address = emuRAM[pc] | (emuRAM[pc + 1] << 8);
-                pc += 2;
+/* RST $28 */
+int op_ef(uint16_t imm) {
+    /* Decrement stack pointer and push current PC onto the stack */
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);         /* Push low byte of PC */
+    write_byte(sp + 1, (pc >> 8) & 0xFF); /* Push high byte of PC */
+    callstack_push(pc - 1, 0x28);
 
-                if (get_flag(Z_FLAG)) {
-                    pc = address;
-                    return 16;
-                } else {
-                    return 12;
-                }
-            }
+    /* Jump to address 0x28 */
+    pc = 0x28;
+    return OP_CYCLES(ef);
+}
 
-        case 0xCB: /* PREFIX */
-            {
-                uint8_t cb_instr = emuRAM[pc];
-                pc++;
-                printf("CB instr: %02x (%02x)\n", cb_instr, pc);
-
-                switch (cb_instr) {
-                    case 0x18: /* RR B */
-                        {
-                            uint8_t b = (bc >> 8) & 0xFF;
-                            uint8_t old_carry = get_flag(C_FLAG);
-                            uint8_t new_carry = b & 0x01;
-                            b = (b >> 1) | (old_carry << 7);
-
-                            set_flag(C_FLAG, new_carry);
-                            set_flag(Z_FLAG, b == 0);
-                            set_flag(N_FLAG, 0);
-                            set_flag(H_FLAG, 0);
-
-                            bc = (b << 8) | (bc & 0x00FF);
-                        }
-                        return 8;
-
-                    case 0x1A: /* RR D */
-                        {
-                            uint8_t d = (de >> 8) & 0xFF;
-                            uint8_t old_carry = get_flag(C_FLAG);
-                            uint8_t new_carry = d & 0x01;
-                            d = (d >> 1) | (old_carry << 7);
-
-                            set_flag(C_FLAG, new_carry);
-                            set_flag(Z_FLAG, d == 0);
-                            set_flag(N_FLAG, 0);
-                            set_flag(H_FLAG, 0);
-
-                            de = (d << 8) | (de & 0x00FF);
-                        }
-                        return 8;
-
-                    case 0x37: /* SWAP A */
-                        {
-                            uint8_t a = (af >> 8) & 0xFF;
-                            uint8_t swapped_a = ((a & 0x0F) << 4) | ((a & 0xF0) >> 4);
-                            set_flag(Z_FLAG, swapped_a == 0);
-                            set_flag(N_FLAG, 0);
-                            set_flag(H_FLAG, 0);
-                            set_flag(C_FLAG, 0);
-                            af = (swapped_a << 8) | (af & 0x00FF);
-                        }
-                        return 8;
-
-                    case 0x3F: /* SRL A */
-                        {
-                            uint8_t a = (af >> 8) & 0xFF; /* Extract A from the AF register */
-                            uint8_t shifted_a = a >> 1; /* Perform the logical right shift */
-                            set_flag(C_FLAG, a & 0x01); /* Set carry flag to the bit shifted out (LSB) */
-                            set_flag(Z_FLAG, shifted_a == 0); /* Set zero flag if the result is zero */
-                            set_flag(N_FLAG, 0); /* Reset subtract flag */
-                            set_flag(H_FLAG, 0); /* Reset half-carry flag */
-                            af = (shifted_a << 8) | (af & 0x00FF); /* Update A in the AF register */
-                        }
-                        return 8;
-
-                    case 0x42: /* BIT 0, D */
-                        {
-                            uint8_t d = (de >> 8) & 0xFF;
-                            uint8_t bit = (d >> 0) & 0x01;
-
-                            set_flag(Z_FLAG, bit == 0);
-                            set_flag(N_FLAG, 0);
-                            set_flag(H_FLAG, 1);
-                        }
-                        return 8;
-
-                    case 0x77: /* BIT 6, A */
-                        {
-                            uint8_t a = (af >> 8) & 0xFF;
-                            uint8_t bit = (a >> 6) & 0x01;
-
-                            set_flag(Z_FLAG, bit == 0);
-                            set_flag(N_FLAG, 0);
-                            set_flag(H_FLAG, 1);
-                        }
-                        return 8;
-
-                    case 0x87: /* RES 0, A */
-                        {
-                            uint8_t a = (af >> 8) & 0xFF;  /* Extract the A register */
-                            a &= ~(1 << 0);  /* Clear bit 0 (reset the bit) */
-                            af = (a << 8) | (af & 0x00FF);  /* Update the A register in the AF pair */
-                        }
-                        return 8;
-
-                    case 0xBF: /* RES 7, A */
-                        {
-                            uint8_t a = (af >> 8) & 0xFF;
-                            a &= ~(1 << 7); /* Clear bit 7 */
-                            af = (a << 8) | (af & 0x00FF); /* Update A register */
-                        }
-                        return 8;
-
-                    default:
-                        printf("Unrecognized CB opcode: %02x at %04x\n", cb_instr, pc - 1);
-                        #if CONTINUE_INVALID_OPCODE
-                        return 4;
-                        #else
-                        exit(1);
-                        #endif
-                }
-            }
+/* LDH A, [a8] */
+int op_f0(uint16_t imm) {
+    uint8_t a8 = imm; /* Read the 8-bit immediate value */
+    uint16_t addr = 0xFF00 + a8; /* Calculate the address */
+    uint8_t value = read_byte(addr); /* Read the value from [0xFF00 + a8] */
+    af = (af & 0x00FF) | (value << 8); /* Load the value into A */
+    return OP_CYCLES(f0);
+}
 
-        case 0xCD: /* CALL a16 */
-            {
-                /* Read the 16-bit address */
-                uint16_t a16 = (emuRAM[pc + 1] << 8) | emuRAM[pc];
-                pc += 2;
-                signal_function_call(pc);
+/* POP AF */
+int op_f1(uint16_t imm) {
+    uint16_t value = emuRAM[sp] | (emuRAM[sp + 1] << 8);
+    sp += 2;
+    af = value;
+    return OP_CYCLES(f1);
+}
 
-                /* Push the return address (current PC) onto the stack */
-                sp -= 2;
-                emuRAM[sp] = (pc >> 8) & 0xFF;
-                emuRAM[sp + 1] = pc & 0xFF;
+/* LDH A, [C] */
+int op_f2(uint16_t imm) {
+    uint16_t addr = 0xFF00 + (bc & 0xFF); /* Calculate the address (0xFF00 + C) */
+    uint8_t value = read_byte(addr);
+    af = (af & 0x00FF) | (value << 8); /* Load the value into A */
+    return OP_CYCLES(f2);
+}
 
-                /* Jump to the address */
-                pc = a16;
-            }
-            return 24;
-
-        case 0xCE: /* ADC A, n8 */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t n8 = emuRAM[pc];
-                pc++;
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a + n8 + carry;
-
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, ((a & 0x0F) + (n8 & 0x0F) + carry > 0x0F));
-                set_flag(C_FLAG, result > 0xFF);
-
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 8;
+/* DI */
+int op_f3(uint16_t imm) {
+    interrupts_enabled = 0;
+    imeDelay = 0;
+    interrupts_changed();
+    return OP_CYCLES(f3);
+}
 
-        case 0xCF: /* RST $08 */
-            {
-                /* Decrement stack pointer and push current PC onto the stack */
-                sp -= 2;
-                emuRAM[sp] = pc & 0xFF;         /* Push low byte of PC */
-                emuRAM[sp + 1] = (pc >> 8) & 0xFF; /* Push high byte of PC */
+/* PUSH AF */
+int op_f5(uint16_t imm) {
+    /* Decrement stack pointer by 2 */
+    sp -= 2;
 
-                /* Jump to address 0x08 */
-                pc = 0x08;
-            }
-            return 16;
-
-        case 0xD0: /* RET NC */
-            {
-                if (!get_flag(C_FLAG)) {
-                    /* Pop return address from stack */
-                    uint16_t return_addr = emuRAM[sp] | (emuRAM[sp + 1] << 8);
-                    sp += 2;
-                    PMDLog("Doing ret at %02x to %02x\n", pc, return_addr);
-                    signal_function_ret();
-                    pc = return_addr;
-                    return 20;
-                } else {
-                    return 8;
-                }
-            }
+    /* Push AF onto the stack */
+    write_byte(sp, af & 0xFF);         /* Push low byte (F) */
+    write_byte(sp + 1, (af >> 8) & 0xFF); /* Push high byte (A) */
+    return OP_CYCLES(f5);
+}
 
-        case 0xD1: /* POP DE */
-            {
-                uint16_t value = emuRAM[sp] | (emuRAM[sp + 1] << 8); /* Read 16-bit value from stack */
-                sp += 2; /* Increment stack pointer */
-                de = value; /* Load value into HL */
-            }
-            return 12;
+/* OR A, n8 */
+int op_f6(uint16_t imm) {
+    alu_or(imm);
+    return OP_CYCLES(f6);
+}
 
-        case 0xD2: /* JP NC, a16 */
-            {
-                uint16_t address = emuRAM[pc] | (emuRAM[pc + 1] << 8);
-                pc += 2;
+/* RST $30 */
+int op_f7(uint16_t imm) {
+    /* Decrement stack pointer and push current PC onto the stack */
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);         /* Push low byte of PC */
+    write_byte(sp + 1, (pc >> 8) & 0xFF); /* Push high byte of PC */
+    callstack_push(pc - 1, 0x30);
 
-                if (!get_flag(C_FLAG)) {
-                    pc = address;
-                    return 16;
-                } else {
-                    return 12;
-                }
-            }
+    /* Jump to address 0x30 */
+    pc = 0x30;
+    return OP_CYCLES(f7);
+}
 
-        case 0xD5: /* PUSH DE */
-            {
-                /* Decrement stack pointer by 2 */
-                sp -= 2;
+/* LD HL, SP + e8 */
+int op_f8(uint16_t imm) {
+    int8_t offset = (int8_t)imm;
 
-                /* Push DE onto the stack */
-                emuRAM[sp] = de & 0xFF;         /* Push low byte (E) */
-                emuRAM[sp + 1] = (de >> 8) & 0xFF; /* Push high byte (D) */
-            }
-            return 16;
+    /* Calculate the result of SP + offset */
+    uint16_t result = sp + offset;
 
-        case 0xD6: /* SUB A, n8 */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t n8 = emuRAM[pc];
-                pc++;
-                uint16_t result = a - n8;
+    /* Set flags based on the addition */
+    set_flag(Z_FLAG, 0);
+    set_flag(N_FLAG, 0);
+    set_flag(H_FLAG, ((sp & 0x0F) + (offset & 0x0F)) > 0x0F);
+    set_flag(C_FLAG, ((sp & 0xFF) + (offset & 0xFF)) > 0xFF);
 
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (n8 & 0x0F)));
-                set_flag(C_FLAG, a < n8);
+    hl = result;
+    return OP_CYCLES(f8);
+}
 
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 8;
-
-        case 0xDE: /* SBC A, n8 */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t n8 = emuRAM[pc];
-                pc++;
-                uint8_t carry = get_flag(C_FLAG);
-                uint16_t result = a - n8 - carry;
-
-                set_flag(Z_FLAG, (result & 0xFF) == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, ((a & 0x0F) < (n8 & 0x0F) + carry));
-                set_flag(C_FLAG, result > 0xFF);
-
-                af = ((result & 0xFF) << 8) | (af & 0x00FF);
-            }
-            return 8;
+/* LD SP, HL */
+int op_f9(uint16_t imm) {
+    sp = hl;
+    return OP_CYCLES(f9);
+}
 
-        case 0xDF: /* RST $18 */
-            {
-                /* Decrement stack pointer and push current PC onto the stack */
-                sp -= 2;
-                emuRAM[sp] = pc & 0xFF;         /* Push low byte of PC */
-                emuRAM[sp + 1] = (pc >> 8) & 0xFF; /* Push high byte of PC */
+/* LD A, [a16] */
+int op_fa(uint16_t imm) {
+    uint16_t a16 = imm;
+    uint8_t value = read_byte(a16);
+    af = (af & 0x00FF) | (value << 8);
+    return OP_CYCLES(fa);
+}
 
-                /* Jump to address 0x18 */
-                pc = 0x18;
-            }
-            return 16;
-
-        case 0xE0: /* LDH [a8], A */
-            {
-                uint8_t a8 = emuRAM[pc]; /* Read the 8-bit immediate value */
-                pc++;
-                uint16_t addr = 0xFF00 + a8; /* Calculate the address */
-                emuRAM[addr] = (af >> 8) & 0xFF; /* Write A to [0xFF00 + a8] */
-            }
-            return 12;
+/* EI */
+int op_fb(uint16_t imm) {
+    /* IME comes on after the next instruction, see interrupt_step() */
+    imeDelay = 1;
+    interrupts_changed();
+    return OP_CYCLES(fb);
+}
 
-        case 0xE1: /* POP HL */
-            {
-                uint16_t value = emuRAM[sp] | (emuRAM[sp + 1] << 8); /* Read 16-bit value from stack */
-                sp += 2; /* Increment stack pointer */
-                hl = value; /* Load value into HL */
-            }
-            return 12;
+/* CP A, n8 */
+int op_fe(uint16_t imm) {
+    alu_cp(imm);
+    return OP_CYCLES(fe);
+}
 
-        case 0xE2: /* LDH [C], A */
-            {
-                uint16_t addr = 0xFF00 + (bc & 0xFF); /* Calculate the address (0xFF00 + C) */
-                emuRAM[addr] = (af >> 8) & 0xFF; /* Store A at the address */
-            }
-            return 8;
+/* RST $38 */
+int op_ff(uint16_t imm) {
+    /* Decrement stack pointer and push current PC onto the stack */
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);         /* Push low byte of PC */
+    write_byte(sp + 1, (pc >> 8) & 0xFF); /* Push high byte of PC */
+    callstack_push(pc - 1, 0x38);
 
-        case 0xE5: /* PUSH HL */
-            {
-                /* Decrement stack pointer by 2 */
-                sp -= 2;
+    /* Jump to address 0x38 */
+    pc = 0x38;
+    return OP_CYCLES(ff);
+}
 
-                /* Push DE onto the stack */
-                emuRAM[sp] = hl & 0xFF;         /* Push low byte (L) */
-                emuRAM[sp + 1] = (hl >> 8) & 0xFF; /* Push high byte (H) */
-            }
-            return 16;
-
-        case 0xE6: /* AND A, n8 */
-            {
-                uint8_t a = (af >> 8) & 0xFF;
-                uint8_t n8 = emuRAM[pc];
-                pc++;
-                uint8_t result = a & n8;
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, 1);
-                set_flag(C_FLAG, 0);
-                af = (af & 0x00FF) | (result << 8);
-            }
-            return 8;
+/* Both tables come from SM83_OPCODES, see opcodes.h */
+#define OP_LENGTH(hex, mnemonic, length, cycles, branchCycles, flags) [0x##hex] = length,
+#define OP_HANDLER(hex, mnemonic, length, cycles, branchCycles, flags) [0x##hex] = op_##hex,
 
-        case 0xEA: /* LD [a16], A */
-            {
-                uint16_t a16 = (emuRAM[pc + 1] << 8) | emuRAM[pc]; /* Read the 16-bit address */
-                pc += 2;
-                emuRAM[a16] = (af >> 8) & 0xFF; /* Store A at the address */
-            }
-            return 16;
+/* Instruction length in bytes, immediates included */
+const uint8_t opLength[256] = {
+    SM83_OPCODES(OP_LENGTH)
+};
 
-        case 0xE9: /* JP HL */
-            pc = hl;
-            return 4; 
+/* No handler for the opcodes that lock the CPU up */
+const op_handler opTable[256] = {
+    SM83_OPCODES(OP_HANDLER)
+};
 
-        case 0xEF: /* RST $28 */
-            {
-                /* Decrement stack pointer and push current PC onto the stack */
-                sp -= 2;
-                emuRAM[sp] = pc & 0xFF;         /* Push low byte of PC */
-                emuRAM[sp + 1] = (pc >> 8) & 0xFF; /* Push high byte of PC */
+/*
+ * Superinstructions for the cached interpreter. They call the handlers
+ * above in order, so they behave exactly like their parts minus the
+ * dispatch in between. The copy and fill loops run as a host memcpy or
+ * memset when they only touch RAM that holds no decoded code.
+ */
+
+/* LD A, [HL+]; LD [DE], A; INC DE */
+static int fused_copy_byte(const micro_op *parts, int budget) {
+    int cycles = op_2a(0) + op_12(0);
+    if (codeWritten) {
+        /* The store hit code, stop before INC DE */
+        pc = parts[1].nextPc;
+        return cycles;
+    }
+    return cycles + op_13(0);
+}
 
-                /* Jump to address 0x28 */
-                pc = 0x28;
-            }
-            return 16;
-
-        case 0xF0: /* LDH A, [a8] */
-            {
-                uint8_t a8 = emuRAM[pc]; /* Read the 8-bit immediate value */
-                pc++;
-                uint16_t addr = 0xFF00 + a8; /* Calculate the address */
-                uint8_t value = emuRAM[addr]; /* Read the value from [0xFF00 + a8] */
-                af = (af & 0x00FF) | (value << 8); /* Load the value into A */
-            }
-            return 12;
+/* DEC B; JR NZ, e8 */
+static int fused_dec_b_jr_nz(const micro_op *parts, int budget) {
+    return op_05(0) + op_20(parts[1].imm);
+}
 
-        case 0xF1: /* POP AF */
-            {
-                uint16_t value = emuRAM[sp] | (emuRAM[sp + 1] << 8);
-                sp += 2;
-                af = value;
-            }
-            return 12;
+/* LDH A, [a8]; CP A, n8; JR NZ, e8 */
+static int fused_poll_jr_nz(const micro_op *parts, int budget) {
+    return op_f0(parts[0].imm) + op_fe(parts[1].imm) + op_20(parts[2].imm);
+}
 
-        case 0xF3: /* DI */
-            /* Disable interrupts (not implemented yet) */
-            interrupts_enabled = 0;
-            return 4;
+/* LDH A, [a8]; CP A, n8; JR Z, e8 */
+static int fused_poll_jr_z(const micro_op *parts, int budget) {
+    return op_f0(parts[0].imm) + op_fe(parts[1].imm) + op_28(parts[2].imm);
+}
 
-        case 0xF5: /* PUSH AF */
-            {
-                /* Decrement stack pointer by 2 */
-                sp -= 2;
+/* Each loop up to its JR, then one pass round with the JR taken */
+#define COPY_LOOP_LEAD (OP_CYCLES(2a) + OP_CYCLES(12) + OP_CYCLES(13) + OP_CYCLES(0b) + OP_CYCLES(78) + OP_CYCLES(b1))
+#define COPY_LOOP_CYCLES (COPY_LOOP_LEAD + OP_BRANCH_CYCLES(20))
+#define FILL_LOOP_LEAD (OP_CYCLES(22) + OP_CYCLES(05))
+#define FILL_LOOP_CYCLES (FILL_LOOP_LEAD + OP_BRANCH_CYCLES(20))
 
-                /* Push AF onto the stack */
-                emuRAM[sp] = af & 0xFF;         /* Push low byte (F) */
-                emuRAM[sp + 1] = (af >> 8) & 0xFF; /* Push high byte (A) */
-            }
-            return 16;
+/* Plain RAM with no code on it, safe to write behind write_byte()'s back */
+static int bulk_write_ok(uint16_t start, uint32_t count) {
+    return start >= 0x8000 && start + count <= 0xFF00 && !code_pages_have_code(start, count);
+}
 
-        case 0xF8: /* LD HL, SP + e8 */
-            {
-                int8_t offset = (int8_t)emuRAM[pc];
-                pc++;
+/*
+ * .loop: LD A, [HL+]; LD [DE], A; INC DE; DEC BC; LD A, B; OR A, C; JR NZ, .loop
+ * Only as many iterations run as the interpreter would fit in budget.
+ */
+static int fused_copy_loop(const micro_op *parts, int budget) {
+    uint32_t count = bc ? bc : 0x10000;
+    uint32_t fits = (budget - COPY_LOOP_LEAD - 1) / COPY_LOOP_CYCLES + 1;
+    if (fits < count) {
+        count = fits;
+    }
+    if (hl + count > 0xFF00 || !bulk_write_ok(de, count) || (hl < de + count && de < hl + count)) {
+        /* One iteration the slow way */
+        int cycles = fused_copy_byte(parts, budget);
+        if (codeWritten) {
+            return cycles;
+        }
+        return cycles + op_0b(0) + op_78(0) + op_b1(0) + op_20(parts[6].imm);
+    }
+    memcpy(&emuRAM[de], &emuRAM[hl], count);
+    hl += count;
+    de += count;
+    bc -= count;
+    /* The tail of the last iteration sets A, the flags and pc, its JR may fall through */
+    op_78(0);
+    op_b1(0);
+    int jrCycles = op_20(parts[6].imm);
+    return count * COPY_LOOP_CYCLES - OP_BRANCH_CYCLES(20) + jrCycles;
+}
 
-                /* Calculate the result of SP + offset */
-                uint16_t result = sp + offset;
+/* .loop: LD [HL+], A; DEC B; JR NZ, .loop */
+static int fused_fill_loop(const micro_op *parts, int budget) {
+    uint8_t b = (bc >> 8) & 0xFF;
+    uint32_t count = b ? b : 0x100;
+    uint32_t fits = (budget - FILL_LOOP_LEAD - 1) / FILL_LOOP_CYCLES + 1;
+    if (fits < count) {
+        count = fits;
+    }
+    if (!bulk_write_ok(hl, count)) {
+        int cycles = op_22(0);
+        if (codeWritten) {
+            pc = parts[0].nextPc;
+            return cycles;
+        }
+        return cycles + op_05(0) + op_20(parts[2].imm);
+    }
+    memset(&emuRAM[hl], (af >> 8) & 0xFF, count);
+    hl += count;
+    /* Leave the last DEC B to its handler so the flags come out right */
+    bc = (((b - count + 1) & 0xFF) << 8) | (bc & 0x00FF);
+    op_05(0);
+    int jrCycles = op_20(parts[2].imm);
+    return count * FILL_LOOP_CYCLES - OP_BRANCH_CYCLES(20) + jrCycles;
+}
 
-                /* Set flags based on the addition */
-                set_flag(Z_FLAG, 0);
-                set_flag(N_FLAG, 0);
-                set_flag(H_FLAG, ((sp & 0x0F) + (offset & 0x0F)) > 0x0F);
-                set_flag(C_FLAG, ((sp & 0xFF) + (offset & 0xFF)) > 0xFF);
+/* Longest first, the decoder takes the first match */
+const superinstruction superTable[] = {
+    { 7, { 0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20 }, COPY_LOOP_LEAD, 1, fused_copy_loop },
+    { 3, { 0x22, 0x05, 0x20 }, FILL_LOOP_LEAD, 1, fused_fill_loop },
+    { 3, { 0xF0, 0xFE, 0x20 }, OP_CYCLES(f0) + OP_CYCLES(fe), 0, fused_poll_jr_nz },
+    { 3, { 0xF0, 0xFE, 0x28 }, OP_CYCLES(f0) + OP_CYCLES(fe), 0, fused_poll_jr_z },
+    { 3, { 0x2A, 0x12, 0x13 }, OP_CYCLES(2a) + OP_CYCLES(12), 0, fused_copy_byte },
+    { 2, { 0x05, 0x20 }, OP_CYCLES(05), 0, fused_dec_b_jr_nz },
+};
+const int superTableCount = sizeof(superTable) / sizeof(superTable[0]);
+
+/* A single instruction in whichever interpreter core was picked */
+static int execute_one(void) {
+    switch (emuConfig.core) {
+        case CORE_TRACED:
+            return execute_instruction_traced();
+        case CORE_DEBUG:
+            return execute_instruction_debug();
+        case CORE_PROFILED:
+            return execute_instruction_profiled();
+        default:
+            return execute_instruction();
+    }
+}
 
-                hl = result;
-            }
-            return 12;
-
-        case 0xFA: /* LD A, [a16] */
-            {
-                uint16_t a16 = (emuRAM[pc + 1] << 8) | emuRAM[pc];
-                pc += 2;
-                uint8_t value = emuRAM[a16];
-                af = (af & 0x00FF) | (value << 8);
-            }
-            return 16;
+/* Compiled ahead of time if we have it, otherwise whichever tier was picked */
+static int execute_next(int budget) {
+    if (dmaActive) {
+        /* Only the interpreter sees the bus locked, and the window is short */
+        return execute_one();
+    }
+    if (emuConfig.aotPath) {
+        int cycles = execute_aot(budget);
+        if (cycles >= 0) {
+            return cycles;
+        }
+    }
+    return emuConfig.cachedInterpreter ? execute_block(budget) : execute_one();
+}
 
-        case 0xFB: /* EI */
+/*
+ * Only reached while interruptCheck is set: finishes EI's delay, sleeps
+ * through HALT and services the highest priority interrupt.
+ */
+static int interrupt_step(int budget) {
+    if (!cycle) {
+        return 0; /* Paused, a halted CPU does not sleep through it */
+    }
+    if (imeDelay) {
+        /* The instruction after EI runs before anything can be serviced */
+        int cycles = execute_one();
+        if (cycles && imeDelay) {
+            imeDelay = 0;
             interrupts_enabled = 1;
-            return 4;
-
-        case 0xFE: /* CP A, n8 */
-            {
-                uint8_t a = (af >> 8) & 0xFF; /* Get the value of A */
-                uint8_t n8 = emuRAM[pc]; /* Read the 8-bit immediate value */
-                pc++;
-                uint8_t result = a - n8; /* Perform subtraction (A - n8) */
-
-                /* Update flags */
-                set_flag(Z_FLAG, result == 0);
-                set_flag(N_FLAG, 1);
-                set_flag(H_FLAG, (a & 0x0F) < (n8 & 0x0F));
-                set_flag(C_FLAG, a < n8);
-            }
-            return 8;
+            interrupts_changed();
+        }
+        return cycles;
+    }
+    uint8_t pending = interrupts_pending();
+    if (halted) {
+        if (!pending) {
+            /* Nothing can be raised before the next scanline */
+            int idle = (((456 - ly_counter) << doubleSpeed) + 3) & ~3;
+            return idle < budget ? idle : budget;
+        }
+        /* Wakes up even with IME off, just without servicing it */
+        halted = 0;
+        interrupts_changed();
+    }
+    if (interrupts_enabled && pending) {
+        return interrupt_dispatch(pending);
+    }
+    return execute_next(budget);
+}
 
-        case 0xFF: /* RST $38 */
-            {
-                /* Decrement stack pointer and push current PC onto the stack */
-                sp -= 2;
-                emuRAM[sp] = pc & 0xFF;         /* Push low byte of PC */
-                emuRAM[sp + 1] = (pc >> 8) & 0xFF; /* Push high byte of PC */
+/* When the running frame ends, in cycleCount */
+static uint64_t frameEnd;
+/* Whichever comes first, the end of the frame or the next event */
+static uint64_t runUntil;
 
-                /* Jump to address 0x38 */
-                pc = 0x38;
-            }
-            return 16;
+void schedule_update(void) {
+    runUntil = timerEventAt < frameEnd ? timerEventAt : frameEnd;
+    if (lyEventAt < runUntil) {
+        runUntil = lyEventAt;
+    }
+    if (dmaEndsAt < runUntil) {
+        runUntil = dmaEndsAt;
+    }
+    if (cgbEventAt < runUntil) {
+        runUntil = cgbEventAt;
+    }
+    if (serialEventAt < runUntil) {
+        runUntil = serialEventAt;
+    }
+    if (sampleEventAt < runUntil) {
+        runUntil = sampleEventAt;
+    }
+}
 
-        default:
-            printf("Unrecognized opcode: %02x at %04x\n", instr, pc - 1);
-#if CONTINUE_INVALID_OPCODE
-            return 4;
-#else
-            exit(1);
-#endif
+/* A frame is so many PPU dots, what is left of it in CPU cycles doubles or halves */
+void schedule_speed_changed(void) {
+    if (frameEnd > cycleCount) {
+        uint64_t left = frameEnd - cycleCount;
+        frameEnd = cycleCount + (doubleSpeed ? left << 1 : left >> 1);
     }
+    ly_schedule();
+}
 
-    check_interrupts();
+/* Runs one frame worth of CPU cycles without presenting anything */
+void run_frame(void) {
+    frameEnd = cycleCount + ((uint64_t)CYCLES_PER_FRAME << doubleSpeed);
+    ly_schedule();
+    while (cycleCount < frameEnd) {
+        /* Up to the next event only the CPU and LY move */
+        while (cycleCount < runUntil) {
+            int budget = (int)(runUntil - cycleCount);
+            int cycles = interruptCheck ? interrupt_step(budget) : execute_next(budget);
+            if (!cycles) {
+                return; /* Paused */
+            }
+            cycleCount += cycles;
+            update_ly(cycles >> doubleSpeed); /* Update LY register */
+        }
+        if (cycleCount >= dmaEndsAt) {
+            dma_finish();
+        }
+        if (cycleCount >= cgbEventAt) {
+            int cycles = cgb_event();
+            cycleCount += cycles;
+            update_ly(cycles >> doubleSpeed);
+        }
+        if (cycleCount >= lyEventAt) {
+            /* update_ly() has raised it already, on to the next one */
+            ly_schedule();
+        }
+        if (cycleCount >= timerEventAt) {
+            timer_reschedule();
+        }
+        if (cycleCount >= serialEventAt) {
+            serial_event();
+        }
+        if (cycleCount >= sampleEventAt) {
+            callstack_sample_event();
+        }
+    }
+    serial_frame_end();
 }
 
-void emulator(SDL_Window *win, const char *romPath) {
-    printf("starting emulator...\n");
-    /*
-     * According to https://nullprogram.com/blog/2023/01/08/
-     * SDL2 already tries to create an accelerated renderer
-     * and not specifying allows for a software renderer fallback
-     */
-    Uint32 render_flags = SDL_RENDERER_PRESENTVSYNC;
-    rend = SDL_CreateRenderer(win, -1, render_flags);
-    if (!rend) {
-        PMError("error creating renderer: %s\n",SDL_GetError());
-        return;
+/*
+ * Run-ahead: run the real frame, then emulate runAheadFrames more with the
+ * same input, present that future frame and roll back to the real one.
+ * Only the last speculative frame gets rendered.
+ */
+gb_savestate runAheadState;
+Uint64 runAheadTicks = 0;
+Uint64 runAheadFrameCount = 0;
+int speculating = 0;
+
+void run_ahead_and_render(int frames) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    savestate_capture(&runAheadState);
+    /* Not in the state, state_restored() would move the next sample on */
+    uint64_t realSampleAt = sampleEventAt;
+    speculating = 1;
+    for (int i = 0; i < frames; i++) {
+        run_frame();
     }
-    SDL_SetRenderDrawColor(rend, 0, 0, 0, 0);
-    SDL_RenderClear(rend);
-    /* Support 128x64 later */
-    int SCREEN_WIDTH = 160;
-    int SCREEN_HEIGHT = 144;
-    SDL_RenderSetLogicalSize(rend, SCREEN_WIDTH, SCREEN_HEIGHT);
-  
+    speculating = 0;
+    render();
+    savestate_restore(&runAheadState);
+    state_restored();
+    sampleEventAt = realSampleAt;
+    schedule_update();
+    runAheadTicks += SDL_GetPerformanceCounter() - start;
+    runAheadFrameCount++;
+}
+
+/*
+ * Loads the ROM into a fresh emuRAM and leaves the machine as the boot ROM
+ * would. Returns the ROM's size, 0 if it could not be loaded.
+ */
+size_t power_on(const char *romPath) {
+    /* INC, DEC and DAA read their flags from these, whoever runs the CPU */
+    alu_init();
+
     /* Load ROM into 64KB memory */
     emuRAM = malloc(CART_SIZE);
     if (!emuRAM) {
         PMError("unable to allocate the 64KB emuRAM\n");
-        SDL_DestroyRenderer(rend);
-        return;
+        return 0;
     }
     FILE *fp = fopen(romPath, "r");
     if (!fp) {
         PMError("unable to open file input\n");
         free(emuRAM);
-        SDL_DestroyRenderer(rend);
-        return;
+        emuRAM = NULL;
+        return 0;
     }
     fseek(fp, 0, SEEK_END);
     size_t binarySize = ftell(fp);
     fseek(fp, 0, SEEK_SET);
     if (binarySize > CART_SIZE) {
         PMError("file too large for 64KB emuRAM\n");
+        fclose(fp);
         free(emuRAM);
-        SDL_DestroyRenderer(rend);
-        return;
+        emuRAM = NULL;
+        return 0;
     }
     size_t bytesRead = fread(emuRAM, 1, binarySize, fp);
     if (binarySize != CART_SIZE) {
         memset(emuRAM + binarySize, 0, CART_SIZE - binarySize);
     }
     fclose(fp);
-    if (bytesRead < binarySize) {
+    if (!binarySize || bytesRead < binarySize) {
         PMError("failed to read entire file, read %zd, expected %zu\n",bytesRead,binarySize);
+        free(emuRAM);
+        emuRAM = NULL;
+        return 0;
+    }
+
+    /* Nothing selected, nothing pressed */
+    emuRAM[0xFF00] = 0xCF;
+    /* As the boot ROM leaves them, VBlank already requested, nothing enabled */
+    emuRAM[IF_ADDR] = 0xE1;
+    emuRAM[IE_ADDR] = 0x00;
+    interrupts_changed();
+    emuRAM[TAC_ADDR] = 0xF8;
+    timer_reschedule();
+    emuRAM[SC_ADDR] = 0x7E;
+    /* The registers as the boot ROM leaves them, A is how games tell a CGB from a DMG */
+    cgb_reset((emuRAM[CGB_FLAG_ADDR] & 0x80) != 0);
+    if (cgbMode) {
+        af = 0x1180;
+        bc = 0x0000;
+        de = 0xFF56;
+        hl = 0x000D;
+    } else {
+        af = 0x01B0;
+        bc = 0x0013;
+        de = 0x00D8;
+        hl = 0x014D;
+    }
+    return binarySize;
+}
+
+void emulator(SDL_Window *win, const char *romPath) {
+    printf("starting emulator...\n");
+    /* Headless runs have no window and never render */
+    if (win) {
+        /*
+         * According to https://nullprogram.com/blog/2023/01/08/
+         * SDL2 already tries to create an accelerated renderer
+         * and not specifying allows for a software renderer fallback
+         */
+        Uint32 render_flags = SDL_RENDERER_PRESENTVSYNC;
+        rend = SDL_CreateRenderer(win, -1, render_flags);
+        if (!rend) {
+            PMError("error creating renderer: %s\n",SDL_GetError());
+            return;
+        }
+        SDL_SetRenderDrawColor(rend, 0, 0, 0, 0);
+        SDL_RenderClear(rend);
+        /* Support 128x64 later */
+        int SCREEN_WIDTH = 160;
+        int SCREEN_HEIGHT = 144;
+        SDL_RenderSetLogicalSize(rend, SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+
+    size_t binarySize = power_on(romPath);
+    if (!binarySize) {
+        if (rend) {
+            SDL_DestroyRenderer(rend);
+        }
+        return;
+    }
+    /* From here on logging goes through its own thread, see log.c */
+    log_start();
+    char *keymapPath = find_resource("keymap.json");
+    input_load_keymap(keymapPath);
+    free(keymapPath);
+
+    if (emuConfig.profilePath && emuConfig.core != CORE_PROFILED) {
+        printf("profile: the profiler is a core of its own, ignoring -P with -t, -b and -w\n");
+        emuConfig.profilePath = NULL;
+    }
+    if (emuConfig.core == CORE_PROFILED) {
+        coreProfile = profile_create();
+        if (!coreProfile) {
+            goto cleanup;
+        }
+    }
+
+    /* The other tiers never go through the traced, debug and profiled cores */
+    if (emuConfig.core != CORE_FAST) {
+        if (emuConfig.cachedInterpreter || emuConfig.aotPath) {
+            printf("core: tracing, debugging and profiling run in the interpreter, ignoring -c, -j and -A\n");
+        }
+        emuConfig.cachedInterpreter = 0;
+        emuConfig.jit = 0;
+        emuConfig.aotPath = NULL;
+        if (emuConfig.tracePath && core_trace_open(emuConfig.tracePath, emuConfig.traceFormat) != 0) {
+            goto cleanup;
+        }
+        core_watch_sync();
+    }
+
+    if (emuConfig.serialOutPath && serial_capture_open(emuConfig.serialOutPath) != 0) {
         goto cleanup;
     }
+    if (emuConfig.linkPath) {
+        /* Both would replay bytes the other side already took */
+        if (emuConfig.rewindBufferSize || emuConfig.runAheadFrames) {
+            printf("link: rewind and run-ahead do not work over a link cable, ignoring -r and -a\n");
+            emuConfig.rewindBufferSize = 0;
+            emuConfig.runAheadFrames = 0;
+        }
+        if (link_open(emuConfig.linkPath) != 0) {
+            goto cleanup;
+        }
+    }
+
+    if (emuConfig.samplePath) {
+        /* game.gb's symbols are in game.sym unless told otherwise */
+        char *symbolsPath = emuConfig.symbolsPath ? strdup(emuConfig.symbolsPath) : symbols_path_for(romPath);
+        int loaded = symbolsPath ? symbols_load(symbolsPath) : -1;
+        if (loaded >= 0) {
+            printf("sample: %d symbols from %s\n", loaded, symbolsPath);
+        } else if (emuConfig.symbolsPath) {
+            printf("sample: unable to read %s, naming frames by address\n", emuConfig.symbolsPath);
+        }
+        free(symbolsPath);
+        if (callstack_sample_start(emuConfig.sampleInterval) != 0) {
+            goto cleanup;
+        }
+    }
+
+    /* Blocks compiled for a different ROM would run the wrong code */
+    if (emuConfig.aotPath && aot_load(emuConfig.aotPath, rom_hash(emuRAM, binarySize)) != 0) {
+        printf("aot: falling back to the interpreter\n");
+        emuConfig.aotPath = NULL;
+    }
+
+    /* Movies start from power on and the input only lines up if nothing jumps around in time */
+    if (emuConfig.recordMoviePath || emuConfig.playMoviePath) {
+        if (emuConfig.loadStatePath) {
+            printf("movie: movies start from power on, -m and -p do not work with -l\n");
+            goto cleanup;
+        }
+        if (emuConfig.rewindBufferSize) {
+            printf("movie: rewinding would put the movie out of step, ignoring -r\n");
+            emuConfig.rewindBufferSize = 0;
+        }
+        quickLoadLocked = 1;
+    }
+
+    /* Picks up where an earlier -e run left off */
+    if (emuConfig.loadStatePath) {
+        if (savestate_read_file(&quickState, emuConfig.loadStatePath) != 0 || savestate_restore(&quickState) != 0) {
+            goto cleanup;
+        }
+        state_restored();
+        hasQuickState = 1;
+    }
+
+    movie *recordMovie = NULL;
+    movie *playMovie = NULL;
+    if (emuConfig.recordMoviePath) {
+        recordMovie = movie_record_open(emuConfig.recordMoviePath, rom_hash(emuRAM, binarySize));
+    }
+    if (emuConfig.playMoviePath) {
+        playMovie = movie_play_open(emuConfig.playMoviePath, rom_hash(emuRAM, binarySize));
+        if (!playMovie) {
+            PMError("unable to play movie %s\n", emuConfig.playMoviePath);
+        }
+    }
 
     /* Timing and frame rate control */
     const int FRAME_DELAY = 1000 / 60; /* ~16.67ms per frame for 60 FPS */
-    const int CYCLES_PER_FRAME = 70224; /* CPU cycles per frame (4.19 MHz / 60 FPS) */
     Uint32 frameStart;
     int frameTime;
 
+    rewind_buffer *rewindBuffer = NULL;
+    if (emuConfig.rewindBufferSize) {
+        rewindBuffer = rewind_create(emuConfig.rewindBufferSize);
+        if (!rewindBuffer) {
+            PMError("unable to allocate the rewind buffer\n");
+        }
+    }
+
+    hash_log *hashLog = NULL;
+    if (emuConfig.hashLogPath) {
+        hashLog = hash_log_open(emuConfig.hashLogPath, emuConfig.hashFramebuffer);
+    }
+
+    unsigned long frameCount = 0;
+    Uint64 runStart = SDL_GetPerformanceCounter();
+
     /* Main emu loop */
     while (running) {
         frameStart = SDL_GetTicks();
 
         /* Handle events */
-        handle_events();
-
-        /* Execute a batch of CPU instructions */
-        int cyclesThisFrame = 0;
-        while (cyclesThisFrame < CYCLES_PER_FRAME) {
-            int cycles = execute_instruction();
-            cyclesThisFrame += cycles;
-            update_ly(cycles); /* Update LY register */
+        if (rend) {
+            handle_events();
+        }
+
+        /* A movie overrides whatever the keyboard did */
+        if (playMovie) {
+            uint8_t buttons;
+            if (!movie_play_frame(playMovie, &buttons)) {
+                break;
+            }
+            joypad_set_buttons(buttons);
+        }
+
+        if (rewindBuffer && rewinding) {
+            /* Step back a frame instead of running one */
+            rewind_pop(rewindBuffer);
+            state_restored();
+        } else {
+            if (recordMovie) {
+                movie_record_frame(recordMovie, joypadButtons);
+            }
+
+            /* Execute a batch of CPU instructions */
+            run_frame();
+            frameCount++;
+
+            if (hashLog) {
+                hash_log_frame(hashLog);
+            }
+
+            if (rewindBuffer) {
+                rewind_push(rewindBuffer);
+            }
+        }
+
+        if (emuConfig.frameLimit && frameCount >= emuConfig.frameLimit) {
+            running = 0;
         }
 
+        /* Stopped on a breakpoint with no keyboard to resume from */
+        if (!cycle && !rend) {
+            running = 0;
+        }
+
+        /* Headless runs go as fast as they can */
+        if (!rend) {
+            continue;
+        }
 
         /* Render game state */
-        render();
+        if (emuConfig.runAheadFrames > 0 && !rewinding) {
+            run_ahead_and_render(emuConfig.runAheadFrames);
+        } else {
+            render();
+        }
 
         /* Maintain consistent frame rate */
         frameTime = SDL_GetTicks() - frameStart;
@@ -2219,9 +3034,54 @@ void emulator(SDL_Window *win, const char *romPath) {
         /* SDL_Delay(10); */
     }
 
+    if (!rend) {
+        double seconds = (double)(SDL_GetPerformanceCounter() - runStart) / (double)SDL_GetPerformanceFrequency();
+        printf("ran %lu frames in %.3fs (%.1f fps)\n", frameCount, seconds, seconds > 0 ? frameCount / seconds : 0.0);
+    }
+
+    if (emuConfig.saveStatePath) {
+        savestate_capture(&quickState);
+        savestate_write_file(&quickState, emuConfig.saveStatePath);
+    }
+
+    if (runAheadFrameCount) {
+        double usPerFrame = (double)runAheadTicks * 1000000.0 / (double)SDL_GetPerformanceFrequency() / (double)runAheadFrameCount;
+        printf("run-ahead: %d frames, %.1f us added per frame\n", emuConfig.runAheadFrames, usPerFrame);
+    }
+
+    if (emuConfig.cachedInterpreter) {
+        block_cache_report();
+    }
+    if (emuConfig.jit) {
+        jit_report();
+    }
+    if (emuConfig.aotPath) {
+        aot_report();
+    }
+    if (emuConfig.samplePath) {
+        callstack_sample_write(emuConfig.samplePath);
+    }
+    if (coreProfile) {
+        profile_print_top(coreProfile, stdout, PROFILE_TOP);
+        profile_write_json(coreProfile, emuConfig.profilePath);
+    }
+
     /* Cleanup */
+    core_trace_close();
+    movie_close(recordMovie);
+    movie_close(playMovie);
+    hash_log_close(hashLog);
+    rewind_free(rewindBuffer);
     cleanup:
+    link_close();
+    serial_capture_close();
+    profile_free(coreProfile);
+    coreProfile = NULL;
+    symbols_free();
     free(emuRAM);
-    SDL_DestroyRenderer(rend);
+    if (rend) {
+        SDL_DestroyRenderer(rend);
+    }
+    log_stop();
     printf("ended emulation.\n");
 }
\ No newline at end of file
@@ -15,10 +15,113 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_timer.h>
 #include <SDL2/SDL_image.h>
 
+/* Machine state, owned by emu.c */
+extern uint8_t *emuRAM;
+extern uint16_t af;
+extern uint16_t bc;
+extern uint16_t de;
+extern uint16_t hl;
+extern uint16_t sp;
+extern uint16_t pc;
+extern uint8_t ly;
+extern int ly_counter;
+extern uint8_t framebuffer[144][160];
+
+/* Options picked in init.c */
+typedef struct {
+    size_t rewindBufferSize; /* 0 disables rewind */
+    int runAheadFrames; /* 0 disables run-ahead */
+    int headless; /* no window, no rendering, no frame limiter */
+    unsigned long frameLimit; /* stop after this many frames, 0 runs forever */
+    const char *recordMoviePath;
+    const char *playMoviePath;
+    const char *hashLogPath; /* per-frame state hashes */
+    int hashFramebuffer; /* also render and hash the framebuffer */
+    int cachedInterpreter; /* run pre-decoded blocks, see blockcache.c */
+    int jit; /* translate hot blocks to x86-64, see jit.c */
+    int jitVerify; /* check every translated run against the interpreter */
+    char *aotPath; /* blocks compiled by honeybun-aot, see aotload.c */
+    int core; /* which interpreter core_variant runs, see core.c */
+    const char *tracePath; /* the traced core writes here */
+    int traceFormat; /* trace_format, see core.h */
+    const char *profilePath; /* the profiled core's JSON report, see profile.c */
+    const char *samplePath; /* folded call stacks, see callstack.c */
+    uint32_t sampleInterval; /* cycles between samples, 0 for the default */
+    const char *symbolsPath; /* RGBDS .sym to name them from */
+    const char *serialOutPath; /* serial output is copied here, see serial.c */
+    const char *linkPath; /* link cable shared with another honeybun */
+    const char *loadStatePath; /* save state to start from instead of power on */
+    const char *saveStatePath; /* save state written when emulation ends */
+} emu_config;
+
+extern emu_config emuConfig;
+
+/*
+ * Set while run-ahead emulates frames it is going to roll back. Anything
+ * that leaves the machine (capture files, logs, counts) skips them, the
+ * same frames run again for real later.
+ */
+extern int speculating;
+
+/* Condition codes */
+#define Z_FLAG 0x80
+#define N_FLAG 0x40
+#define H_FLAG 0x20
+#define C_FLAG 0x10
+
+/* CPU core */
+typedef int (*op_handler)(uint16_t imm);
+extern int cycle;
+extern const uint8_t opLength[256];
+extern const op_handler opTable[256];
+int execute_instruction(void);
+void write_byte(uint16_t addr, uint8_t value);
+uint8_t io_read(uint16_t addr);
+uint8_t bus_read(uint16_t addr);
+
+/* No MBC yet, so every address maps to bank 0 */
+static inline uint8_t bank_for_pc(uint16_t addr) {
+    (void)addr;
+    return 0;
+}
+
+/*
+ * Loads from busSlowBase up to busSlowReads bytes on (wrapping) take the
+ * slow way. Normally that is just the I/O registers, while OAM DMA locks
+ * the bus it is everything but HRAM.
+ */
+extern uint16_t busSlowBase;
+extern uint16_t busSlowReads;
+/* Stores take write_byte()'s slow way over the same kind of window */
+extern uint16_t busSlowWrites;
+void bus_lock(int locked);
+void bus_flat(void);
+
+/* Every CPU load that could hit an I/O register goes through here */
+static inline uint8_t read_byte(uint16_t addr) {
+    if ((uint16_t)(addr - busSlowBase) < busSlowReads) {
+        return bus_read(addr);
+    }
+    return emuRAM[addr];
+}
+
+/* Call when an event run_frame() has to stop for moves */
+void schedule_update(void);
+/* Call after doubleSpeed flips */
+void schedule_speed_changed(void);
+/* Call when LY, STAT or LYC change behind update_ly()'s back */
+void ly_schedule(void);
+
+void render_framebuffer(void);
+/* Loads the ROM and resets the machine, returns its size or 0 */
+size_t power_on(const char *romPath);
+/* One frame of emulation, nothing presented */
+void run_frame(void);
 void emulator(SDL_Window *win, const char *romPath);
 
 #endif /* EMU_H */
\ No newline at end of file
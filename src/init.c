@@ -18,15 +18,43 @@
 #include <SDL2/SDL_image.h>
 #include "resource_management.h"
 #include "emu.h"
+#include "statehash.h"
+#include "core.h"
 #include "defs.h"
 
-#define OPTSTR "i:hv"
+#define OPTSTR "i:r:a:f:m:p:S:D:A:t:T:C:b:w:O:L:P:g:G:s:l:e:FHcjJhv"
 
 extern char *optarg;
 
 void show_help(void) {
   printf("Usage: honeybun <options>\n\n");
   printf(" -i: (required) path to the ROM\n");
+  printf(" -r: (optional) rewind buffer size in MB, hold backspace to rewind\n");
+  printf(" -a: (optional) frames to run ahead, cuts input latency at the cost of CPU\n");
+  printf(" -c: (optional) cached interpreter, runs pre-decoded basic blocks\n");
+  printf(" -j: (optional) translate hot blocks to x86-64, implies -c\n");
+  printf(" -J: (optional) like -j, checking every translated block against the interpreter\n");
+  printf(" -A: (optional) run blocks compiled by honeybun-aot from this shared object\n");
+  printf(" -t: (optional) trace every instruction to a file, - for stdout\n");
+  printf(" -T: (optional) trace format, text (the default), doctor for gameboy-doctor logs, or binary, both read LY as $90\n");
+  printf(" -P: (optional) count every opcode and address, print the hottest and write JSON here, - for stdout\n");
+  printf(" -g: (optional) sample the guest call stack and write folded stacks for flamegraph.pl here, - for stdout\n");
+  printf(" -G: (optional) cycles between -g samples, defaults to 1024\n");
+  printf(" -s: (optional) RGBDS .sym file to name -g frames from, defaults to the ROM's name with .sym\n");
+  printf(" -b: (optional) pause at this hex address, any key resumes, can be repeated\n");
+  printf(" -w: (optional) pause when the byte at this hex address changes, can be repeated\n");
+  printf(" -O: (optional) copy serial port output to a file, - for stdout\n");
+  printf(" -L: (optional) link cable, run two instances with the same path\n");
+  printf(" -H: (optional) headless, no window and no frame limiter\n");
+  printf(" -f: (optional) stop after this many frames\n");
+  printf(" -l: (optional) start from a save state file instead of power on\n");
+  printf(" -e: (optional) write a save state file when emulation ends\n");
+  printf(" -m: (optional) record the joypad to a movie file\n");
+  printf(" -p: (optional) play back a movie file, stops when it ends\n");
+  printf(" -S: (optional) write a hash of the machine state every frame to a log\n");
+  printf(" -F: (optional) include the rendered framebuffer in the -S hashes\n");
+  printf(" -D <a> <b>: compare two hash logs and report the first divergent frame\n");
+  printf(" -C <a> <b>: compare two traces, or a trace and a gameboy-doctor log, and report the first divergent instruction\n");
   /* printf(" -v: (optional) verbose/show debug\n"); */
   printf(" -h: show usage\n");
   printf("The honeybun emulator and the Peppermint \"frontend\" powered by it are works of Snoolie K / 0xilis.\n");
@@ -62,6 +90,89 @@ int main(int argc, char* *argv) {
   while ((opt = getopt(argc, argv, OPTSTR)) != EOF) {
     if (opt == 'i') {
       romPath = optarg;
+    } else if (opt == 'r') {
+      emuConfig.rewindBufferSize = (size_t)atoi(optarg) * 1024 * 1024;
+    } else if (opt == 'a') {
+      emuConfig.runAheadFrames = atoi(optarg);
+    } else if (opt == 'c') {
+      emuConfig.cachedInterpreter = 1;
+    } else if (opt == 'j' || opt == 'J') {
+      emuConfig.cachedInterpreter = 1;
+      emuConfig.jit = 1;
+      emuConfig.jitVerify = (opt == 'J');
+    } else if (opt == 'A') {
+      emuConfig.aotPath = optarg;
+    } else if (opt == 't') {
+      emuConfig.tracePath = optarg;
+      if (emuConfig.core == CORE_FAST || emuConfig.core == CORE_PROFILED) {
+        emuConfig.core = CORE_TRACED;
+      }
+    } else if (opt == 'T') {
+      if (!strcmp(optarg, "doctor")) {
+        emuConfig.traceFormat = TRACE_DOCTOR;
+      } else if (!strcmp(optarg, "binary")) {
+        emuConfig.traceFormat = TRACE_BINARY;
+      } else if (!strcmp(optarg, "text")) {
+        emuConfig.traceFormat = TRACE_DISASSEMBLY;
+      } else {
+        show_help();
+        return 1;
+      }
+    } else if (opt == 'P') {
+      emuConfig.profilePath = optarg;
+      if (emuConfig.core == CORE_FAST) {
+        emuConfig.core = CORE_PROFILED;
+      }
+    } else if (opt == 'g') {
+      emuConfig.samplePath = optarg;
+    } else if (opt == 'G') {
+      emuConfig.sampleInterval = (uint32_t)strtoul(optarg, NULL, 10);
+    } else if (opt == 's') {
+      emuConfig.symbolsPath = optarg;
+    } else if (opt == 'b') {
+      core_add_breakpoint((uint16_t)strtoul(optarg, NULL, 16));
+      emuConfig.core = CORE_DEBUG;
+    } else if (opt == 'w') {
+      core_add_watchpoint((uint16_t)strtoul(optarg, NULL, 16));
+      emuConfig.core = CORE_DEBUG;
+    } else if (opt == 'O') {
+      emuConfig.serialOutPath = optarg;
+    } else if (opt == 'L') {
+      emuConfig.linkPath = optarg;
+    } else if (opt == 'H') {
+      emuConfig.headless = 1;
+    } else if (opt == 'f') {
+      emuConfig.frameLimit = strtoul(optarg, NULL, 10);
+    } else if (opt == 'l') {
+      emuConfig.loadStatePath = optarg;
+    } else if (opt == 'e') {
+      emuConfig.saveStatePath = optarg;
+    } else if (opt == 'm') {
+      emuConfig.recordMoviePath = optarg;
+    } else if (opt == 'p') {
+      emuConfig.playMoviePath = optarg;
+    } else if (opt == 'S') {
+      emuConfig.hashLogPath = optarg;
+    } else if (opt == 'F') {
+      emuConfig.hashFramebuffer = 1;
+    } else if (opt == 'D') {
+      /* Compare two hash logs and exit */
+      if (optind >= argc) {
+        show_help();
+        return 1;
+      }
+      int diverged = hash_log_compare(optarg, argv[optind]);
+      free(resourcesPath);
+      return diverged ? 1 : 0;
+    } else if (opt == 'C') {
+      /* Compare two traces and exit */
+      if (optind >= argc) {
+        show_help();
+        return 1;
+      }
+      int diverged = core_trace_compare(optarg, argv[optind]);
+      free(resourcesPath);
+      return diverged ? 1 : 0;
     } else if (opt == 'h') {
       /* Show help */
       show_help();
@@ -77,6 +188,16 @@ int main(int argc, char* *argv) {
 
   jumpstart:
   PMDLog("ROM path: %s\n", romPath);
+  if (emuConfig.headless) {
+    if (SDL_Init(SDL_INIT_TIMER) != 0) {
+      PMError("error with SDL: %s\n",SDL_GetError());
+      return 1;
+    }
+    emulator(NULL, (const char *)romPath);
+    free(resourcesPath);
+    SDL_Quit();
+    return 0;
+  }
   if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_TIMER) != 0) {
     PMError("error with SDL: %s\n",SDL_GetError());
     return 1;
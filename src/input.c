@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "input.h"
+#include "seajson.h"
+#include "emu.h"
+#include "interrupts.h"
+
+uint8_t keymap[SDL_NUM_SCANCODES];
+uint8_t joypadButtons = 0;
+
+static const struct {
+    const char *name;
+    uint8_t button;
+    SDL_Scancode fallback;
+} buttonNames[8] = {
+    { "right", JOYPAD_RIGHT, SDL_SCANCODE_RIGHT },
+    { "left", JOYPAD_LEFT, SDL_SCANCODE_LEFT },
+    { "up", JOYPAD_UP, SDL_SCANCODE_UP },
+    { "down", JOYPAD_DOWN, SDL_SCANCODE_DOWN },
+    { "a", JOYPAD_A, SDL_SCANCODE_X },
+    { "b", JOYPAD_B, SDL_SCANCODE_Z },
+    { "select", JOYPAD_SELECT, SDL_SCANCODE_RSHIFT },
+    { "start", JOYPAD_START, SDL_SCANCODE_RETURN },
+};
+
+/*
+ * Builds the scancode table once, so the event loop is a single lookup.
+ * The config maps button names to SDL key names, for example
+ * {"a":"X","b":"Z","start":"Return","select":"Right Shift"}
+ * Buttons missing from the config (or no config at all) keep the defaults.
+ */
+void input_load_keymap(const char *path) {
+    memset(keymap, 0, sizeof(keymap));
+    seajson json = NULL;
+    if (path && access(path, F_OK) == 0) {
+        seajson raw = init_json_from_file(path);
+        json = remove_whitespace_from_json(raw);
+        free_json(raw);
+    }
+    for (int i = 0; i < 8; i++) {
+        SDL_Scancode scancode = buttonNames[i].fallback;
+        char *keyName = json ? get_string(json, buttonNames[i].name) : NULL;
+        if (keyName) {
+            SDL_Scancode mapped = SDL_GetScancodeFromName(keyName);
+            if (mapped == SDL_SCANCODE_UNKNOWN) {
+                fprintf(stderr, "keymap: unknown key \"%s\" for %s, using default\n", keyName, buttonNames[i].name);
+            } else {
+                scancode = mapped;
+            }
+            free(keyName);
+        }
+        keymap[scancode] |= buttonNames[i].button;
+    }
+    if (json) {
+        free_json(json);
+    }
+}
+
+/*
+ * P1/JOYP (0xFF00). Bits 4 and 5 select the d-pad and the buttons (active
+ * low), the low nibble reads back the selected lines (also active low).
+ * Kept current in emuRAM so reads stay plain loads.
+ */
+static void joypad_update_p1(void) {
+    uint8_t p1 = emuRAM[0xFF00];
+    uint8_t lines = 0;
+    if (!(p1 & 0x10)) {
+        lines |= joypadButtons & 0x0F;
+    }
+    if (!(p1 & 0x20)) {
+        lines |= joypadButtons >> 4;
+    }
+    uint8_t newP1 = 0xC0 | (p1 & 0x30) | (~lines & 0x0F);
+    /* Any selected line going from high to low raises the joypad interrupt */
+    if (p1 & ~newP1 & 0x0F) {
+        interrupt_request(INT_JOYPAD);
+    }
+    emuRAM[0xFF00] = newP1;
+}
+
+void joypad_set_buttons(uint8_t buttons) {
+    joypadButtons = buttons;
+    joypad_update_p1();
+}
+
+void joypad_write(uint8_t value) {
+    /* Only the select bits are writable */
+    emuRAM[0xFF00] = (emuRAM[0xFF00] & 0xCF) | (value & 0x30);
+    joypad_update_p1();
+}
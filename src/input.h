@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+/* Button bits, 1 = pressed. Low nibble is the d-pad, high nibble the buttons */
+#define JOYPAD_RIGHT  0x01
+#define JOYPAD_LEFT   0x02
+#define JOYPAD_UP     0x04
+#define JOYPAD_DOWN   0x08
+#define JOYPAD_A      0x10
+#define JOYPAD_B      0x20
+#define JOYPAD_SELECT 0x40
+#define JOYPAD_START  0x80
+
+/* Scancode -> button bits, 0 if the key does nothing */
+extern uint8_t keymap[SDL_NUM_SCANCODES];
+extern uint8_t joypadButtons;
+
+void input_load_keymap(const char *path);
+void joypad_set_buttons(uint8_t buttons);
+void joypad_write(uint8_t value);
+
+#endif /* INPUT_H */
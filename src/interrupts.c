@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#include "interrupts.h"
+#include "emu.h"
+#include "callstack.h"
+#include "codepages.h"
+
+int interrupts_enabled = 0;
+int imeDelay = 0;
+int halted = 0;
+int interruptCheck = 0;
+
+/* IF and IE live in emuRAM, so reads of them stay plain loads */
+uint8_t interrupts_pending(void) {
+    return emuRAM[IF_ADDR] & emuRAM[IE_ADDR] & INT_MASK;
+}
+
+void interrupts_changed(void) {
+    interruptCheck = (interrupts_enabled && interrupts_pending()) || imeDelay || halted;
+    if (interruptCheck) {
+        /* Whatever block is running stops after this op so the interrupt goes first */
+        codeWritten = 1;
+    }
+}
+
+/* Called by whatever raises one, the CPU sees it at its next boundary */
+void interrupt_request(uint8_t mask) {
+    emuRAM[IF_ADDR] |= mask;
+    interrupts_changed();
+}
+
+/* Jumps to the vector of the highest priority one, returns the cycles */
+int interrupt_dispatch(uint8_t pending) {
+    int bit = __builtin_ctz(pending);
+    emuRAM[IF_ADDR] &= ~(1 << bit);
+    interrupts_enabled = 0;
+
+    sp -= 2;
+    write_byte(sp, pc & 0xFF);
+    write_byte(sp + 1, (pc >> 8) & 0xFF);
+    callstack_push(pc, 0x0040 + bit * 8);
+    pc = 0x0040 + bit * 8;
+
+    interrupts_changed();
+    return INTERRUPT_CYCLES;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#ifndef INTERRUPTS_H
+#define INTERRUPTS_H
+
+#include <stdint.h>
+
+/* IF (0xFF0F) and IE (0xFFFF) bits, lowest bit wins */
+#define INT_VBLANK 0x01
+#define INT_STAT 0x02
+#define INT_TIMER 0x04
+#define INT_SERIAL 0x08
+#define INT_JOYPAD 0x10
+#define INT_MASK 0x1F
+
+#define IF_ADDR 0xFF0F
+#define IE_ADDR 0xFFFF
+
+/* Taken by servicing one, on top of whatever the CPU was doing */
+#define INTERRUPT_CYCLES 20
+
+extern int interrupts_enabled; /* IME */
+extern int imeDelay; /* EI was run, IME comes on after the next instruction */
+extern int halted;
+
+/*
+ * Nonzero while the CPU has anything to do with interrupts before its
+ * next instruction: one could be serviced, EI is waiting or it is halted.
+ * Kept current by everything that changes IF, IE or IME, so the common
+ * nothing-pending case costs run_frame() one test.
+ */
+extern int interruptCheck;
+
+void interrupt_request(uint8_t mask);
+void interrupts_changed(void);
+uint8_t interrupts_pending(void);
+int interrupt_dispatch(uint8_t pending);
+
+#endif /* INTERRUPTS_H */
@@ -0,0 +1,876 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jit.h"
+#include "savestate.h"
+#include "opcodes.h"
+
+/*
+ * x86-64 dynarec. Hot blocks from the block cache get translated to
+ * native code. While a translated block runs, the guest registers live
+ * in host registers:
+ *   ebx = AF, ebp = BC, r12d = DE, r13d = HL (16 bits each)
+ *   r14 = emuRAM, r15d = cycles so far
+ * All of them are callee-saved, so C helpers can be called without
+ * saving anything. Loads and stores go straight to emuRAM, except loads
+ * from I/O registers take io_read() and stores to the I/O page or a page
+ * with decoded code take write_byte(). Ops with no translation call their handler instead,
+ * with the registers written back around the call.
+ *
+ * A translated block returns the cycles it took and leaves pc where
+ * the interpreter would have. Linux on x86-64 only, anywhere else
+ * jit_compile() turns every block down and the cached interpreter runs.
+ */
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+static unsigned long jitBlocks = 0;
+static unsigned long jitRejected = 0;
+static unsigned long jitVerified = 0;
+static unsigned long jitMismatches = 0;
+
+#if JIT_SUPPORTED
+
+enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/* Where the guest lives while a block runs */
+#define HOST_AF RBX
+#define HOST_BC RBP
+#define HOST_DE R12
+#define HOST_HL R13
+#define HOST_MEM R14
+#define HOST_CYCLES R15
+
+/* x86 condition codes */
+#define CC_B 0x2
+#define CC_AE 0x3
+#define CC_E 0x4
+#define CC_NE 0x5
+#define CC_A 0x7
+
+/* Group 1 /digit for the 0x81 immediate forms */
+#define ALU_ADD 0
+#define ALU_OR 1
+#define ALU_AND 4
+#define ALU_SUB 5
+#define ALU_XOR 6
+#define ALU_CMP 7
+
+#define SHIFT_SHL 4
+#define SHIFT_SHR 5
+
+/* Register-register forms, op r/m32, r32 */
+#define OP_ADD 0x01
+#define OP_OR 0x09
+#define OP_AND 0x21
+#define OP_SUB 0x29
+#define OP_XOR 0x31
+#define OP_CMP 0x39
+
+static uint8_t *codeCache = NULL;
+static size_t codeUsed = 0;
+static uint8_t *out;
+
+/* Jumps to the shared exit, patched once it is emitted */
+static uint8_t *exitPatches[BLOCK_MAX_OPS * 4];
+static int exitPatchCount;
+
+static void emit8(uint8_t byte) {
+    *out++ = byte;
+}
+
+static void emit16(uint16_t value) {
+    memcpy(out, &value, 2);
+    out += 2;
+}
+
+static void emit32(uint32_t value) {
+    memcpy(out, &value, 4);
+    out += 4;
+}
+
+static void emit64(uint64_t value) {
+    memcpy(out, &value, 8);
+    out += 8;
+}
+
+/* REX prefix, left out when nothing needs it. force is for spl/bpl/sil/dil */
+static void emit_rex(int w, int reg, int index, int base, int force) {
+    uint8_t rex = 0x40 | (w << 3) | ((reg >= 8) << 2) | ((index >= 8) << 1) | (base >= 8);
+    if (rex != 0x40 || force) {
+        emit8(rex);
+    }
+}
+
+static void emit_modrm(int mod, int reg, int rm) {
+    emit8((mod << 6) | ((reg & 7) << 3) | (rm & 7));
+}
+
+static int byte_needs_rex(int reg) {
+    return reg >= RSP && reg <= RDI;
+}
+
+static void emit_mov(int dst, int src) {
+    emit_rex(0, src, 0, dst, 0);
+    emit8(0x89);
+    emit_modrm(3, src, dst);
+}
+
+static void emit_mov_imm(int dst, uint32_t imm) {
+    emit_rex(0, 0, 0, dst, 0);
+    emit8(0xB8 + (dst & 7));
+    emit32(imm);
+}
+
+static void emit_mov_imm64(int dst, uint64_t imm) {
+    emit_rex(1, 0, 0, dst, 1);
+    emit8(0xB8 + (dst & 7));
+    emit64(imm);
+}
+
+static void emit_alu_imm(int op, int dst, uint32_t imm) {
+    emit_rex(0, 0, 0, dst, 0);
+    emit8(0x81);
+    emit_modrm(3, op, dst);
+    emit32(imm);
+}
+
+static void emit_alu(int opcode, int dst, int src) {
+    emit_rex(0, src, 0, dst, 0);
+    emit8(opcode);
+    emit_modrm(3, src, dst);
+}
+
+static void emit_shift(int op, int dst, uint8_t count) {
+    emit_rex(0, 0, 0, dst, 0);
+    emit8(0xC1);
+    emit_modrm(3, op, dst);
+    emit8(count);
+}
+
+static void emit_test_imm(int dst, uint32_t imm) {
+    emit_rex(0, 0, 0, dst, 0);
+    emit8(0xF7);
+    emit_modrm(3, 0, dst);
+    emit32(imm);
+}
+
+/* setcc dst8; movzx dst, dst8 */
+static void emit_setcc(int cc, int dst) {
+    emit_rex(0, 0, 0, dst, byte_needs_rex(dst));
+    emit8(0x0F);
+    emit8(0x90 + cc);
+    emit_modrm(3, 0, dst);
+    emit_rex(0, dst, 0, dst, byte_needs_rex(dst));
+    emit8(0x0F);
+    emit8(0xB6);
+    emit_modrm(3, dst, dst);
+}
+
+/* movzx dst, byte [r14 + index] */
+static void emit_load8(int dst, int index) {
+    emit_rex(0, dst, index, HOST_MEM, 0);
+    emit8(0x0F);
+    emit8(0xB6);
+    emit_modrm(0, dst, 4);
+    emit8(((index & 7) << 3) | (HOST_MEM & 7));
+}
+
+/* mov byte [r14 + index], src8 */
+static void emit_store8(int index, int src) {
+    emit_rex(0, src, index, HOST_MEM, byte_needs_rex(src));
+    emit8(0x88);
+    emit_modrm(0, src, 4);
+    emit8(((index & 7) << 3) | (HOST_MEM & 7));
+}
+
+/* movzx dst, word [addr], through rax */
+static void emit_load16_global(int dst, const void *addr) {
+    emit_mov_imm64(RAX, (uint64_t)(uintptr_t)addr);
+    emit_rex(0, dst, 0, RAX, 0);
+    emit8(0x0F);
+    emit8(0xB7);
+    emit_modrm(0, dst, RAX);
+}
+
+/* mov word [addr], src16, through rax */
+static void emit_store16_global(const void *addr, int src) {
+    emit_mov_imm64(RAX, (uint64_t)(uintptr_t)addr);
+    emit8(0x66);
+    emit_rex(0, src, 0, RAX, 0);
+    emit8(0x89);
+    emit_modrm(0, src, RAX);
+}
+
+/* mov word [&pc], value */
+static void emit_set_pc(uint16_t value) {
+    emit_mov_imm64(RAX, (uint64_t)(uintptr_t)&pc);
+    emit8(0x66);
+    emit8(0xC7);
+    emit_modrm(0, 0, RAX);
+    emit16(value);
+}
+
+static void emit_call(const void *fn) {
+    emit_mov_imm64(RAX, (uint64_t)(uintptr_t)fn);
+    emit8(0xFF);
+    emit_modrm(3, 2, RAX);
+}
+
+/* jcc rel32 with the offset left for emit_patch() */
+static uint8_t *emit_jcc(int cc) {
+    emit8(0x0F);
+    emit8(0x80 + cc);
+    emit32(0);
+    return out - 4;
+}
+
+static uint8_t *emit_jmp(void) {
+    emit8(0xE9);
+    emit32(0);
+    return out - 4;
+}
+
+static void emit_patch(uint8_t *rel, const uint8_t *target) {
+    int32_t offset = (int32_t)(target - (rel + 4));
+    memcpy(rel, &offset, 4);
+}
+
+static void emit_jmp_exit(void) {
+    exitPatches[exitPatchCount++] = emit_jmp();
+}
+
+static void emit_add_cycles(int cycles) {
+    if (cycles) {
+        emit_alu_imm(ALU_ADD, HOST_CYCLES, (uint32_t)cycles);
+    }
+}
+
+/* Guest registers out to the globals and back, around C calls */
+static void emit_spill(void) {
+    emit_store16_global(&af, HOST_AF);
+    emit_store16_global(&bc, HOST_BC);
+    emit_store16_global(&de, HOST_DE);
+    emit_store16_global(&hl, HOST_HL);
+}
+
+static void emit_reload(void) {
+    emit_load16_global(HOST_AF, &af);
+    emit_load16_global(HOST_BC, &bc);
+    emit_load16_global(HOST_DE, &de);
+    emit_load16_global(HOST_HL, &hl);
+}
+
+/* SM83 register field order: B C D E H L [HL] A */
+static const int pairOf[8] = { HOST_BC, HOST_BC, HOST_DE, HOST_DE, HOST_HL, HOST_HL, -1, HOST_AF };
+static const int isHigh[8] = { 1, 0, 1, 0, 1, 0, 0, 1 };
+
+static void emit_get8(int dst, int reg) {
+    emit_mov(dst, pairOf[reg]);
+    if (isHigh[reg]) {
+        emit_shift(SHIFT_SHR, dst, 8);
+    } else {
+        emit_alu_imm(ALU_AND, dst, 0xFF);
+    }
+}
+
+/* src must hold 0-255 and is clobbered */
+static void emit_set8(int reg, int src) {
+    int pair = pairOf[reg];
+    if (isHigh[reg]) {
+        emit_alu_imm(ALU_AND, pair, 0x00FF);
+        emit_shift(SHIFT_SHL, src, 8);
+    } else {
+        emit_alu_imm(ALU_AND, pair, 0xFF00);
+    }
+    emit_alu(OP_OR, pair, src);
+}
+
+/* Flags are built up in esi, then merged into F leaving the other bits alone */
+static void emit_flags_begin(void) {
+    emit_alu(OP_XOR, RSI, RSI);
+}
+
+static void emit_flag_cc(int cc, uint8_t flag) {
+    emit_setcc(cc, RCX);
+    emit_shift(SHIFT_SHL, RCX, (uint8_t)__builtin_ctz(flag));
+    emit_alu(OP_OR, RSI, RCX);
+}
+
+static void emit_flag_set(uint8_t flag) {
+    emit_alu_imm(ALU_OR, RSI, flag);
+}
+
+static void emit_flags_end(uint8_t mask) {
+    emit_alu_imm(ALU_AND, HOST_AF, 0xFFFF & ~mask);
+    emit_alu(OP_OR, HOST_AF, RSI);
+}
+
+/* Z from eax, which has to hold 0-255 */
+static void emit_flag_z(void) {
+    emit_test_imm(RAX, 0xFF);
+    emit_flag_cc(CC_E, Z_FLAG);
+}
+
+/*
+ * Store eax to the address in edi. Plain RAM is written in place, the
+ * I/O page and pages with code go through write_byte(). That can make
+ * the running block stale, in which case leave with pc past this op.
+ * Stores always come last in an op so nothing is left half done.
+ */
+static void emit_store(uint16_t nextPc, int cyclesSoFar) {
+    emit_alu_imm(ALU_CMP, RDI, 0xFF00);
+    uint8_t *toSlowIo = emit_jcc(CC_AE);
+    emit_mov(RCX, RDI);
+    emit_shift(SHIFT_SHR, RCX, CODE_PAGE_SHIFT);
+    emit_mov_imm64(RDX, (uint64_t)(uintptr_t)pageHasCode);
+    /* cmp byte [rdx + rcx], 0 */
+    emit8(0x80);
+    emit_modrm(0, 7, 4);
+    emit8((RCX << 3) | RDX);
+    emit8(0);
+    uint8_t *toSlowCode = emit_jcc(CC_NE);
+    emit_store8(RDI, RAX);
+    uint8_t *done = emit_jmp();
+
+    emit_patch(toSlowIo, out);
+    emit_patch(toSlowCode, out);
+    emit_mov(RSI, RAX);
+    emit_call(write_byte);
+    emit_mov_imm64(RAX, (uint64_t)(uintptr_t)&codeWritten);
+    emit8(0x8B); /* mov eax, [rax] */
+    emit_modrm(0, RAX, RAX);
+    emit_test_imm(RAX, 0xFFFFFFFF);
+    uint8_t *stillValid = emit_jcc(CC_E);
+    emit_set_pc(nextPc);
+    emit_add_cycles(cyclesSoFar);
+    emit_jmp_exit();
+    emit_patch(stillValid, out);
+    emit_patch(done, out);
+}
+
+/* dst = io_read(edi) */
+static void emit_io_read(int dst) {
+    emit_call(io_read);
+    /* movzx eax, al */
+    emit8(0x0F);
+    emit8(0xB6);
+    emit_modrm(3, RAX, RAX);
+    emit_mov(dst, RAX);
+}
+
+/*
+ * Load the byte at the address in addrReg into dst. The I/O registers go
+ * through io_read() like read_byte() sends them, since some are worked
+ * out when read. Everything else is a plain load.
+ */
+static void emit_load(int dst, int addrReg) {
+    emit_mov(RCX, addrReg);
+    emit_alu_imm(ALU_SUB, RCX, 0xFF00);
+    emit_alu_imm(ALU_CMP, RCX, 0x80);
+    uint8_t *toIo = emit_jcc(CC_B);
+    emit_load8(dst, addrReg);
+    uint8_t *done = emit_jmp();
+    emit_patch(toIo, out);
+    emit_mov(RDI, addrReg);
+    emit_io_read(dst);
+    emit_patch(done, out);
+}
+
+/* 8-bit ALU on A with the operand in edx, the way the handlers do it */
+static void emit_alu8(int kind) {
+    emit_get8(RAX, 7);
+    emit_flags_begin();
+    switch (kind) {
+        case 0: /* ADD */
+            emit_mov(RDI, RAX);
+            emit_alu_imm(ALU_AND, RDI, 0x0F);
+            emit_mov(RCX, RDX);
+            emit_alu_imm(ALU_AND, RCX, 0x0F);
+            emit_alu(OP_ADD, RDI, RCX);
+            emit_alu_imm(ALU_CMP, RDI, 0x0F);
+            emit_flag_cc(CC_A, H_FLAG);
+            emit_alu(OP_ADD, RAX, RDX);
+            emit_alu_imm(ALU_CMP, RAX, 0xFF);
+            emit_flag_cc(CC_A, C_FLAG);
+            emit_alu_imm(ALU_AND, RAX, 0xFF);
+            break;
+        case 2: /* SUB */
+        case 7: /* CP */
+            emit_mov(RDI, RAX);
+            emit_alu_imm(ALU_AND, RDI, 0x0F);
+            emit_mov(RCX, RDX);
+            emit_alu_imm(ALU_AND, RCX, 0x0F);
+            emit_alu(OP_CMP, RDI, RCX);
+            emit_flag_cc(CC_B, H_FLAG);
+            emit_alu(OP_CMP, RAX, RDX);
+            emit_flag_cc(CC_B, C_FLAG);
+            emit_alu(OP_SUB, RAX, RDX);
+            emit_alu_imm(ALU_AND, RAX, 0xFF);
+            emit_flag_set(N_FLAG);
+            break;
+        case 4: /* AND */
+            emit_alu(OP_AND, RAX, RDX);
+            emit_flag_set(H_FLAG);
+            break;
+        case 5: /* XOR */
+            emit_alu(OP_XOR, RAX, RDX);
+            break;
+        case 6: /* OR */
+            emit_alu(OP_OR, RAX, RDX);
+            break;
+    }
+    emit_flag_z();
+    emit_flags_end(Z_FLAG | N_FLAG | H_FLAG | C_FLAG);
+    if (kind != 7) {
+        emit_set8(7, RAX);
+    }
+}
+
+/* INC r / DEC r, C is left alone */
+static void emit_incdec8(int reg, int dec) {
+    emit_get8(RAX, reg);
+    emit_alu_imm(dec ? ALU_SUB : ALU_ADD, RAX, 1);
+    emit_alu_imm(ALU_AND, RAX, 0xFF);
+    emit_flags_begin();
+    emit_flag_z();
+    emit_mov(RDX, RAX);
+    emit_alu_imm(ALU_AND, RDX, 0x0F);
+    if (dec) {
+        emit_alu_imm(ALU_CMP, RDX, 0x0F);
+    }
+    emit_flag_cc(CC_E, H_FLAG);
+    if (dec) {
+        emit_flag_set(N_FLAG);
+    }
+    emit_flags_end(Z_FLAG | N_FLAG | H_FLAG);
+    emit_set8(reg, RAX);
+}
+
+static void emit_incdec16(int pair, int dec) {
+    emit_alu_imm(dec ? ALU_SUB : ALU_ADD, pair, 1);
+    emit_alu_imm(ALU_AND, pair, 0xFFFF);
+}
+
+/* Ops emit_op() has a translation for, the rest call their handler */
+static int translates(uint8_t opcode) {
+    switch (opcode) {
+        case 0x00:
+        case 0x01: case 0x11: case 0x21:
+        case 0x03: case 0x13: case 0x23: case 0x0B: case 0x1B: case 0x2B:
+        case 0x02: case 0x12: case 0x0A: case 0x1A:
+        case 0x22: case 0x32: case 0x2A: case 0x3A:
+        case 0x04: case 0x0C: case 0x14: case 0x1C: case 0x24: case 0x2C: case 0x3C:
+        case 0x05: case 0x0D: case 0x15: case 0x1D: case 0x25: case 0x2D: case 0x3D:
+        case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x3E:
+        case 0x36:
+        case 0xC6: case 0xD6: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+        case 0xE0: case 0xF0: case 0xEA: case 0xFA: case 0xE2:
+            return 1;
+        case 0x76: /* HALT */
+            return 0;
+    }
+    if (opcode >= 0x40 && opcode <= 0x7F) {
+        return 1; /* LD r, r' */
+    }
+    if (opcode >= 0x80 && opcode <= 0xBF) {
+        int kind = (opcode >> 3) & 7;
+        return kind != 1 && kind != 3; /* not ADC, SBC */
+    }
+    return 0;
+}
+
+/* Cycles from the opcode table, 0 means no translation */
+static int native_cycles(uint8_t opcode) {
+    return translates(opcode) ? opInfo[opcode].cycles : 0;
+}
+
+/* Straight-line op, returns 0 if it has no translation */
+static int emit_op(const micro_op *op, int cyclesSoFar) {
+    uint8_t opcode = op->opcode;
+    int cycles = native_cycles(opcode);
+    if (!cycles) {
+        return 0;
+    }
+    int after = cyclesSoFar + cycles;
+    switch (opcode) {
+        case 0x00:
+            return cycles;
+        case 0x01: case 0x11: case 0x21:
+            emit_mov_imm(pairOf[(opcode >> 4) * 2], op->imm);
+            return cycles;
+        case 0x03: case 0x13: case 0x23:
+            emit_incdec16(pairOf[(opcode >> 4) * 2], 0);
+            return cycles;
+        case 0x0B: case 0x1B: case 0x2B:
+            emit_incdec16(pairOf[(opcode >> 4) * 2], 1);
+            return cycles;
+        case 0x02: case 0x12:
+            emit_mov(RDI, pairOf[(opcode >> 4) * 2]);
+            emit_get8(RAX, 7);
+            emit_store(op->nextPc, after);
+            return cycles;
+        case 0x0A: case 0x1A:
+            emit_load(RAX, pairOf[(opcode >> 4) * 2]);
+            emit_set8(7, RAX);
+            return cycles;
+        case 0x22: case 0x32:
+            emit_mov(RDI, HOST_HL);
+            emit_incdec16(HOST_HL, opcode == 0x32);
+            emit_get8(RAX, 7);
+            emit_store(op->nextPc, after);
+            return cycles;
+        case 0x2A: case 0x3A:
+            emit_load(RAX, HOST_HL);
+            emit_set8(7, RAX);
+            emit_incdec16(HOST_HL, opcode == 0x3A);
+            return cycles;
+        case 0x36:
+            emit_mov(RDI, HOST_HL);
+            emit_mov_imm(RAX, op->imm & 0xFF);
+            emit_store(op->nextPc, after);
+            return cycles;
+        case 0xC6: case 0xD6: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+            emit_mov_imm(RDX, op->imm & 0xFF);
+            emit_alu8((opcode >> 3) & 7);
+            return cycles;
+        case 0xE0: case 0xEA: case 0xE2:
+            if (opcode == 0xE2) {
+                emit_mov(RDI, HOST_BC);
+                emit_alu_imm(ALU_AND, RDI, 0xFF);
+                emit_alu_imm(ALU_OR, RDI, 0xFF00);
+            } else {
+                emit_mov_imm(RDI, opcode == 0xE0 ? 0xFF00 | (op->imm & 0xFF) : op->imm);
+            }
+            emit_get8(RAX, 7);
+            emit_store(op->nextPc, after);
+            return cycles;
+        case 0xF0: case 0xFA: {
+            uint16_t addr = opcode == 0xF0 ? 0xFF00 | (op->imm & 0xFF) : op->imm;
+            emit_mov_imm(RDI, addr);
+            if ((uint16_t)(addr - 0xFF00) < 0x80) {
+                emit_io_read(RAX);
+            } else {
+                emit_load8(RAX, RDI);
+            }
+            emit_set8(7, RAX);
+            return cycles;
+        }
+    }
+    if (opcode < 0x40) {
+        int reg = (opcode >> 3) & 7;
+        switch (opcode & 7) {
+            case 4:
+                emit_incdec8(reg, 0);
+                break;
+            case 5:
+                emit_incdec8(reg, 1);
+                break;
+            case 6:
+                emit_mov_imm(RAX, op->imm & 0xFF);
+                emit_set8(reg, RAX);
+                break;
+        }
+        return cycles;
+    }
+    int src = opcode & 7;
+    if (src == 6) {
+        emit_load(RDX, HOST_HL);
+    } else {
+        emit_get8(RDX, src);
+    }
+    if (opcode < 0x80) {
+        int dst = (opcode >> 3) & 7;
+        if (dst == 6) {
+            emit_mov(RDI, HOST_HL);
+            emit_mov(RAX, RDX);
+            emit_store(op->nextPc, after);
+        } else {
+            emit_set8(dst, RDX);
+        }
+        return cycles;
+    }
+    emit_alu8((opcode >> 3) & 7);
+    return cycles;
+}
+
+/* Calls the op's handler with the guest state written back around it */
+static void emit_handler_call(const micro_op *op, int cyclesSoFar, int last) {
+    emit_add_cycles(cyclesSoFar);
+    emit_spill();
+    emit_set_pc(op->nextPc);
+    emit_mov_imm(RDI, op->imm);
+    emit_call(op->handler);
+    emit_alu(OP_ADD, HOST_CYCLES, RAX);
+    emit_reload();
+    if (!last) {
+        emit_mov_imm64(RAX, (uint64_t)(uintptr_t)&codeWritten);
+        emit8(0x8B);
+        emit_modrm(0, RAX, RAX);
+        emit_test_imm(RAX, 0xFFFFFFFF);
+        uint8_t *stillValid = emit_jcc(CC_E);
+        emit_jmp_exit();
+        emit_patch(stillValid, out);
+    }
+}
+
+/* JR, JR cc and JP a16 as the last op. Returns 0 to use the handler */
+static int emit_branch(const micro_op *op, int cyclesSoFar) {
+    uint16_t target = (uint16_t)(op->nextPc + (int8_t)op->imm);
+    const opcode_info *info = &opInfo[op->opcode];
+    int flag = 0, taken = info->branchCycles, notTaken = info->cycles, whenSet = 0;
+    switch (op->opcode) {
+        case 0x18:
+            emit_set_pc(target);
+            emit_add_cycles(cyclesSoFar + info->cycles);
+            return 1;
+        case 0xC3:
+            emit_set_pc(op->imm);
+            emit_add_cycles(cyclesSoFar + info->cycles);
+            return 1;
+        case 0x20: flag = Z_FLAG; break;
+        case 0x28: flag = Z_FLAG; whenSet = 1; break;
+        case 0x30: flag = C_FLAG; break;
+        case 0x38: flag = C_FLAG; whenSet = 1; break;
+        default:
+            return 0;
+    }
+    emit_test_imm(HOST_AF, flag);
+    uint8_t *skip = emit_jcc(whenSet ? CC_E : CC_NE);
+    emit_set_pc(target);
+    emit_add_cycles(cyclesSoFar + taken);
+    emit_jmp_exit();
+    emit_patch(skip, out);
+    emit_set_pc(op->nextPc);
+    emit_add_cycles(cyclesSoFar + notTaken);
+    return 1;
+}
+
+/* Blocks spending their time on I/O registers stay in the cached interpreter */
+static int touches_io(const micro_op *op) {
+    switch (op->opcode) {
+        case 0xE0: case 0xF0: case 0xE2: case 0xF2:
+            return 1;
+        case 0xEA: case 0xFA:
+            return op->imm >= 0xFF00;
+        default:
+            return 0;
+    }
+}
+
+static int jit_init(void) {
+    if (codeCache) {
+        return 1;
+    }
+    void *mem = mmap(NULL, JIT_CACHE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        printf("jit: unable to map the code cache, staying on the cached interpreter\n");
+        emuConfig.jit = 0;
+        return 0;
+    }
+    codeCache = mem;
+    return 1;
+}
+
+void jit_reset(void) {
+    codeUsed = 0;
+}
+
+/* Translates a block, returns 1 if block->native is now set */
+int jit_compile(decoded_block *block) {
+    block->jitTried = 1;
+    if (!jit_init()) {
+        return 0;
+    }
+
+    /* Plain ops only, superinstructions are the cached interpreter's business */
+    const micro_op *ops[BLOCK_MAX_OPS];
+    int count = 0, io = 0;
+    for (int i = 0; i < block->count; i++) {
+        const micro_op *op = &block->ops[i];
+        if (op->fusedOps) {
+            const superinstruction *super = NULL;
+            for (int j = 0; j < superTableCount; j++) {
+                if (superTable[j].fused == op->fused) {
+                    super = &superTable[j];
+                }
+            }
+            if (super && super->loop) {
+                /* A bulk copy or fill beats anything we would emit */
+                jitRejected++;
+                return 0;
+            }
+            continue;
+        }
+        io += touches_io(op);
+        ops[count++] = op;
+    }
+    if (io * 2 > count) {
+        jitRejected++;
+        return 0;
+    }
+
+    /* Ops before the last need translations, so their cycles are known up front */
+    int leadCycles = 0;
+    for (int i = 0; i < count - 1; i++) {
+        int cycles = native_cycles(ops[i]->opcode);
+        if (!cycles) {
+            jitRejected++;
+            return 0;
+        }
+        leadCycles += cycles;
+    }
+
+    if (codeUsed + JIT_MAX_BLOCK_CODE > JIT_CACHE_SIZE) {
+        /* Full, start over along with the blocks pointing into it */
+        block_cache_flush();
+        return 0;
+    }
+    uint8_t *entry = codeCache + codeUsed;
+    out = entry;
+    exitPatchCount = 0;
+
+    /* push rbx, rbp, r12-r15 and keep rsp 16 byte aligned for calls */
+    static const int saved[] = { RBX, RBP, R12, R13, R14, R15 };
+    for (int i = 0; i < 6; i++) {
+        emit_rex(0, 0, 0, saved[i], 0);
+        emit8(0x50 + (saved[i] & 7));
+    }
+    emit8(0x48); emit8(0x83); emit_modrm(3, ALU_SUB, RSP); emit8(8);
+    emit_reload();
+    emit_mov_imm64(RAX, (uint64_t)(uintptr_t)&emuRAM);
+    emit8(0x4C); emit8(0x8B); emit_modrm(0, HOST_MEM, RAX); /* mov r14, [rax] */
+    emit_alu(OP_XOR, HOST_CYCLES, HOST_CYCLES);
+
+    int cyclesSoFar = 0;
+    for (int i = 0; i < count - 1; i++) {
+        cyclesSoFar += emit_op(ops[i], cyclesSoFar);
+    }
+    const micro_op *last = ops[count - 1];
+    int lastCycles = emit_op(last, cyclesSoFar);
+    if (lastCycles) {
+        emit_set_pc(last->nextPc);
+        emit_add_cycles(cyclesSoFar + lastCycles);
+    } else if (!emit_branch(last, cyclesSoFar)) {
+        emit_handler_call(last, cyclesSoFar, 1);
+    }
+
+    /* Shared exit: write the guest back, return the cycles */
+    for (int i = 0; i < exitPatchCount; i++) {
+        emit_patch(exitPatches[i], out);
+    }
+    emit_spill();
+    emit_mov(RAX, HOST_CYCLES);
+    emit8(0x48); emit8(0x83); emit_modrm(3, ALU_ADD, RSP); emit8(8);
+    for (int i = 5; i >= 0; i--) {
+        emit_rex(0, 0, 0, saved[i], 0);
+        emit8(0x58 + (saved[i] & 7));
+    }
+    emit8(0xC3);
+
+    codeUsed += (size_t)(out - entry);
+    block->native = (int (*)(void))(void *)entry;
+    block->jitLeadCycles = (uint16_t)leadCycles;
+    jitBlocks++;
+    return 1;
+}
+
+#else
+
+int jit_compile(decoded_block *block) {
+    block->jitTried = 1;
+    jitRejected++;
+    return 0;
+}
+
+void jit_reset(void) {
+}
+
+#endif /* JIT_SUPPORTED */
+
+/*
+ * Differential mode: run the translation, then roll back and run the
+ * same ops through execute_instruction(). Any difference in state or
+ * cycles is reported and the block goes back to the cached interpreter.
+ * The interpreter's run is the one that sticks.
+ */
+int jit_run_verified(decoded_block *block) {
+    static gb_savestate before, nativeState, interpState;
+    /* Stores below 0x8000 land in emuRAM too and save states skip them */
+    static uint8_t lowBefore[SAVESTATE_RAM_START], lowNative[SAVESTATE_RAM_START];
+    memcpy(lowBefore, emuRAM, SAVESTATE_RAM_START);
+    savestate_capture(&before);
+    int nativeCycles = block->native();
+    savestate_capture(&nativeState);
+    memcpy(lowNative, emuRAM, SAVESTATE_RAM_START);
+    int nativeInvalidated = codeWritten;
+    uint16_t nativePc = pc;
+
+    memcpy(emuRAM, lowBefore, SAVESTATE_RAM_START);
+    savestate_restore(&before);
+    codeWritten = 0;
+    int cycles = 0;
+    for (int i = 0; i < block->count; i++) {
+        if (block->ops[i].fusedOps) {
+            continue;
+        }
+        cycles += execute_instruction();
+        /*
+         * The native run already bumped the generation of a page it
+         * rewrote, so the second store does not get flagged, stop where it stopped
+         */
+        if (codeWritten || (nativeInvalidated && pc == nativePc)) {
+            break;
+        }
+    }
+    savestate_capture(&interpState);
+    jitVerified++;
+
+    if (cycles != nativeCycles || memcmp(&nativeState, &interpState, nativeState.size) || memcmp(lowNative, emuRAM, SAVESTATE_RAM_START)) {
+        jitMismatches++;
+        printf("jit: block at %04x differs from the interpreter\n", block->startPc);
+        printf("  native: af=%04x bc=%04x de=%04x hl=%04x sp=%04x pc=%04x cycles=%d\n", nativeState.cpu.af, nativeState.cpu.bc, nativeState.cpu.de, nativeState.cpu.hl, nativeState.cpu.sp, nativeState.cpu.pc, nativeCycles);
+        printf("  interp: af=%04x bc=%04x de=%04x hl=%04x sp=%04x pc=%04x cycles=%d\n", interpState.cpu.af, interpState.cpu.bc, interpState.cpu.de, interpState.cpu.hl, interpState.cpu.sp, interpState.cpu.pc, cycles);
+        for (int i = 0; i < block->count; i++) {
+            const micro_op *op = &block->ops[i];
+            if (!op->fusedOps) {
+                uint8_t bytes[3] = { op->opcode, op->imm & 0xFF, op->imm >> 8 };
+                char text[32];
+                disassemble(op->nextPc - op->length, bytes, text, sizeof(text));
+                printf("  %04x: %s\n", op->nextPc - op->length, text);
+            }
+        }
+        block->native = NULL;
+    }
+    return cycles;
+}
+
+void jit_report(void) {
+    printf("jit: %lu blocks translated, %lu left to the interpreter", jitBlocks, jitRejected);
+#if JIT_SUPPORTED
+    printf(", %zu bytes of code", codeUsed);
+#endif
+    if (jitVerified) {
+        printf(", %lu runs verified, %lu mismatches", jitVerified, jitMismatches);
+    }
+    printf("\n");
+}
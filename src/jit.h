@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "blockcache.h"
+
+/* Runs of a block before it is worth translating */
+#define JIT_HOT_THRESHOLD 8
+
+/* Executable memory for translated blocks, flushed with the block cache */
+#define JIT_CACHE_SIZE (8 * 1024 * 1024)
+/* Room one block may need, 64 ops at their largest plus entry and exit */
+#define JIT_MAX_BLOCK_CODE (BLOCK_MAX_OPS * 192 + 256)
+
+int jit_compile(decoded_block *block);
+int jit_run_verified(decoded_block *block);
+void jit_reset(void);
+void jit_report(void);
+
+#endif /* JIT_H */
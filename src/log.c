@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "log.h"
+
+/*
+ * Every thread that logs gets a ring of its own with one writer and one
+ * reader, the log thread, so logging never takes a lock. A full ring
+ * drops the message and counts it rather than make the emulator wait.
+ */
+#define LOG_RING_SIZE 16384 /* records, a power of two */
+#define LOG_OUTPUT_SIZE (64 * 1024)
+/* How long the log thread sleeps when every ring is empty */
+#define LOG_IDLE_NS 1000000
+
+typedef struct {
+    const char *format;
+    int argCount;
+    uint64_t args[LOG_MAX_ARGS];
+} log_record;
+
+typedef struct log_ring {
+    log_record records[LOG_RING_SIZE];
+    _Atomic size_t head; /* next record the thread writes */
+    _Atomic size_t tail; /* next record the log thread prints */
+    _Atomic unsigned long dropped;
+    unsigned long droppedReported;
+    struct log_ring *next;
+} log_ring;
+
+static _Thread_local log_ring *threadRing;
+/* Pushed onto as threads first log, rings stay for as long as the process */
+static _Atomic(log_ring *) rings;
+
+static pthread_t logThread;
+static atomic_int logRunning;
+static atomic_int logStopping;
+
+/* The log thread and anything printing directly share the buffer */
+static pthread_mutex_t outputLock = PTHREAD_MUTEX_INITIALIZER;
+static char output[LOG_OUTPUT_SIZE];
+static size_t outputUsed;
+
+static void output_flush(void) {
+    fwrite(output, 1, outputUsed, stdout);
+    outputUsed = 0;
+}
+
+static void output_append(const char *text, size_t length) {
+    if (outputUsed + length > sizeof(output)) {
+        output_flush();
+    }
+    if (length > sizeof(output)) {
+        fwrite(text, 1, length, stdout);
+        return;
+    }
+    memcpy(output + outputUsed, text, length);
+    outputUsed += length;
+}
+
+/*
+ * The printf the caller skipped. Each conversion is handed to snprintf on
+ * its own with the arg narrowed back to what its length modifier says.
+ */
+static void format_record(const log_record *record) {
+    const char *p = record->format;
+    int arg = 0;
+    char text[256];
+    while (*p) {
+        const char *percent = strchr(p, '%');
+        if (!percent) {
+            output_append(p, strlen(p));
+            break;
+        }
+        output_append(p, percent - p);
+        if (percent[1] == '%') {
+            output_append("%", 1);
+            p = percent + 2;
+            continue;
+        }
+        /* Flags, width and precision, then length modifiers, then the conversion */
+        const char *end = percent + 1;
+        while (*end && strchr("-+ #0123456789.", *end)) {
+            end++;
+        }
+        int longs = 0;
+        int size = 0;
+        while (*end && strchr("hlzjt", *end)) {
+            if (*end == 'l') {
+                longs++;
+            } else if (*end != 'h') {
+                size = 1;
+            }
+            end++;
+        }
+        if (!*end) {
+            break;
+        }
+        char spec[32];
+        size_t specLength = (size_t)(end - percent) + 1;
+        if (specLength >= sizeof(spec) || arg >= record->argCount) {
+            output_append(percent, specLength);
+            p = end + 1;
+            continue;
+        }
+        memcpy(spec, percent, specLength);
+        spec[specLength] = '\0';
+        uint64_t value = record->args[arg++];
+        int length;
+        switch (*end) {
+            case 'd': case 'i':
+                if (longs >= 2 || size) {
+                    length = snprintf(text, sizeof(text), spec, (long long)value);
+                } else if (longs) {
+                    length = snprintf(text, sizeof(text), spec, (long)value);
+                } else {
+                    length = snprintf(text, sizeof(text), spec, (int)value);
+                }
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                if (longs >= 2 || size) {
+                    length = snprintf(text, sizeof(text), spec, (unsigned long long)value);
+                } else if (longs) {
+                    length = snprintf(text, sizeof(text), spec, (unsigned long)value);
+                } else {
+                    length = snprintf(text, sizeof(text), spec, (unsigned int)value);
+                }
+                break;
+            case 'c':
+                length = snprintf(text, sizeof(text), spec, (int)value);
+                break;
+            case 's':
+                length = snprintf(text, sizeof(text), spec, value ? (const char *)(uintptr_t)value : "(null)");
+                break;
+            case 'p':
+                length = snprintf(text, sizeof(text), spec, (void *)(uintptr_t)value);
+                break;
+            default: /* No floating point, print the conversion as it is */
+                length = snprintf(text, sizeof(text), "%s", spec);
+                break;
+        }
+        if (length > 0) {
+            output_append(text, (size_t)length < sizeof(text) ? (size_t)length : sizeof(text) - 1);
+        }
+        p = end + 1;
+    }
+}
+
+/* Prints everything queued so far, returns how many records that was */
+static size_t log_drain(void) {
+    size_t printed = 0;
+    pthread_mutex_lock(&outputLock);
+    for (log_ring *ring = atomic_load_explicit(&rings, memory_order_acquire); ring; ring = ring->next) {
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        for (; tail != head; tail++) {
+            format_record(&ring->records[tail & (LOG_RING_SIZE - 1)]);
+            printed++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        unsigned long dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        if (dropped != ring->droppedReported) {
+            char text[64];
+            int length = snprintf(text, sizeof(text), "log: %lu messages dropped\n", dropped - ring->droppedReported);
+            output_append(text, (size_t)length);
+            ring->droppedReported = dropped;
+        }
+    }
+    if (outputUsed) {
+        output_flush();
+        fflush(stdout);
+    }
+    pthread_mutex_unlock(&outputLock);
+    return printed;
+}
+
+static void *log_thread(void *unused) {
+    while (1) {
+        int stopping = atomic_load(&logStopping);
+        /* One more pass once stopping, for whatever came in meanwhile */
+        if (!log_drain()) {
+            if (stopping) {
+                break;
+            }
+            struct timespec idle = { 0, LOG_IDLE_NS };
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+static log_ring *log_ring_create(void) {
+    log_ring *ring = calloc(1, sizeof(log_ring));
+    if (!ring) {
+        return NULL;
+    }
+    ring->next = atomic_load(&rings);
+    while (!atomic_compare_exchange_weak(&rings, &ring->next, ring)) {
+    }
+    threadRing = ring;
+    return ring;
+}
+
+void log_write(int level, int argCount, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    log_record record;
+    record.format = format;
+    record.argCount = argCount < LOG_MAX_ARGS ? argCount : LOG_MAX_ARGS;
+    for (int i = 0; i < record.argCount; i++) {
+        record.args[i] = va_arg(args, uint64_t);
+    }
+    va_end(args);
+
+    log_ring *ring = threadRing;
+    if (!atomic_load_explicit(&logRunning, memory_order_relaxed) || (!ring && !(ring = log_ring_create()))) {
+        /* Nothing to hand it to, print it here */
+        pthread_mutex_lock(&outputLock);
+        format_record(&record);
+        output_flush();
+        pthread_mutex_unlock(&outputLock);
+        return;
+    }
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == LOG_RING_SIZE) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    ring->records[head & (LOG_RING_SIZE - 1)] = record;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+int log_start(void) {
+    if (atomic_load(&logRunning)) {
+        return 0;
+    }
+    atomic_store(&logStopping, 0);
+    if (pthread_create(&logThread, NULL, log_thread, NULL) != 0) {
+        printf("log: unable to start the log thread, logging as it happens\n");
+        return -1;
+    }
+    atomic_store(&logRunning, 1);
+    return 0;
+}
+
+void log_stop(void) {
+    if (!atomic_load(&logRunning)) {
+        return;
+    }
+    /* Anything logged from here on is printed directly */
+    atomic_store(&logRunning, 0);
+    atomic_store(&logStopping, 1);
+    pthread_join(logThread, NULL);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+#define LOG_ERROR 0
+#define LOG_WARN 1
+#define LOG_INFO 2
+#define LOG_DEBUG 3
+
+/* Anything above this is compiled out, DEBUGLOG builds get everything */
+#ifndef LOG_LEVEL
+#if defined(DEBUGLOG) && DEBUGLOG
+#define LOG_LEVEL LOG_DEBUG
+#else
+#define LOG_LEVEL LOG_INFO
+#endif
+#endif /* LOG_LEVEL */
+
+/*
+ * PMLog(level, format, args...) keeps the format and up to seven args as
+ * they are and a background thread does the printf later, so the caller
+ * pays for a few stores. Args are integers or pointers, a %s has to point
+ * at something that lives until the log thread gets to it (a literal or
+ * __FUNCTION__), and there is no floating point. Until log_start() and
+ * after log_stop() messages are printed on the spot.
+ */
+#define LOG_MAX_ARGS 7
+
+#define PMLog(level, ...) \
+    do { \
+        if ((level) <= LOG_LEVEL) { \
+            log_write((level), LOG_COUNT(__VA_ARGS__), LOG_PACK(__VA_ARGS__)); \
+        } \
+    } while (0)
+
+/* How many args follow the format */
+#define LOG_COUNT(...) LOG_COUNT_(__VA_ARGS__, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_COUNT_(format, a1, a2, a3, a4, a5, a6, a7, count, ...) count
+
+/* The format, then every arg widened to what log_write() reads back */
+#define LOG_PACK(...) LOG_JOIN(LOG_PACK_, LOG_COUNT(__VA_ARGS__))(__VA_ARGS__)
+#define LOG_JOIN(a, b) LOG_JOIN_(a, b)
+#define LOG_JOIN_(a, b) a##b
+#define LOG_ARG(a) (uint64_t)(a)
+#define LOG_PACK_0(f) f
+#define LOG_PACK_1(f, a) f, LOG_ARG(a)
+#define LOG_PACK_2(f, a, b) f, LOG_ARG(a), LOG_ARG(b)
+#define LOG_PACK_3(f, a, b, c) f, LOG_ARG(a), LOG_ARG(b), LOG_ARG(c)
+#define LOG_PACK_4(f, a, b, c, d) f, LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d)
+#define LOG_PACK_5(f, a, b, c, d, e) f, LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d), LOG_ARG(e)
+#define LOG_PACK_6(f, a, b, c, d, e, g) f, LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d), LOG_ARG(e), LOG_ARG(g)
+#define LOG_PACK_7(f, a, b, c, d, e, g, h) f, LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d), LOG_ARG(e), LOG_ARG(g), LOG_ARG(h)
+
+/* Every arg after format is a uint64_t, use PMLog() */
+void log_write(int level, int argCount, const char *format, ...);
+
+/* Starts and stops the thread that prints, log_stop() prints what is left */
+int log_start(void);
+void log_stop(void);
+
+#endif /* LOG_H */
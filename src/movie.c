@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "movie.h"
+
+/* FNV-1a, only used to make sure a movie is played on the ROM it was made on */
+uint64_t rom_hash(const uint8_t *rom, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= rom[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+movie *movie_record_open(const char *path, uint64_t romHash) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "unable to open movie %s for writing\n", path);
+        return NULL;
+    }
+    movie *mv = calloc(1, sizeof(movie));
+    if (!mv) {
+        fprintf(stderr, "unable to allocate movie %s\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    mv->fp = fp;
+    mv->recording = 1;
+    mv->header.magic = MOVIE_MAGIC;
+    mv->header.version = MOVIE_VERSION;
+    mv->header.romHash = romHash;
+    /* Placeholder, the real frame count is written on close */
+    fwrite(&mv->header, sizeof(movie_header), 1, fp);
+    return mv;
+}
+
+movie *movie_play_open(const char *path, uint64_t romHash) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "unable to open movie %s\n", path);
+        return NULL;
+    }
+    movie *mv = calloc(1, sizeof(movie));
+    if (!mv) {
+        fprintf(stderr, "unable to allocate movie %s\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    mv->fp = fp;
+    if (fread(&mv->header, sizeof(movie_header), 1, fp) != 1 || mv->header.magic != MOVIE_MAGIC) {
+        fprintf(stderr, "%s is not a movie\n", path);
+        movie_close(mv);
+        return NULL;
+    }
+    if (mv->header.version != MOVIE_VERSION) {
+        fprintf(stderr, "movie version %u is not supported (expected %u)\n", mv->header.version, MOVIE_VERSION);
+        movie_close(mv);
+        return NULL;
+    }
+    if (mv->header.romHash != romHash) {
+        fprintf(stderr, "movie was recorded on a different ROM (%016llx, this one is %016llx)\n", (unsigned long long)mv->header.romHash, (unsigned long long)romHash);
+        movie_close(mv);
+        return NULL;
+    }
+    return mv;
+}
+
+static void write_run(movie *mv) {
+    uint8_t run[6];
+    int len = 0;
+    uint32_t length = mv->runLength;
+    run[len++] = mv->runButtons;
+    do {
+        uint8_t byte = length & 0x7F;
+        length >>= 7;
+        run[len++] = byte | (length ? 0x80 : 0);
+    } while (length);
+    fwrite(run, 1, len, mv->fp);
+}
+
+void movie_record_frame(movie *mv, uint8_t buttons) {
+    if (mv->runLength && buttons != mv->runButtons) {
+        write_run(mv);
+        mv->runLength = 0;
+    }
+    mv->runButtons = buttons;
+    mv->runLength++;
+    mv->header.frameCount++;
+}
+
+/* Returns 0 once the movie is over */
+int movie_play_frame(movie *mv, uint8_t *buttons) {
+    if (mv->framesPlayed >= mv->header.frameCount) {
+        return 0;
+    }
+    if (!mv->runLength) {
+        int c = getc(mv->fp);
+        if (c == EOF) {
+            return 0;
+        }
+        mv->runButtons = (uint8_t)c;
+        uint32_t length = 0;
+        int shift = 0;
+        do {
+            /* Five bytes hold 35 bits, a sixth means the file is damaged */
+            if (shift >= 35) {
+                fprintf(stderr, "corrupt movie, a run length does not fit in 32 bits\n");
+                return 0;
+            }
+            c = getc(mv->fp);
+            if (c == EOF) {
+                return 0;
+            }
+            length |= (uint32_t)(c & 0x7F) << shift;
+            shift += 7;
+        } while (c & 0x80);
+        mv->runLength = length;
+        if (!length) {
+            return 0;
+        }
+    }
+    mv->runLength--;
+    mv->framesPlayed++;
+    *buttons = mv->runButtons;
+    return 1;
+}
+
+void movie_close(movie *mv) {
+    if (!mv) {
+        return;
+    }
+    if (mv->recording) {
+        if (mv->runLength) {
+            write_run(mv);
+        }
+        fseek(mv->fp, 0, SEEK_SET);
+        fwrite(&mv->header, sizeof(movie_header), 1, mv->fp);
+    }
+    fclose(mv->fp);
+    free(mv);
+}
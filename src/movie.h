@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define MOVIE_MAGIC 0x564D4248 /* "HBMV" */
+#define MOVIE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t romHash;
+    uint32_t frameCount;
+    uint32_t reserved;
+} movie_header;
+
+/*
+ * Per-frame joypad log. After the header the file is a list of runs,
+ * each a button byte followed by the run length as a LEB128 varint,
+ * so holding a button (or nothing) for minutes is a couple of bytes.
+ */
+typedef struct {
+    FILE *fp;
+    int recording;
+    movie_header header;
+    uint8_t runButtons;
+    uint32_t runLength; /* frames in the current run, or left in it on playback */
+    uint32_t framesPlayed;
+} movie;
+
+uint64_t rom_hash(const uint8_t *rom, size_t size);
+movie *movie_record_open(const char *path, uint64_t romHash);
+movie *movie_play_open(const char *path, uint64_t romHash);
+void movie_record_frame(movie *mv, uint8_t buttons);
+int movie_play_frame(movie *mv, uint8_t *buttons);
+void movie_close(movie *mv);
+
+#endif /* MOVIE_H */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "opcodes.h"
+
+#define OP_INFO(hex, mnemonic, length, cycles, branchCycles, flags) \
+    [0x##hex] = { mnemonic, length, cycles, branchCycles, flags },
+
+const opcode_info opInfo[256] = {
+    SM83_OPCODES(OP_INFO)
+};
+
+const opcode_info cbOpInfo[256] = {
+    SM83_CB_OPCODES(OP_INFO)
+};
+
+/*
+ * Writes the instruction at addr in rgbds syntax, bytes being the opcode
+ * and whatever follows it. Returns the instruction's length.
+ */
+int disassemble(uint16_t addr, const uint8_t *bytes, char *out, size_t size) {
+    const opcode_info *info = &opInfo[bytes[0]];
+    if (bytes[0] == 0xCB) {
+        snprintf(out, size, "%s", cbOpInfo[bytes[1]].mnemonic);
+        return 2;
+    }
+    if (!info->mnemonic) {
+        snprintf(out, size, "db $%02X", bytes[0]);
+        return 1;
+    }
+
+    uint8_t n8 = bytes[1];
+    uint16_t n16 = bytes[1] | (bytes[2] << 8);
+    size_t used = 0;
+    out[0] = '\0';
+    for (const char *m = info->mnemonic; *m && used + 1 < size;) {
+        char operand[16] = "";
+        int skip = 0;
+        if (!strncmp(m, "n16", 3) || !strncmp(m, "a16", 3)) {
+            snprintf(operand, sizeof(operand), "$%04X", n16);
+            skip = 3;
+        } else if (!strncmp(m, "n8", 2)) {
+            snprintf(operand, sizeof(operand), "$%02X", n8);
+            skip = 2;
+        } else if (!strncmp(m, "a8", 2)) {
+            snprintf(operand, sizeof(operand), "$FF%02X", n8);
+            skip = 2;
+        } else if (!strncmp(m, "e8", 2)) {
+            if (bytes[0] == 0xE8 || bytes[0] == 0xF8) {
+                /* SP plus an offset */
+                snprintf(operand, sizeof(operand), "%d", (int8_t)n8);
+            } else {
+                /* JR, print where it lands */
+                snprintf(operand, sizeof(operand), "$%04X", (uint16_t)(addr + 2 + (int8_t)n8));
+            }
+            skip = 2;
+        }
+        if (skip) {
+            size_t length = strlen(operand);
+            if (used + length >= size) {
+                break;
+            }
+            memcpy(out + used, operand, length + 1);
+            used += length;
+            m += skip;
+        } else {
+            out[used++] = *m++;
+            out[used] = '\0';
+        }
+    }
+    return info->length;
+}
@@ -0,0 +1,557 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef OPCODES_H
+#define OPCODES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Every SM83 opcode, the one place lengths, cycles and flags are written
+ * down. The dispatcher, the disassembler, the JIT's cycle counts and
+ * anything else that needs to know about an opcode is generated from
+ * these lists, pass a macro as X:
+ *
+ *   X(hex, mnemonic, length, cycles, branchCycles, flags)
+ *
+ * hex is the opcode without 0x so it pastes into 0x##hex and op_##hex.
+ * cycles are T-cycles; for conditional ops that is when the condition
+ * fails and branchCycles is when it holds, 0 for everything else.
+ * flags are Z, N, H and C in that order: '-' untouched, '0' or '1' set
+ * to that, the flag's letter when it depends on the result.
+ * Operands are written as in the mnemonics at gbdev.io: n8, n16, a8,
+ * a16 and e8 stand for the immediate.
+ *
+ * D3, DB, DD, E3, E4, EB, EC, ED, F4, FC and FD lock the CPU up and are
+ * left out.
+ */
+#define SM83_OPCODES(X) \
+    X(00, "NOP",             1,  4,  0, "----") \
+    X(01, "LD BC, n16",      3, 12,  0, "----") \
+    X(02, "LD [BC], A",      1,  8,  0, "----") \
+    X(03, "INC BC",          1,  8,  0, "----") \
+    X(04, "INC B",           1,  4,  0, "Z0H-") \
+    X(05, "DEC B",           1,  4,  0, "Z1H-") \
+    X(06, "LD B, n8",        2,  8,  0, "----") \
+    X(07, "RLCA",            1,  4,  0, "000C") \
+    X(08, "LD [a16], SP",    3, 20,  0, "----") \
+    X(09, "ADD HL, BC",      1,  8,  0, "-0HC") \
+    X(0a, "LD A, [BC]",      1,  8,  0, "----") \
+    X(0b, "DEC BC",          1,  8,  0, "----") \
+    X(0c, "INC C",           1,  4,  0, "Z0H-") \
+    X(0d, "DEC C",           1,  4,  0, "Z1H-") \
+    X(0e, "LD C, n8",        2,  8,  0, "----") \
+    X(0f, "RRCA",            1,  4,  0, "000C") \
+    X(10, "STOP n8",         2,  4,  0, "----") \
+    X(11, "LD DE, n16",      3, 12,  0, "----") \
+    X(12, "LD [DE], A",      1,  8,  0, "----") \
+    X(13, "INC DE",          1,  8,  0, "----") \
+    X(14, "INC D",           1,  4,  0, "Z0H-") \
+    X(15, "DEC D",           1,  4,  0, "Z1H-") \
+    X(16, "LD D, n8",        2,  8,  0, "----") \
+    X(17, "RLA",             1,  4,  0, "000C") \
+    X(18, "JR e8",           2, 12,  0, "----") \
+    X(19, "ADD HL, DE",      1,  8,  0, "-0HC") \
+    X(1a, "LD A, [DE]",      1,  8,  0, "----") \
+    X(1b, "DEC DE",          1,  8,  0, "----") \
+    X(1c, "INC E",           1,  4,  0, "Z0H-") \
+    X(1d, "DEC E",           1,  4,  0, "Z1H-") \
+    X(1e, "LD E, n8",        2,  8,  0, "----") \
+    X(1f, "RRA",             1,  4,  0, "000C") \
+    X(20, "JR NZ, e8",       2,  8, 12, "----") \
+    X(21, "LD HL, n16",      3, 12,  0, "----") \
+    X(22, "LD [HL+], A",     1,  8,  0, "----") \
+    X(23, "INC HL",          1,  8,  0, "----") \
+    X(24, "INC H",           1,  4,  0, "Z0H-") \
+    X(25, "DEC H",           1,  4,  0, "Z1H-") \
+    X(26, "LD H, n8",        2,  8,  0, "----") \
+    X(27, "DAA",             1,  4,  0, "Z-0C") \
+    X(28, "JR Z, e8",        2,  8, 12, "----") \
+    X(29, "ADD HL, HL",      1,  8,  0, "-0HC") \
+    X(2a, "LD A, [HL+]",     1,  8,  0, "----") \
+    X(2b, "DEC HL",          1,  8,  0, "----") \
+    X(2c, "INC L",           1,  4,  0, "Z0H-") \
+    X(2d, "DEC L",           1,  4,  0, "Z1H-") \
+    X(2e, "LD L, n8",        2,  8,  0, "----") \
+    X(2f, "CPL",             1,  4,  0, "-11-") \
+    X(30, "JR NC, e8",       2,  8, 12, "----") \
+    X(31, "LD SP, n16",      3, 12,  0, "----") \
+    X(32, "LD [HL-], A",     1,  8,  0, "----") \
+    X(33, "INC SP",          1,  8,  0, "----") \
+    X(34, "INC [HL]",        1, 12,  0, "Z0H-") \
+    X(35, "DEC [HL]",        1, 12,  0, "Z1H-") \
+    X(36, "LD [HL], n8",     2, 12,  0, "----") \
+    X(37, "SCF",             1,  4,  0, "-001") \
+    X(38, "JR C, e8",        2,  8, 12, "----") \
+    X(39, "ADD HL, SP",      1,  8,  0, "-0HC") \
+    X(3a, "LD A, [HL-]",     1,  8,  0, "----") \
+    X(3b, "DEC SP",          1,  8,  0, "----") \
+    X(3c, "INC A",           1,  4,  0, "Z0H-") \
+    X(3d, "DEC A",           1,  4,  0, "Z1H-") \
+    X(3e, "LD A, n8",        2,  8,  0, "----") \
+    X(3f, "CCF",             1,  4,  0, "-00C") \
+    X(40, "LD B, B",         1,  4,  0, "----") \
+    X(41, "LD B, C",         1,  4,  0, "----") \
+    X(42, "LD B, D",         1,  4,  0, "----") \
+    X(43, "LD B, E",         1,  4,  0, "----") \
+    X(44, "LD B, H",         1,  4,  0, "----") \
+    X(45, "LD B, L",         1,  4,  0, "----") \
+    X(46, "LD B, [HL]",      1,  8,  0, "----") \
+    X(47, "LD B, A",         1,  4,  0, "----") \
+    X(48, "LD C, B",         1,  4,  0, "----") \
+    X(49, "LD C, C",         1,  4,  0, "----") \
+    X(4a, "LD C, D",         1,  4,  0, "----") \
+    X(4b, "LD C, E",         1,  4,  0, "----") \
+    X(4c, "LD C, H",         1,  4,  0, "----") \
+    X(4d, "LD C, L",         1,  4,  0, "----") \
+    X(4e, "LD C, [HL]",      1,  8,  0, "----") \
+    X(4f, "LD C, A",         1,  4,  0, "----") \
+    X(50, "LD D, B",         1,  4,  0, "----") \
+    X(51, "LD D, C",         1,  4,  0, "----") \
+    X(52, "LD D, D",         1,  4,  0, "----") \
+    X(53, "LD D, E",         1,  4,  0, "----") \
+    X(54, "LD D, H",         1,  4,  0, "----") \
+    X(55, "LD D, L",         1,  4,  0, "----") \
+    X(56, "LD D, [HL]",      1,  8,  0, "----") \
+    X(57, "LD D, A",         1,  4,  0, "----") \
+    X(58, "LD E, B",         1,  4,  0, "----") \
+    X(59, "LD E, C",         1,  4,  0, "----") \
+    X(5a, "LD E, D",         1,  4,  0, "----") \
+    X(5b, "LD E, E",         1,  4,  0, "----") \
+    X(5c, "LD E, H",         1,  4,  0, "----") \
+    X(5d, "LD E, L",         1,  4,  0, "----") \
+    X(5e, "LD E, [HL]",      1,  8,  0, "----") \
+    X(5f, "LD E, A",         1,  4,  0, "----") \
+    X(60, "LD H, B",         1,  4,  0, "----") \
+    X(61, "LD H, C",         1,  4,  0, "----") \
+    X(62, "LD H, D",         1,  4,  0, "----") \
+    X(63, "LD H, E",         1,  4,  0, "----") \
+    X(64, "LD H, H",         1,  4,  0, "----") \
+    X(65, "LD H, L",         1,  4,  0, "----") \
+    X(66, "LD H, [HL]",      1,  8,  0, "----") \
+    X(67, "LD H, A",         1,  4,  0, "----") \
+    X(68, "LD L, B",         1,  4,  0, "----") \
+    X(69, "LD L, C",         1,  4,  0, "----") \
+    X(6a, "LD L, D",         1,  4,  0, "----") \
+    X(6b, "LD L, E",         1,  4,  0, "----") \
+    X(6c, "LD L, H",         1,  4,  0, "----") \
+    X(6d, "LD L, L",         1,  4,  0, "----") \
+    X(6e, "LD L, [HL]",      1,  8,  0, "----") \
+    X(6f, "LD L, A",         1,  4,  0, "----") \
+    X(70, "LD [HL], B",      1,  8,  0, "----") \
+    X(71, "LD [HL], C",      1,  8,  0, "----") \
+    X(72, "LD [HL], D",      1,  8,  0, "----") \
+    X(73, "LD [HL], E",      1,  8,  0, "----") \
+    X(74, "LD [HL], H",      1,  8,  0, "----") \
+    X(75, "LD [HL], L",      1,  8,  0, "----") \
+    X(76, "HALT",            1,  4,  0, "----") \
+    X(77, "LD [HL], A",      1,  8,  0, "----") \
+    X(78, "LD A, B",         1,  4,  0, "----") \
+    X(79, "LD A, C",         1,  4,  0, "----") \
+    X(7a, "LD A, D",         1,  4,  0, "----") \
+    X(7b, "LD A, E",         1,  4,  0, "----") \
+    X(7c, "LD A, H",         1,  4,  0, "----") \
+    X(7d, "LD A, L",         1,  4,  0, "----") \
+    X(7e, "LD A, [HL]",      1,  8,  0, "----") \
+    X(7f, "LD A, A",         1,  4,  0, "----") \
+    X(80, "ADD A, B",        1,  4,  0, "Z0HC") \
+    X(81, "ADD A, C",        1,  4,  0, "Z0HC") \
+    X(82, "ADD A, D",        1,  4,  0, "Z0HC") \
+    X(83, "ADD A, E",        1,  4,  0, "Z0HC") \
+    X(84, "ADD A, H",        1,  4,  0, "Z0HC") \
+    X(85, "ADD A, L",        1,  4,  0, "Z0HC") \
+    X(86, "ADD A, [HL]",     1,  8,  0, "Z0HC") \
+    X(87, "ADD A, A",        1,  4,  0, "Z0HC") \
+    X(88, "ADC A, B",        1,  4,  0, "Z0HC") \
+    X(89, "ADC A, C",        1,  4,  0, "Z0HC") \
+    X(8a, "ADC A, D",        1,  4,  0, "Z0HC") \
+    X(8b, "ADC A, E",        1,  4,  0, "Z0HC") \
+    X(8c, "ADC A, H",        1,  4,  0, "Z0HC") \
+    X(8d, "ADC A, L",        1,  4,  0, "Z0HC") \
+    X(8e, "ADC A, [HL]",     1,  8,  0, "Z0HC") \
+    X(8f, "ADC A, A",        1,  4,  0, "Z0HC") \
+    X(90, "SUB A, B",        1,  4,  0, "Z1HC") \
+    X(91, "SUB A, C",        1,  4,  0, "Z1HC") \
+    X(92, "SUB A, D",        1,  4,  0, "Z1HC") \
+    X(93, "SUB A, E",        1,  4,  0, "Z1HC") \
+    X(94, "SUB A, H",        1,  4,  0, "Z1HC") \
+    X(95, "SUB A, L",        1,  4,  0, "Z1HC") \
+    X(96, "SUB A, [HL]",     1,  8,  0, "Z1HC") \
+    X(97, "SUB A, A",        1,  4,  0, "Z1HC") \
+    X(98, "SBC A, B",        1,  4,  0, "Z1HC") \
+    X(99, "SBC A, C",        1,  4,  0, "Z1HC") \
+    X(9a, "SBC A, D",        1,  4,  0, "Z1HC") \
+    X(9b, "SBC A, E",        1,  4,  0, "Z1HC") \
+    X(9c, "SBC A, H",        1,  4,  0, "Z1HC") \
+    X(9d, "SBC A, L",        1,  4,  0, "Z1HC") \
+    X(9e, "SBC A, [HL]",     1,  8,  0, "Z1HC") \
+    X(9f, "SBC A, A",        1,  4,  0, "Z1HC") \
+    X(a0, "AND A, B",        1,  4,  0, "Z010") \
+    X(a1, "AND A, C",        1,  4,  0, "Z010") \
+    X(a2, "AND A, D",        1,  4,  0, "Z010") \
+    X(a3, "AND A, E",        1,  4,  0, "Z010") \
+    X(a4, "AND A, H",        1,  4,  0, "Z010") \
+    X(a5, "AND A, L",        1,  4,  0, "Z010") \
+    X(a6, "AND A, [HL]",     1,  8,  0, "Z010") \
+    X(a7, "AND A, A",        1,  4,  0, "Z010") \
+    X(a8, "XOR A, B",        1,  4,  0, "Z000") \
+    X(a9, "XOR A, C",        1,  4,  0, "Z000") \
+    X(aa, "XOR A, D",        1,  4,  0, "Z000") \
+    X(ab, "XOR A, E",        1,  4,  0, "Z000") \
+    X(ac, "XOR A, H",        1,  4,  0, "Z000") \
+    X(ad, "XOR A, L",        1,  4,  0, "Z000") \
+    X(ae, "XOR A, [HL]",     1,  8,  0, "Z000") \
+    X(af, "XOR A, A",        1,  4,  0, "Z000") \
+    X(b0, "OR A, B",         1,  4,  0, "Z000") \
+    X(b1, "OR A, C",         1,  4,  0, "Z000") \
+    X(b2, "OR A, D",         1,  4,  0, "Z000") \
+    X(b3, "OR A, E",         1,  4,  0, "Z000") \
+    X(b4, "OR A, H",         1,  4,  0, "Z000") \
+    X(b5, "OR A, L",         1,  4,  0, "Z000") \
+    X(b6, "OR A, [HL]",      1,  8,  0, "Z000") \
+    X(b7, "OR A, A",         1,  4,  0, "Z000") \
+    X(b8, "CP A, B",         1,  4,  0, "Z1HC") \
+    X(b9, "CP A, C",         1,  4,  0, "Z1HC") \
+    X(ba, "CP A, D",         1,  4,  0, "Z1HC") \
+    X(bb, "CP A, E",         1,  4,  0, "Z1HC") \
+    X(bc, "CP A, H",         1,  4,  0, "Z1HC") \
+    X(bd, "CP A, L",         1,  4,  0, "Z1HC") \
+    X(be, "CP A, [HL]",      1,  8,  0, "Z1HC") \
+    X(bf, "CP A, A",         1,  4,  0, "Z1HC") \
+    X(c0, "RET NZ",          1,  8, 20, "----") \
+    X(c1, "POP BC",          1, 12,  0, "----") \
+    X(c2, "JP NZ, a16",      3, 12, 16, "----") \
+    X(c3, "JP a16",          3, 16,  0, "----") \
+    X(c4, "CALL NZ, a16",    3, 12, 24, "----") \
+    X(c5, "PUSH BC",         1, 16,  0, "----") \
+    X(c6, "ADD A, n8",       2,  8,  0, "Z0HC") \
+    X(c7, "RST $00",         1, 16,  0, "----") \
+    X(c8, "RET Z",           1,  8, 20, "----") \
+    X(c9, "RET",             1, 16,  0, "----") \
+    X(ca, "JP Z, a16",       3, 12, 16, "----") \
+    X(cb, "PREFIX",          2,  4,  0, "----") \
+    X(cc, "CALL Z, a16",     3, 12, 24, "----") \
+    X(cd, "CALL a16",        3, 24,  0, "----") \
+    X(ce, "ADC A, n8",       2,  8,  0, "Z0HC") \
+    X(cf, "RST $08",         1, 16,  0, "----") \
+    X(d0, "RET NC",          1,  8, 20, "----") \
+    X(d1, "POP DE",          1, 12,  0, "----") \
+    X(d2, "JP NC, a16",      3, 12, 16, "----") \
+    X(d4, "CALL NC, a16",    3, 12, 24, "----") \
+    X(d5, "PUSH DE",         1, 16,  0, "----") \
+    X(d6, "SUB A, n8",       2,  8,  0, "Z1HC") \
+    X(d7, "RST $10",         1, 16,  0, "----") \
+    X(d8, "RET C",           1,  8, 20, "----") \
+    X(d9, "RETI",            1, 16,  0, "----") \
+    X(da, "JP C, a16",       3, 12, 16, "----") \
+    X(dc, "CALL C, a16",     3, 12, 24, "----") \
+    X(de, "SBC A, n8",       2,  8,  0, "Z1HC") \
+    X(df, "RST $18",         1, 16,  0, "----") \
+    X(e0, "LDH [a8], A",     2, 12,  0, "----") \
+    X(e1, "POP HL",          1, 12,  0, "----") \
+    X(e2, "LDH [C], A",      1,  8,  0, "----") \
+    X(e5, "PUSH HL",         1, 16,  0, "----") \
+    X(e6, "AND A, n8",       2,  8,  0, "Z010") \
+    X(e7, "RST $20",         1, 16,  0, "----") \
+    X(e8, "ADD SP, e8",      2, 16,  0, "00HC") \
+    X(e9, "JP HL",           1,  4,  0, "----") \
+    X(ea, "LD [a16], A",     3, 16,  0, "----") \
+    X(ee, "XOR A, n8",       2,  8,  0, "Z000") \
+    X(ef, "RST $28",         1, 16,  0, "----") \
+    X(f0, "LDH A, [a8]",     2, 12,  0, "----") \
+    X(f1, "POP AF",          1, 12,  0, "ZNHC") \
+    X(f2, "LDH A, [C]",      1,  8,  0, "----") \
+    X(f3, "DI",              1,  4,  0, "----") \
+    X(f5, "PUSH AF",         1, 16,  0, "----") \
+    X(f6, "OR A, n8",        2,  8,  0, "Z000") \
+    X(f7, "RST $30",         1, 16,  0, "----") \
+    X(f8, "LD HL, SP + e8",  2, 12,  0, "00HC") \
+    X(f9, "LD SP, HL",       1,  8,  0, "----") \
+    X(fa, "LD A, [a16]",     3, 16,  0, "----") \
+    X(fb, "EI",              1,  4,  0, "----") \
+    X(fe, "CP A, n8",        2,  8,  0, "Z1HC") \
+    X(ff, "RST $38",         1, 16,  0, "----")
+
+/* After the 0xCB prefix, cycles include fetching the prefix */
+#define SM83_CB_OPCODES(X) \
+    X(00, "RLC B",           2,  8,  0, "Z00C") \
+    X(01, "RLC C",           2,  8,  0, "Z00C") \
+    X(02, "RLC D",           2,  8,  0, "Z00C") \
+    X(03, "RLC E",           2,  8,  0, "Z00C") \
+    X(04, "RLC H",           2,  8,  0, "Z00C") \
+    X(05, "RLC L",           2,  8,  0, "Z00C") \
+    X(06, "RLC [HL]",        2, 16,  0, "Z00C") \
+    X(07, "RLC A",           2,  8,  0, "Z00C") \
+    X(08, "RRC B",           2,  8,  0, "Z00C") \
+    X(09, "RRC C",           2,  8,  0, "Z00C") \
+    X(0a, "RRC D",           2,  8,  0, "Z00C") \
+    X(0b, "RRC E",           2,  8,  0, "Z00C") \
+    X(0c, "RRC H",           2,  8,  0, "Z00C") \
+    X(0d, "RRC L",           2,  8,  0, "Z00C") \
+    X(0e, "RRC [HL]",        2, 16,  0, "Z00C") \
+    X(0f, "RRC A",           2,  8,  0, "Z00C") \
+    X(10, "RL B",            2,  8,  0, "Z00C") \
+    X(11, "RL C",            2,  8,  0, "Z00C") \
+    X(12, "RL D",            2,  8,  0, "Z00C") \
+    X(13, "RL E",            2,  8,  0, "Z00C") \
+    X(14, "RL H",            2,  8,  0, "Z00C") \
+    X(15, "RL L",            2,  8,  0, "Z00C") \
+    X(16, "RL [HL]",         2, 16,  0, "Z00C") \
+    X(17, "RL A",            2,  8,  0, "Z00C") \
+    X(18, "RR B",            2,  8,  0, "Z00C") \
+    X(19, "RR C",            2,  8,  0, "Z00C") \
+    X(1a, "RR D",            2,  8,  0, "Z00C") \
+    X(1b, "RR E",            2,  8,  0, "Z00C") \
+    X(1c, "RR H",            2,  8,  0, "Z00C") \
+    X(1d, "RR L",            2,  8,  0, "Z00C") \
+    X(1e, "RR [HL]",         2, 16,  0, "Z00C") \
+    X(1f, "RR A",            2,  8,  0, "Z00C") \
+    X(20, "SLA B",           2,  8,  0, "Z00C") \
+    X(21, "SLA C",           2,  8,  0, "Z00C") \
+    X(22, "SLA D",           2,  8,  0, "Z00C") \
+    X(23, "SLA E",           2,  8,  0, "Z00C") \
+    X(24, "SLA H",           2,  8,  0, "Z00C") \
+    X(25, "SLA L",           2,  8,  0, "Z00C") \
+    X(26, "SLA [HL]",        2, 16,  0, "Z00C") \
+    X(27, "SLA A",           2,  8,  0, "Z00C") \
+    X(28, "SRA B",           2,  8,  0, "Z00C") \
+    X(29, "SRA C",           2,  8,  0, "Z00C") \
+    X(2a, "SRA D",           2,  8,  0, "Z00C") \
+    X(2b, "SRA E",           2,  8,  0, "Z00C") \
+    X(2c, "SRA H",           2,  8,  0, "Z00C") \
+    X(2d, "SRA L",           2,  8,  0, "Z00C") \
+    X(2e, "SRA [HL]",        2, 16,  0, "Z00C") \
+    X(2f, "SRA A",           2,  8,  0, "Z00C") \
+    X(30, "SWAP B",          2,  8,  0, "Z000") \
+    X(31, "SWAP C",          2,  8,  0, "Z000") \
+    X(32, "SWAP D",          2,  8,  0, "Z000") \
+    X(33, "SWAP E",          2,  8,  0, "Z000") \
+    X(34, "SWAP H",          2,  8,  0, "Z000") \
+    X(35, "SWAP L",          2,  8,  0, "Z000") \
+    X(36, "SWAP [HL]",       2, 16,  0, "Z000") \
+    X(37, "SWAP A",          2,  8,  0, "Z000") \
+    X(38, "SRL B",           2,  8,  0, "Z00C") \
+    X(39, "SRL C",           2,  8,  0, "Z00C") \
+    X(3a, "SRL D",           2,  8,  0, "Z00C") \
+    X(3b, "SRL E",           2,  8,  0, "Z00C") \
+    X(3c, "SRL H",           2,  8,  0, "Z00C") \
+    X(3d, "SRL L",           2,  8,  0, "Z00C") \
+    X(3e, "SRL [HL]",        2, 16,  0, "Z00C") \
+    X(3f, "SRL A",           2,  8,  0, "Z00C") \
+    X(40, "BIT 0, B",        2,  8,  0, "Z01-") \
+    X(41, "BIT 0, C",        2,  8,  0, "Z01-") \
+    X(42, "BIT 0, D",        2,  8,  0, "Z01-") \
+    X(43, "BIT 0, E",        2,  8,  0, "Z01-") \
+    X(44, "BIT 0, H",        2,  8,  0, "Z01-") \
+    X(45, "BIT 0, L",        2,  8,  0, "Z01-") \
+    X(46, "BIT 0, [HL]",     2, 12,  0, "Z01-") \
+    X(47, "BIT 0, A",        2,  8,  0, "Z01-") \
+    X(48, "BIT 1, B",        2,  8,  0, "Z01-") \
+    X(49, "BIT 1, C",        2,  8,  0, "Z01-") \
+    X(4a, "BIT 1, D",        2,  8,  0, "Z01-") \
+    X(4b, "BIT 1, E",        2,  8,  0, "Z01-") \
+    X(4c, "BIT 1, H",        2,  8,  0, "Z01-") \
+    X(4d, "BIT 1, L",        2,  8,  0, "Z01-") \
+    X(4e, "BIT 1, [HL]",     2, 12,  0, "Z01-") \
+    X(4f, "BIT 1, A",        2,  8,  0, "Z01-") \
+    X(50, "BIT 2, B",        2,  8,  0, "Z01-") \
+    X(51, "BIT 2, C",        2,  8,  0, "Z01-") \
+    X(52, "BIT 2, D",        2,  8,  0, "Z01-") \
+    X(53, "BIT 2, E",        2,  8,  0, "Z01-") \
+    X(54, "BIT 2, H",        2,  8,  0, "Z01-") \
+    X(55, "BIT 2, L",        2,  8,  0, "Z01-") \
+    X(56, "BIT 2, [HL]",     2, 12,  0, "Z01-") \
+    X(57, "BIT 2, A",        2,  8,  0, "Z01-") \
+    X(58, "BIT 3, B",        2,  8,  0, "Z01-") \
+    X(59, "BIT 3, C",        2,  8,  0, "Z01-") \
+    X(5a, "BIT 3, D",        2,  8,  0, "Z01-") \
+    X(5b, "BIT 3, E",        2,  8,  0, "Z01-") \
+    X(5c, "BIT 3, H",        2,  8,  0, "Z01-") \
+    X(5d, "BIT 3, L",        2,  8,  0, "Z01-") \
+    X(5e, "BIT 3, [HL]",     2, 12,  0, "Z01-") \
+    X(5f, "BIT 3, A",        2,  8,  0, "Z01-") \
+    X(60, "BIT 4, B",        2,  8,  0, "Z01-") \
+    X(61, "BIT 4, C",        2,  8,  0, "Z01-") \
+    X(62, "BIT 4, D",        2,  8,  0, "Z01-") \
+    X(63, "BIT 4, E",        2,  8,  0, "Z01-") \
+    X(64, "BIT 4, H",        2,  8,  0, "Z01-") \
+    X(65, "BIT 4, L",        2,  8,  0, "Z01-") \
+    X(66, "BIT 4, [HL]",     2, 12,  0, "Z01-") \
+    X(67, "BIT 4, A",        2,  8,  0, "Z01-") \
+    X(68, "BIT 5, B",        2,  8,  0, "Z01-") \
+    X(69, "BIT 5, C",        2,  8,  0, "Z01-") \
+    X(6a, "BIT 5, D",        2,  8,  0, "Z01-") \
+    X(6b, "BIT 5, E",        2,  8,  0, "Z01-") \
+    X(6c, "BIT 5, H",        2,  8,  0, "Z01-") \
+    X(6d, "BIT 5, L",        2,  8,  0, "Z01-") \
+    X(6e, "BIT 5, [HL]",     2, 12,  0, "Z01-") \
+    X(6f, "BIT 5, A",        2,  8,  0, "Z01-") \
+    X(70, "BIT 6, B",        2,  8,  0, "Z01-") \
+    X(71, "BIT 6, C",        2,  8,  0, "Z01-") \
+    X(72, "BIT 6, D",        2,  8,  0, "Z01-") \
+    X(73, "BIT 6, E",        2,  8,  0, "Z01-") \
+    X(74, "BIT 6, H",        2,  8,  0, "Z01-") \
+    X(75, "BIT 6, L",        2,  8,  0, "Z01-") \
+    X(76, "BIT 6, [HL]",     2, 12,  0, "Z01-") \
+    X(77, "BIT 6, A",        2,  8,  0, "Z01-") \
+    X(78, "BIT 7, B",        2,  8,  0, "Z01-") \
+    X(79, "BIT 7, C",        2,  8,  0, "Z01-") \
+    X(7a, "BIT 7, D",        2,  8,  0, "Z01-") \
+    X(7b, "BIT 7, E",        2,  8,  0, "Z01-") \
+    X(7c, "BIT 7, H",        2,  8,  0, "Z01-") \
+    X(7d, "BIT 7, L",        2,  8,  0, "Z01-") \
+    X(7e, "BIT 7, [HL]",     2, 12,  0, "Z01-") \
+    X(7f, "BIT 7, A",        2,  8,  0, "Z01-") \
+    X(80, "RES 0, B",        2,  8,  0, "----") \
+    X(81, "RES 0, C",        2,  8,  0, "----") \
+    X(82, "RES 0, D",        2,  8,  0, "----") \
+    X(83, "RES 0, E",        2,  8,  0, "----") \
+    X(84, "RES 0, H",        2,  8,  0, "----") \
+    X(85, "RES 0, L",        2,  8,  0, "----") \
+    X(86, "RES 0, [HL]",     2, 16,  0, "----") \
+    X(87, "RES 0, A",        2,  8,  0, "----") \
+    X(88, "RES 1, B",        2,  8,  0, "----") \
+    X(89, "RES 1, C",        2,  8,  0, "----") \
+    X(8a, "RES 1, D",        2,  8,  0, "----") \
+    X(8b, "RES 1, E",        2,  8,  0, "----") \
+    X(8c, "RES 1, H",        2,  8,  0, "----") \
+    X(8d, "RES 1, L",        2,  8,  0, "----") \
+    X(8e, "RES 1, [HL]",     2, 16,  0, "----") \
+    X(8f, "RES 1, A",        2,  8,  0, "----") \
+    X(90, "RES 2, B",        2,  8,  0, "----") \
+    X(91, "RES 2, C",        2,  8,  0, "----") \
+    X(92, "RES 2, D",        2,  8,  0, "----") \
+    X(93, "RES 2, E",        2,  8,  0, "----") \
+    X(94, "RES 2, H",        2,  8,  0, "----") \
+    X(95, "RES 2, L",        2,  8,  0, "----") \
+    X(96, "RES 2, [HL]",     2, 16,  0, "----") \
+    X(97, "RES 2, A",        2,  8,  0, "----") \
+    X(98, "RES 3, B",        2,  8,  0, "----") \
+    X(99, "RES 3, C",        2,  8,  0, "----") \
+    X(9a, "RES 3, D",        2,  8,  0, "----") \
+    X(9b, "RES 3, E",        2,  8,  0, "----") \
+    X(9c, "RES 3, H",        2,  8,  0, "----") \
+    X(9d, "RES 3, L",        2,  8,  0, "----") \
+    X(9e, "RES 3, [HL]",     2, 16,  0, "----") \
+    X(9f, "RES 3, A",        2,  8,  0, "----") \
+    X(a0, "RES 4, B",        2,  8,  0, "----") \
+    X(a1, "RES 4, C",        2,  8,  0, "----") \
+    X(a2, "RES 4, D",        2,  8,  0, "----") \
+    X(a3, "RES 4, E",        2,  8,  0, "----") \
+    X(a4, "RES 4, H",        2,  8,  0, "----") \
+    X(a5, "RES 4, L",        2,  8,  0, "----") \
+    X(a6, "RES 4, [HL]",     2, 16,  0, "----") \
+    X(a7, "RES 4, A",        2,  8,  0, "----") \
+    X(a8, "RES 5, B",        2,  8,  0, "----") \
+    X(a9, "RES 5, C",        2,  8,  0, "----") \
+    X(aa, "RES 5, D",        2,  8,  0, "----") \
+    X(ab, "RES 5, E",        2,  8,  0, "----") \
+    X(ac, "RES 5, H",        2,  8,  0, "----") \
+    X(ad, "RES 5, L",        2,  8,  0, "----") \
+    X(ae, "RES 5, [HL]",     2, 16,  0, "----") \
+    X(af, "RES 5, A",        2,  8,  0, "----") \
+    X(b0, "RES 6, B",        2,  8,  0, "----") \
+    X(b1, "RES 6, C",        2,  8,  0, "----") \
+    X(b2, "RES 6, D",        2,  8,  0, "----") \
+    X(b3, "RES 6, E",        2,  8,  0, "----") \
+    X(b4, "RES 6, H",        2,  8,  0, "----") \
+    X(b5, "RES 6, L",        2,  8,  0, "----") \
+    X(b6, "RES 6, [HL]",     2, 16,  0, "----") \
+    X(b7, "RES 6, A",        2,  8,  0, "----") \
+    X(b8, "RES 7, B",        2,  8,  0, "----") \
+    X(b9, "RES 7, C",        2,  8,  0, "----") \
+    X(ba, "RES 7, D",        2,  8,  0, "----") \
+    X(bb, "RES 7, E",        2,  8,  0, "----") \
+    X(bc, "RES 7, H",        2,  8,  0, "----") \
+    X(bd, "RES 7, L",        2,  8,  0, "----") \
+    X(be, "RES 7, [HL]",     2, 16,  0, "----") \
+    X(bf, "RES 7, A",        2,  8,  0, "----") \
+    X(c0, "SET 0, B",        2,  8,  0, "----") \
+    X(c1, "SET 0, C",        2,  8,  0, "----") \
+    X(c2, "SET 0, D",        2,  8,  0, "----") \
+    X(c3, "SET 0, E",        2,  8,  0, "----") \
+    X(c4, "SET 0, H",        2,  8,  0, "----") \
+    X(c5, "SET 0, L",        2,  8,  0, "----") \
+    X(c6, "SET 0, [HL]",     2, 16,  0, "----") \
+    X(c7, "SET 0, A",        2,  8,  0, "----") \
+    X(c8, "SET 1, B",        2,  8,  0, "----") \
+    X(c9, "SET 1, C",        2,  8,  0, "----") \
+    X(ca, "SET 1, D",        2,  8,  0, "----") \
+    X(cb, "SET 1, E",        2,  8,  0, "----") \
+    X(cc, "SET 1, H",        2,  8,  0, "----") \
+    X(cd, "SET 1, L",        2,  8,  0, "----") \
+    X(ce, "SET 1, [HL]",     2, 16,  0, "----") \
+    X(cf, "SET 1, A",        2,  8,  0, "----") \
+    X(d0, "SET 2, B",        2,  8,  0, "----") \
+    X(d1, "SET 2, C",        2,  8,  0, "----") \
+    X(d2, "SET 2, D",        2,  8,  0, "----") \
+    X(d3, "SET 2, E",        2,  8,  0, "----") \
+    X(d4, "SET 2, H",        2,  8,  0, "----") \
+    X(d5, "SET 2, L",        2,  8,  0, "----") \
+    X(d6, "SET 2, [HL]",     2, 16,  0, "----") \
+    X(d7, "SET 2, A",        2,  8,  0, "----") \
+    X(d8, "SET 3, B",        2,  8,  0, "----") \
+    X(d9, "SET 3, C",        2,  8,  0, "----") \
+    X(da, "SET 3, D",        2,  8,  0, "----") \
+    X(db, "SET 3, E",        2,  8,  0, "----") \
+    X(dc, "SET 3, H",        2,  8,  0, "----") \
+    X(dd, "SET 3, L",        2,  8,  0, "----") \
+    X(de, "SET 3, [HL]",     2, 16,  0, "----") \
+    X(df, "SET 3, A",        2,  8,  0, "----") \
+    X(e0, "SET 4, B",        2,  8,  0, "----") \
+    X(e1, "SET 4, C",        2,  8,  0, "----") \
+    X(e2, "SET 4, D",        2,  8,  0, "----") \
+    X(e3, "SET 4, E",        2,  8,  0, "----") \
+    X(e4, "SET 4, H",        2,  8,  0, "----") \
+    X(e5, "SET 4, L",        2,  8,  0, "----") \
+    X(e6, "SET 4, [HL]",     2, 16,  0, "----") \
+    X(e7, "SET 4, A",        2,  8,  0, "----") \
+    X(e8, "SET 5, B",        2,  8,  0, "----") \
+    X(e9, "SET 5, C",        2,  8,  0, "----") \
+    X(ea, "SET 5, D",        2,  8,  0, "----") \
+    X(eb, "SET 5, E",        2,  8,  0, "----") \
+    X(ec, "SET 5, H",        2,  8,  0, "----") \
+    X(ed, "SET 5, L",        2,  8,  0, "----") \
+    X(ee, "SET 5, [HL]",     2, 16,  0, "----") \
+    X(ef, "SET 5, A",        2,  8,  0, "----") \
+    X(f0, "SET 6, B",        2,  8,  0, "----") \
+    X(f1, "SET 6, C",        2,  8,  0, "----") \
+    X(f2, "SET 6, D",        2,  8,  0, "----") \
+    X(f3, "SET 6, E",        2,  8,  0, "----") \
+    X(f4, "SET 6, H",        2,  8,  0, "----") \
+    X(f5, "SET 6, L",        2,  8,  0, "----") \
+    X(f6, "SET 6, [HL]",     2, 16,  0, "----") \
+    X(f7, "SET 6, A",        2,  8,  0, "----") \
+    X(f8, "SET 7, B",        2,  8,  0, "----") \
+    X(f9, "SET 7, C",        2,  8,  0, "----") \
+    X(fa, "SET 7, D",        2,  8,  0, "----") \
+    X(fb, "SET 7, E",        2,  8,  0, "----") \
+    X(fc, "SET 7, H",        2,  8,  0, "----") \
+    X(fd, "SET 7, L",        2,  8,  0, "----") \
+    X(fe, "SET 7, [HL]",     2, 16,  0, "----") \
+    X(ff, "SET 7, A",        2,  8,  0, "----")
+
+typedef struct {
+    const char *mnemonic;
+    uint8_t length;
+    uint8_t cycles;
+    uint8_t branchCycles;
+    const char *flags;
+} opcode_info;
+
+/* mnemonic is NULL for the opcodes left out */
+extern const opcode_info opInfo[256];
+extern const opcode_info cbOpInfo[256];
+
+int disassemble(uint16_t addr, const uint8_t *bytes, char *out, size_t size);
+
+#endif /* OPCODES_H */
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "profile.h"
+#include "opcodes.h"
+#include "seajson.h"
+
+/* Past this many taken slots in a row the address is counted as dropped */
+#define PROFILE_MAX_PROBES 64
+/* Addresses in the JSON report, hottest first, the text report has fewer */
+#define PROFILE_JSON_ADDRESSES 4096
+
+core_profile *coreProfile;
+
+core_profile *profile_create(void) {
+    core_profile *profile = calloc(1, sizeof(core_profile));
+    if (!profile) {
+        printf("profile: unable to allocate the profile\n");
+    }
+    return profile;
+}
+
+void profile_free(core_profile *profile) {
+    free(profile);
+}
+
+/* The slot for bank and pc, claiming a free one if it has none yet */
+static profile_address *find_address(core_profile *profile, uint8_t bank, uint16_t pc) {
+    unsigned slot = (pc + bank * 0x9E3Bu) & (PROFILE_ADDRESS_SLOTS - 1);
+    for (int probe = 0; probe < PROFILE_MAX_PROBES; probe++) {
+        profile_address *address = &profile->addresses[(slot + probe) & (PROFILE_ADDRESS_SLOTS - 1)];
+        if (!address->used) {
+            address->used = 1;
+            address->bank = bank;
+            address->pc = pc;
+            return address;
+        }
+        if (address->pc == pc && address->bank == bank) {
+            return address;
+        }
+    }
+    return NULL;
+}
+
+void profile_count(core_profile *profile, uint8_t bank, uint16_t addr, uint8_t opcode, uint8_t operand, int cycles) {
+    profile_counter *counter = opcode == 0xCB ? &profile->cbOps[operand] : &profile->ops[opcode];
+    unsigned bucket = (unsigned)cycles / 4;
+    if (bucket >= PROFILE_CYCLE_BUCKETS) {
+        bucket = PROFILE_CYCLE_BUCKETS - 1;
+    }
+    counter->count++;
+    counter->cycles += cycles;
+    counter->histogram[bucket]++;
+
+    profile_address *address = find_address(profile, bank, addr);
+    if (!address) {
+        profile->addressesDropped++;
+        return;
+    }
+    address->count++;
+    address->cycles += cycles;
+}
+
+static void merge_counter(profile_counter *into, const profile_counter *from) {
+    into->count += from->count;
+    into->cycles += from->cycles;
+    for (int i = 0; i < PROFILE_CYCLE_BUCKETS; i++) {
+        into->histogram[i] += from->histogram[i];
+    }
+}
+
+void profile_merge(core_profile *into, const core_profile *from) {
+    for (int i = 0; i < 256; i++) {
+        merge_counter(&into->ops[i], &from->ops[i]);
+        merge_counter(&into->cbOps[i], &from->cbOps[i]);
+    }
+    for (int i = 0; i < PROFILE_ADDRESS_SLOTS; i++) {
+        const profile_address *source = &from->addresses[i];
+        if (!source->used) {
+            continue;
+        }
+        profile_address *address = find_address(into, source->bank, source->pc);
+        if (!address) {
+            into->addressesDropped += source->count;
+            continue;
+        }
+        address->count += source->count;
+        address->cycles += source->cycles;
+    }
+    into->addressesDropped += from->addressesDropped;
+}
+
+/* Opcodes are numbered 0 to 511 from here on, CB opcodes are the top half */
+static const profile_counter *opcode_counter(const core_profile *profile, int index) {
+    return index < 256 ? &profile->ops[index] : &profile->cbOps[index - 256];
+}
+
+static const char *opcode_mnemonic(int index) {
+    const char *mnemonic = index < 256 ? opInfo[index].mnemonic : cbOpInfo[index - 256].mnemonic;
+    return mnemonic ? mnemonic : "?";
+}
+
+static void opcode_name(int index, char *out, size_t size) {
+    if (index < 256) {
+        snprintf(out, size, "%02x", index);
+    } else {
+        snprintf(out, size, "cb %02x", index - 256);
+    }
+}
+
+static void profile_totals(const core_profile *profile, uint64_t *count, uint64_t *cycles) {
+    *count = 0;
+    *cycles = 0;
+    for (int i = 0; i < 512; i++) {
+        *count += opcode_counter(profile, i)->count;
+        *cycles += opcode_counter(profile, i)->cycles;
+    }
+}
+
+/* qsort has no context argument, so sorting runs one at a time */
+static const core_profile *sortProfile;
+
+static int compare_opcodes(const void *a, const void *b) {
+    uint64_t cyclesA = opcode_counter(sortProfile, *(const int *)a)->cycles;
+    uint64_t cyclesB = opcode_counter(sortProfile, *(const int *)b)->cycles;
+    if (cyclesA != cyclesB) {
+        return cyclesA < cyclesB ? 1 : -1;
+    }
+    return *(const int *)a - *(const int *)b;
+}
+
+static int compare_addresses(const void *a, const void *b) {
+    const profile_address *addressA = *(const profile_address *const *)a;
+    const profile_address *addressB = *(const profile_address *const *)b;
+    if (addressA->cycles != addressB->cycles) {
+        return addressA->cycles < addressB->cycles ? 1 : -1;
+    }
+    if (addressA->bank != addressB->bank) {
+        return addressA->bank - addressB->bank;
+    }
+    return addressA->pc - addressB->pc;
+}
+
+/* Every opcode index, hottest first */
+static void sort_opcodes(const core_profile *profile, int *order) {
+    for (int i = 0; i < 512; i++) {
+        order[i] = i;
+    }
+    sortProfile = profile;
+    qsort(order, 512, sizeof(int), compare_opcodes);
+}
+
+/* Every address that ran, hottest first, the caller frees it */
+static const profile_address **sort_addresses(const core_profile *profile, int *count) {
+    const profile_address **order = malloc(sizeof(profile_address *) * PROFILE_ADDRESS_SLOTS);
+    *count = 0;
+    if (!order) {
+        return NULL;
+    }
+    for (int i = 0; i < PROFILE_ADDRESS_SLOTS; i++) {
+        if (profile->addresses[i].used) {
+            order[(*count)++] = &profile->addresses[i];
+        }
+    }
+    qsort(order, *count, sizeof(profile_address *), compare_addresses);
+    return order;
+}
+
+void profile_print_top(const core_profile *profile, FILE *out, int rows) {
+    uint64_t totalCount, totalCycles;
+    profile_totals(profile, &totalCount, &totalCycles);
+    fprintf(out, "profile: %" PRIu64 " instructions, %" PRIu64 " cycles\n", totalCount, totalCycles);
+    if (!totalCycles) {
+        return;
+    }
+
+    int order[512];
+    sort_opcodes(profile, order);
+    fprintf(out, "opcodes by cycles:\n");
+    for (int rank = 0; rank < rows && opcode_counter(profile, order[rank])->count; rank++) {
+        const profile_counter *counter = opcode_counter(profile, order[rank]);
+        char name[16];
+        opcode_name(order[rank], name, sizeof(name));
+        fprintf(out, "  %5.1f%% %12" PRIu64 " cycles %11" PRIu64 " runs  %-5s  %-16s", 100.0 * counter->cycles / totalCycles, counter->cycles, counter->count, name, opcode_mnemonic(order[rank]));
+        /* Conditional ops show how often each way went */
+        for (int i = 0; i < PROFILE_CYCLE_BUCKETS; i++) {
+            if (counter->histogram[i]) {
+                fprintf(out, " %d:%" PRIu64, i * 4, counter->histogram[i]);
+            }
+        }
+        fprintf(out, "\n");
+    }
+
+    int addressCount;
+    const profile_address **addresses = sort_addresses(profile, &addressCount);
+    if (!addresses) {
+        return;
+    }
+    fprintf(out, "addresses by cycles:\n");
+    for (int rank = 0; rank < rows && rank < addressCount; rank++) {
+        const profile_address *address = addresses[rank];
+        fprintf(out, "  %5.1f%% %12" PRIu64 " cycles %11" PRIu64 " runs  %02X:%04X\n", 100.0 * address->cycles / totalCycles, address->cycles, address->count, address->bank, address->pc);
+    }
+    if (profile->addressesDropped) {
+        fprintf(out, "  %" PRIu64 " instructions at addresses that did not fit\n", profile->addressesDropped);
+    }
+    free(addresses);
+}
+
+/* Hands back the grown object, the old one is freed */
+static seajson add_value(seajson json, const char *key, const char *value) {
+    seajson grown = add_item_seajson(json, key, value);
+    free_json(json);
+    return grown;
+}
+
+static void append_item(jarray *array, int *owned, const char *item) {
+    jarray grown = add_item_to_jarray(*array, (char *)item);
+    if (*owned) {
+        free_jarray(*array);
+    }
+    *array = grown;
+    *owned = 1;
+}
+
+int profile_write_json(const core_profile *profile, const char *path) {
+    uint64_t totalCount, totalCycles;
+    profile_totals(profile, &totalCount, &totalCycles);
+    char item[512]; /* an opcode with every count at 20 digits fits */
+
+    /* Every opcode that ran, hottest first */
+    int order[512];
+    sort_opcodes(profile, order);
+    jarray opcodes = new_jarray();
+    int opcodesOwned = 0;
+    for (int rank = 0; rank < 512 && opcode_counter(profile, order[rank])->count; rank++) {
+        const profile_counter *counter = opcode_counter(profile, order[rank]);
+        char name[16];
+        opcode_name(order[rank], name, sizeof(name));
+        int used = snprintf(item, sizeof(item), "{\"opcode\":\"%s\",\"mnemonic\":\"%s\",\"count\":%" PRIu64 ",\"cycles\":%" PRIu64 ",\"histogram\":[",
+            name, opcode_mnemonic(order[rank]), counter->count, counter->cycles);
+        for (int i = 0; i < PROFILE_CYCLE_BUCKETS; i++) {
+            used += snprintf(item + used, sizeof(item) - used, "%s%" PRIu64, i ? "," : "", counter->histogram[i]);
+        }
+        snprintf(item + used, sizeof(item) - used, "]}");
+        append_item(&opcodes, &opcodesOwned, item);
+    }
+
+    jarray addresses = new_jarray();
+    int addressesOwned = 0;
+    int addressCount;
+    const profile_address **sorted = sort_addresses(profile, &addressCount);
+    for (int rank = 0; sorted && rank < addressCount && rank < PROFILE_JSON_ADDRESSES; rank++) {
+        snprintf(item, sizeof(item), "{\"bank\":%d,\"pc\":\"%04X\",\"count\":%" PRIu64 ",\"cycles\":%" PRIu64 "}",
+            sorted[rank]->bank, sorted[rank]->pc, sorted[rank]->count, sorted[rank]->cycles);
+        append_item(&addresses, &addressesOwned, item);
+    }
+    free(sorted);
+
+    /* add_item_seajson wants something in the object already */
+    snprintf(item, sizeof(item), "{\"instructions\":%" PRIu64 "}", totalCount);
+    seajson report = strdup(item);
+    snprintf(item, sizeof(item), "%" PRIu64, totalCycles);
+    report = add_value(report, "cycles", item);
+    snprintf(item, sizeof(item), "%" PRIu64, profile->addressesDropped);
+    report = add_value(report, "addressesDropped", item);
+    report = add_value(report, "opcodes", opcodes.arrayString);
+    report = add_value(report, "addresses", addresses.arrayString);
+    if (opcodesOwned) {
+        free_jarray(opcodes);
+    }
+    if (addressesOwned) {
+        free_jarray(addresses);
+    }
+
+    FILE *out = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (!out) {
+        printf("profile: unable to write %s\n", path);
+        free_json(report);
+        return -1;
+    }
+    fprintf(out, "%s\n", report);
+    if (out != stdout) {
+        fclose(out);
+    }
+    free_json(report);
+    return 0;
+}
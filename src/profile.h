@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * What the profiled core (CORE_PROFILED, see core.h) counts: executions
+ * and cycles for every opcode, CB opcodes on their own, and for every
+ * (bank, pc) that ran. Counts live in a core_profile of their own so a
+ * batch of runs can each fill one in and have them merged at the end.
+ */
+#define PROFILE_CYCLE_BUCKETS 7 /* 0 to 24 T-cycles in steps of 4 */
+#define PROFILE_ADDRESS_SLOTS 0x10000 /* a power of two */
+#define PROFILE_TOP 20 /* rows in the text report */
+
+typedef struct {
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t histogram[PROFILE_CYCLE_BUCKETS]; /* runs that took 4 * i T-cycles */
+} profile_counter;
+
+typedef struct {
+    uint64_t count;
+    uint64_t cycles;
+    uint16_t pc;
+    uint8_t bank;
+    uint8_t used;
+} profile_address;
+
+typedef struct {
+    profile_counter ops[256]; /* 0xCB itself is never counted here */
+    profile_counter cbOps[256];
+    profile_address addresses[PROFILE_ADDRESS_SLOTS]; /* open addressing on bank and pc */
+    uint64_t addressesDropped; /* instructions whose address found no free slot */
+} core_profile;
+
+/* The one the profiled core counts into */
+extern core_profile *coreProfile;
+
+core_profile *profile_create(void);
+void profile_free(core_profile *profile);
+/* operand is the byte after the opcode, which CB opcode it was */
+void profile_count(core_profile *profile, uint8_t bank, uint16_t addr, uint8_t opcode, uint8_t operand, int cycles);
+void profile_merge(core_profile *into, const core_profile *from);
+
+/* "-" writes to stdout */
+int profile_write_json(const core_profile *profile, const char *path);
+/* Hottest opcodes and addresses by cycles */
+void profile_print_top(const core_profile *profile, FILE *out, int rows);
+
+#endif /* PROFILE_H */
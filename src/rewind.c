@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rewind.h"
+
+/*
+ * Delta format: a run of tokens, each one is
+ *   uint32_t unchanged; // words to skip
+ *   uint32_t changed;   // words of XOR that follow
+ *   uint64_t xor[changed];
+ * Every token carries at least one word, so this bounds the worst case.
+ */
+#define REWIND_DELTA_BOUND ((REWIND_STATE_WORDS + 1) * 8 + REWIND_STATE_WORDS * 8)
+
+/* Only the words cur has in use, a DMG state has no banks to compare */
+static size_t delta_encode(const uint64_t *cur, const uint64_t *prev, uint8_t *out) {
+    const size_t n = (((const gb_savestate *)cur)->size + 7) / 8;
+    uint8_t *p = out;
+    size_t i = 0;
+    while (i < n) {
+        size_t start = i;
+        /* Skip unchanged words, four at a time while we can */
+        while (i + 4 <= n && ((cur[i] ^ prev[i]) | (cur[i + 1] ^ prev[i + 1]) | (cur[i + 2] ^ prev[i + 2]) | (cur[i + 3] ^ prev[i + 3])) == 0) {
+            i += 4;
+        }
+        while (i < n && cur[i] == prev[i]) {
+            i++;
+        }
+        uint32_t unchanged = (uint32_t)(i - start);
+        size_t changedStart = i;
+        while (i < n && cur[i] != prev[i]) {
+            i++;
+        }
+        uint32_t changed = (uint32_t)(i - changedStart);
+        if (!changed && i == n && p != out) {
+            /* Trailing unchanged words do not need a token */
+            break;
+        }
+        memcpy(p, &unchanged, 4);
+        memcpy(p + 4, &changed, 4);
+        p += 8;
+        for (size_t j = changedStart; j < i; j++) {
+            uint64_t x = cur[j] ^ prev[j];
+            memcpy(p, &x, 8);
+            p += 8;
+        }
+    }
+    return p - out;
+}
+
+static void delta_apply(uint64_t *state, const uint8_t *in, size_t size) {
+    const uint8_t *p = in;
+    const uint8_t *end = in + size;
+    size_t i = 0;
+    while (p < end) {
+        uint32_t unchanged, changed;
+        memcpy(&unchanged, p, 4);
+        memcpy(&changed, p + 4, 4);
+        p += 8;
+        i += unchanged;
+        for (uint32_t j = 0; j < changed; j++) {
+            uint64_t x;
+            memcpy(&x, p, 8);
+            state[i++] ^= x;
+            p += 8;
+        }
+    }
+}
+
+rewind_buffer *rewind_create(size_t bytes) {
+    if (bytes < REWIND_DELTA_BOUND * 2) {
+        fprintf(stderr, "rewind buffer of %zu bytes is too small, need at least %zu\n", bytes, (size_t)REWIND_DELTA_BOUND * 2);
+        return NULL;
+    }
+    rewind_buffer *rb = calloc(1, sizeof(rewind_buffer));
+    if (!rb) {
+        return NULL;
+    }
+    rb->data = malloc(bytes);
+    rb->dataSize = bytes;
+    rb->maxEntries = REWIND_MAX_FRAMES;
+    rb->entries = malloc(sizeof(rewind_entry) * rb->maxEntries);
+    /* calloc so the padding words past the struct stay zero */
+    rb->current = calloc(REWIND_STATE_WORDS, 8);
+    rb->scratch = calloc(REWIND_STATE_WORDS, 8);
+    if (!rb->data || !rb->entries || !rb->current || !rb->scratch) {
+        rewind_free(rb);
+        return NULL;
+    }
+    return rb;
+}
+
+void rewind_free(rewind_buffer *rb) {
+    if (!rb) {
+        return;
+    }
+    free(rb->data);
+    free(rb->entries);
+    free(rb->current);
+    free(rb->scratch);
+    free(rb);
+}
+
+static void drop_oldest(rewind_buffer *rb) {
+    rb->first = (rb->first + 1) % rb->maxEntries;
+    rb->count--;
+}
+
+/* Captures the running machine as the newest state */
+void rewind_push(rewind_buffer *rb) {
+    savestate_capture((gb_savestate *)rb->scratch);
+
+    if (rb->count == rb->maxEntries) {
+        drop_oldest(rb);
+    }
+    if (rb->count == 0) {
+        rb->head = 0;
+    } else if (rb->head + REWIND_DELTA_BOUND > rb->dataSize) {
+        /* Wrap. Everything past the old head is older than what sits at 0 */
+        while (rb->count && rb->entries[rb->first].offset >= rb->head) {
+            drop_oldest(rb);
+        }
+        rb->head = 0;
+    }
+    /* Free up room for the worst case */
+    while (rb->count) {
+        rewind_entry *oldest = &rb->entries[rb->first];
+        if (oldest->offset >= rb->head + REWIND_DELTA_BOUND || oldest->offset + oldest->size <= rb->head) {
+            break;
+        }
+        drop_oldest(rb);
+    }
+
+    rewind_entry *entry = &rb->entries[(rb->first + rb->count) % rb->maxEntries];
+    entry->offset = (uint32_t)rb->head;
+    entry->size = (uint32_t)delta_encode(rb->scratch, rb->current, rb->data + rb->head);
+    rb->head += entry->size;
+    rb->count++;
+
+    uint64_t *tmp = rb->current;
+    rb->current = rb->scratch;
+    rb->scratch = tmp;
+}
+
+/* Steps the machine back one state, returns -1 once history runs out */
+int rewind_pop(rewind_buffer *rb) {
+    /* The oldest entry is only a delta against a state we no longer have */
+    if (rb->count < 2) {
+        return -1;
+    }
+    int newest = (rb->first + rb->count - 1) % rb->maxEntries;
+    rewind_entry *entry = &rb->entries[newest];
+    delta_apply(rb->current, rb->data + entry->offset, entry->size);
+    rb->head = entry->offset;
+    rb->count--;
+    return savestate_restore((const gb_savestate *)rb->current);
+}
+
+int rewind_frames(const rewind_buffer *rb) {
+    return rb->count;
+}
+
+size_t rewind_bytes_used(const rewind_buffer *rb) {
+    if (!rb->count) {
+        return 0;
+    }
+    size_t start = rb->entries[rb->first].offset;
+    if (start < rb->head) {
+        return rb->head - start;
+    }
+    return rb->head + (rb->dataSize - start);
+}
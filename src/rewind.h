@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "savestate.h"
+
+/* 10 minutes at 60 fps, the byte budget usually runs out first */
+#define REWIND_MAX_FRAMES (60 * 60 * 10)
+
+#define REWIND_STATE_WORDS ((sizeof(gb_savestate) + 7) / 8)
+
+typedef struct {
+    uint32_t offset;
+    uint32_t size;
+} rewind_entry;
+
+/*
+ * Ring of save states. Each entry is the XOR of a state against the one
+ * before it, run-length encoded on 64-bit words. Only the newest state is
+ * kept whole, rewinding walks backwards by XORing the entries into it.
+ */
+typedef struct {
+    uint8_t *data;
+    size_t dataSize;
+    size_t head; /* where the next entry is written */
+
+    rewind_entry *entries;
+    int maxEntries;
+    int first; /* oldest entry */
+    int count;
+
+    uint64_t *current; /* newest state, whole */
+    uint64_t *scratch;
+} rewind_buffer;
+
+rewind_buffer *rewind_create(size_t bytes);
+void rewind_free(rewind_buffer *rb);
+void rewind_push(rewind_buffer *rb);
+int rewind_pop(rewind_buffer *rb);
+int rewind_frames(const rewind_buffer *rb);
+size_t rewind_bytes_used(const rewind_buffer *rb);
+
+#endif /* REWIND_H */
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "savestate.h"
+#include "emu.h"
+#include "interrupts.h"
+#include "timer.h"
+#include "dma.h"
+#include "cgb.h"
+#include "serial.h"
+
+void savestate_capture(gb_savestate *state) {
+    state->magic = SAVESTATE_MAGIC;
+    state->version = SAVESTATE_VERSION;
+    state->size = SAVESTATE_BASE_SIZE + (cgbMode ? SAVESTATE_BANKS_SIZE : 0);
+    state->reserved = 0;
+
+    state->cpu.af = af;
+    state->cpu.bc = bc;
+    state->cpu.de = de;
+    state->cpu.hl = hl;
+    state->cpu.sp = sp;
+    state->cpu.pc = pc;
+    state->cpu.ime = interrupts_enabled;
+    state->cpu.ime_delay = imeDelay;
+    state->cpu.halted = halted;
+    memset(state->cpu.pad, 0, sizeof(state->cpu.pad));
+
+    state->ppu.ly_counter = ly_counter;
+    state->ppu.ly = ly;
+    memset(state->ppu.pad, 0, sizeof(state->ppu.pad));
+
+    timer_flush();
+    state->timer.cycles = cycleCount;
+    state->timer.div_base = divBase;
+    state->dma.ends_at = dmaEndsAt;
+    state->serial.event_at = serialEventAt;
+
+    state->cgb.enabled = cgbMode;
+    state->cgb.double_speed = doubleSpeed;
+    state->cgb.vram_bank = vramBank;
+    state->cgb.wram_bank = wramBank;
+    state->cgb.hdma_active = hdmaActive;
+    state->cgb.speed_switch = speedSwitchPending;
+    memset(state->cgb.pad, 0, sizeof(state->cgb.pad));
+    state->cgb.hdma_stall = hdmaStall;
+    state->cgb.pad2 = 0;
+    state->cgb.event_at = cgbEventAt;
+    memcpy(state->cgb.bg_palettes, bgPaletteRam, sizeof(bgPaletteRam));
+    memcpy(state->cgb.obj_palettes, objPaletteRam, sizeof(objPaletteRam));
+
+    state->callStack = callStack;
+    memcpy(state->ram, emuRAM + SAVESTATE_RAM_START, SAVESTATE_RAM_SIZE);
+
+    if (cgbMode) {
+        /* The banks switched in went with the RAM */
+        uint8_t *bank = state->banks;
+        memcpy(bank, vramBanks[!vramBank], VRAM_BANK_SIZE);
+        bank += VRAM_BANK_SIZE;
+        for (int i = 1; i < 8; i++) {
+            if (i != wramBank) {
+                memcpy(bank, wramBanks[i], WRAM_BANK_SIZE);
+                bank += WRAM_BANK_SIZE;
+            }
+        }
+    }
+}
+
+/* Whether size is right for a state with the banks or without, as it says */
+static int savestate_size_valid(const gb_savestate *state) {
+    return state->size == SAVESTATE_BASE_SIZE + (state->cgb.enabled ? SAVESTATE_BANKS_SIZE : 0);
+}
+
+/* Returns 0 on success, -1 if the state is not one we understand */
+int savestate_restore(const gb_savestate *state) {
+    if (state->magic != SAVESTATE_MAGIC || state->version != SAVESTATE_VERSION || !savestate_size_valid(state)) {
+        return -1;
+    }
+
+    af = state->cpu.af;
+    bc = state->cpu.bc;
+    de = state->cpu.de;
+    hl = state->cpu.hl;
+    sp = state->cpu.sp;
+    pc = state->cpu.pc;
+    interrupts_enabled = state->cpu.ime;
+    imeDelay = state->cpu.ime_delay;
+    halted = state->cpu.halted;
+
+    ly_counter = state->ppu.ly_counter;
+    ly = state->ppu.ly;
+
+    callStack = state->callStack;
+    memcpy(emuRAM + SAVESTATE_RAM_START, state->ram, SAVESTATE_RAM_SIZE);
+    cycleCount = state->timer.cycles;
+    divBase = state->timer.div_base;
+    /* TIMA in the RAM was flushed at cycleCount */
+    timaSyncedAt = cycleCount;
+    dmaEndsAt = state->dma.ends_at;
+    dma_restored();
+    serialEventAt = state->serial.event_at;
+
+    cgbMode = state->cgb.enabled;
+    doubleSpeed = state->cgb.double_speed;
+    vramBank = state->cgb.vram_bank;
+    wramBank = state->cgb.wram_bank;
+    hdmaActive = state->cgb.hdma_active;
+    speedSwitchPending = state->cgb.speed_switch;
+    hdmaStall = state->cgb.hdma_stall;
+    cgbEventAt = state->cgb.event_at;
+    memcpy(bgPaletteRam, state->cgb.bg_palettes, sizeof(bgPaletteRam));
+    memcpy(objPaletteRam, state->cgb.obj_palettes, sizeof(objPaletteRam));
+    if (cgbMode) {
+        const uint8_t *bank = state->banks;
+        memcpy(vramBanks[!vramBank], bank, VRAM_BANK_SIZE);
+        bank += VRAM_BANK_SIZE;
+        for (int i = 1; i < 8; i++) {
+            if (i != wramBank) {
+                memcpy(wramBanks[i], bank, WRAM_BANK_SIZE);
+                bank += WRAM_BANK_SIZE;
+            }
+        }
+    }
+    cgb_restored();
+    timer_reschedule();
+    ly_schedule();
+
+    /* IF and IE came back with the RAM */
+    interrupts_changed();
+    return 0;
+}
+
+int savestate_write_file(const gb_savestate *state, const char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "unable to open save state %s for writing\n", path);
+        return -1;
+    }
+    size_t written = fwrite(state, 1, state->size, fp);
+    fclose(fp);
+    if (written != state->size) {
+        fprintf(stderr, "failed to write save state, wrote %zu, expected %u\n", written, state->size);
+        return -1;
+    }
+    return 0;
+}
+
+int savestate_read_file(gb_savestate *state, const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "unable to open save state %s\n", path);
+        return -1;
+    }
+    size_t bytesRead = fread(state, 1, SAVESTATE_BASE_SIZE, fp);
+    if (bytesRead != SAVESTATE_BASE_SIZE || state->magic != SAVESTATE_MAGIC) {
+        fprintf(stderr, "%s is not a save state\n", path);
+        fclose(fp);
+        return -1;
+    }
+    if (state->version != SAVESTATE_VERSION || !savestate_size_valid(state)) {
+        fprintf(stderr, "save state version %u is not supported (expected %u)\n", state->version, SAVESTATE_VERSION);
+        fclose(fp);
+        return -1;
+    }
+    /* The CGB banks, if there are any */
+    size_t tail = state->size - SAVESTATE_BASE_SIZE;
+    bytesRead = fread(state->banks, 1, tail, fp);
+    fclose(fp);
+    if (bytesRead != tail) {
+        fprintf(stderr, "%s is cut short\n", path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "callstack.h"
+
+#define SAVESTATE_MAGIC 0x53544248 /* "HBTS" */
+#define SAVESTATE_VERSION 8
+
+/* Only 0x8000-0xFFFF is mutable, the ROM below it never needs saving */
+#define SAVESTATE_RAM_START 0x8000
+#define SAVESTATE_RAM_SIZE 0x8000
+
+/* On a CGB the other VRAM bank and the six WRAM banks not switched in follow the RAM */
+#define SAVESTATE_VRAM_BANKS_SIZE 0x2000
+#define SAVESTATE_WRAM_BANKS_SIZE (6 * 0x1000)
+#define SAVESTATE_BANKS_SIZE (SAVESTATE_VRAM_BANKS_SIZE + SAVESTATE_WRAM_BANKS_SIZE)
+
+/*
+ * Flat save state. Everything is fixed width and the struct is
+ * copied as-is, so a snapshot is a few stores plus one memcpy of
+ * the RAM. Only the first size bytes are in use: the CGB banks at
+ * the end are left out on a DMG, which is half the state. Bump
+ * SAVESTATE_VERSION whenever the layout changes.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size; /* bytes in use, SAVESTATE_BASE_SIZE plus the banks on a CGB */
+    uint32_t reserved;
+
+    /* CPU */
+    struct {
+        uint16_t af;
+        uint16_t bc;
+        uint16_t de;
+        uint16_t hl;
+        uint16_t sp;
+        uint16_t pc;
+        uint8_t ime;
+        uint8_t ime_delay;
+        uint8_t halted;
+        uint8_t pad[1];
+    } cpu;
+
+    /* PPU */
+    struct {
+        int32_t ly_counter;
+        uint8_t ly;
+        uint8_t pad[3];
+    } ppu;
+
+    /* Timer, DIV and TIMA themselves are flushed into the RAM */
+    struct {
+        uint64_t cycles;
+        uint64_t div_base;
+    } timer;
+
+    /* OAM DMA, the copy is done so only the bus lock is left */
+    struct {
+        uint64_t ends_at;
+    } dma;
+
+    /* Serial, SB and SC are in the RAM */
+    struct {
+        uint64_t event_at;
+    } serial;
+
+    /* CGB, all zero on a DMG. The banks switched in are in ram, the rest in banks */
+    struct {
+        uint8_t enabled;
+        uint8_t double_speed;
+        uint8_t vram_bank;
+        uint8_t wram_bank;
+        uint8_t hdma_active;
+        uint8_t speed_switch;
+        uint8_t pad[2];
+        uint32_t hdma_stall;
+        uint32_t pad2;
+        uint64_t event_at;
+        uint8_t bg_palettes[64];
+        uint8_t obj_palettes[64];
+    } cgb;
+
+    /* Shadow call stack, so samples after a rewind see the right frames */
+    call_stack callStack;
+
+    /* 0x8000-0xFFFF */
+    uint8_t ram[SAVESTATE_RAM_SIZE];
+
+    /* CGB only, the VRAM bank then WRAM banks 1-7 in order, none of them switched in */
+    uint8_t banks[SAVESTATE_BANKS_SIZE];
+} gb_savestate;
+
+/* Everything but the banks */
+#define SAVESTATE_BASE_SIZE offsetof(gb_savestate, banks)
+
+void savestate_capture(gb_savestate *state);
+int savestate_restore(const gb_savestate *state);
+int savestate_write_file(const gb_savestate *state, const char *path);
+int savestate_read_file(gb_savestate *state, const char *path);
+
+#endif /* SAVESTATE_H */
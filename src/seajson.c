@@ -363,7 +363,47 @@ jarray get_array(seajson json, const char *value) {
   return error;
 }
 
+/*
+ * Where the item starting at position ends, on the , or ] after it.
+ * Strings are skipped whole, escapes included, so brackets in them do
+ * not count.
+ */
+static unsigned long jarray_item_end(const char *arrayString, unsigned long position) {
+  int inception = 0;
+  int inString = 0;
+  for (unsigned long i = position; arrayString[i]; i++) {
+    char currentChar = arrayString[i];
+    if (inString) {
+      if (currentChar == '\\' && arrayString[i+1]) {
+        i++;
+      } else if (currentChar == '\"') {
+        inString = 0;
+      }
+    } else if (currentChar == '\"') {
+      inString = 1;
+    } else if (currentChar == '{' || currentChar == '[') {
+      inception++;
+    } else if (currentChar == '}' || currentChar == ']') {
+      if (inception == 0) {
+        return i;
+      }
+      inception--;
+    } else if (currentChar == ',' && inception == 0) {
+      return i;
+    }
+  }
+  return position;
+}
+
+static char* copy_jarray_item(const char *arrayString, unsigned long start, unsigned long end) {
+  char* returnItem = malloc(sizeof(char) * (end - start + 1));
+  memcpy(returnItem, arrayString + start, end - start);
+  returnItem[end - start] = '\0';
+  return returnItem;
+}
+
 /* This is a very WIP function, it does not allow JSONs such that are formatted with new lines or spaces in the slightest currently - either convert a JSON to not have whitespace and then do rest of the function or modify the function to behave differently. */
+/* It walks from the start every call, use next_item_from_jarray() to go through a whole array */
 char* get_item_from_jarray(jarray array, int index) {
   if (array.isValid == 0) {
     fprintf(stderr, "SeaJSON Error: Non-valid jarray passed into get_item_from_array.\n");
@@ -378,57 +418,68 @@ char* get_item_from_jarray(jarray array, int index) {
     exit(1);
   }
   char *arrayString = array.arrayString;
-  unsigned long arrStrLen = strlen(arrayString);
-  int itemIndex = 0;
-  char* returnItem = malloc(sizeof(char) * arrStrLen);
-  int returnItemIndex = 0;
-  int inception = 0;
-  int inceptionInString = 0;
   /* Skip the first item since it will just be a [ */
-  for (int i = 1; i < arrStrLen; i++) {
-    char currentChar = arrayString[i];
-    if (inceptionInString == 0) {
-      if (currentChar == '{') {
-        inception++;
-      } else if (currentChar == '}') {
-        inception--;
-      } else if (currentChar == '\"') {
-        inceptionInString = 1;
-      } else if (currentChar == '[') {
-        inception++;
-      } else if (currentChar == ']') {
-        inception--;
-      }
-    } else {
-      /* We are currently reading chars in a string obj */
-      if (currentChar == '\"') {
-        /* If \" then cancel out */
-        if (arrayString[i-1] != '\\') {
-          inceptionInString = 0;
-        }
-      }
+  unsigned long position = 1;
+  for (int itemIndex = 0; itemIndex < index; itemIndex++) {
+    unsigned long end = jarray_item_end(arrayString, position);
+    if (arrayString[end] != ',') {
+      fprintf(stderr, "SeaJSON Error: Failed to find item in array.\n");
+      exit(1);
     }
-    char futureChar = arrayString[i+1];
-    if (itemIndex == index) {
-      returnItem[returnItemIndex] = currentChar;
-      returnItemIndex++;
-      if ((futureChar == ',' && inception == 0 && inceptionInString == 0) || i == (strlen(arrayString)-2)) {
-        returnItem[returnItemIndex] = '\0';
-        return returnItem;
-      }
-    } else {
-      if (i == (strlen(arrayString)-2)) {
-        fprintf(stderr, "SeaJSON Error: Failed to find item in array.\n");
-        exit(1);
-      }
-      if (futureChar == ',' && inception == 0 && inceptionInString == 0) {
-        i++;
-        itemIndex++;
-      }
+    position = end + 1;
+  }
+  return copy_jarray_item(arrayString, position, jarray_item_end(arrayString, position));
+}
+
+jarray_iterator iterate_jarray(jarray array) {
+  jarray_iterator iterator;
+  iterator.array = array;
+  /* Skip the [ */
+  iterator.position = 1;
+  return iterator;
+}
+
+/* Each call picks up where the last one stopped, NULL once the ] is reached */
+char* next_item_from_jarray(jarray_iterator *iterator) {
+  if (iterator->array.isValid == 0) {
+    fprintf(stderr, "SeaJSON Error: Non-valid jarray passed into next_item_from_jarray.\n");
+    exit(1);
+  }
+  char *arrayString = iterator->array.arrayString;
+  unsigned long start = iterator->position;
+  if (arrayString[start - 1] == ']' || arrayString[start] == ']' || arrayString[start] == '\0') {
+    return NULL;
+  }
+  unsigned long end = jarray_item_end(arrayString, start);
+  if (end == start) {
+    return NULL;
+  }
+  iterator->position = end + 1;
+  return copy_jarray_item(arrayString, start, end);
+}
+
+/* For a JSON that is an array itself, the jarray shares the string so only free the json */
+jarray jarray_from_json(seajson json) {
+  jarray returnJarray;
+  returnJarray.arrayString = json;
+  returnJarray.itemCount = 0;
+  returnJarray.isValid = (json && json[0] == '[');
+  if (!returnJarray.isValid) {
+    return returnJarray;
+  }
+  unsigned long position = 1;
+  while (json[position] && json[position] != ']') {
+    unsigned long end = jarray_item_end(json, position);
+    if (end == position) {
+      break;
     }
+    returnJarray.itemCount++;
+    if (json[end] != ',') {
+      break;
+    }
+    position = end + 1;
   }
-  free(returnItem);
-  return NULL;
+  return returnJarray;
 }
 
 void free_jarray(jarray array) {
@@ -449,8 +500,11 @@ seajson remove_whitespace_from_json(seajson json) {
       } else if (currentChar == ' ') {
         /* Space */
         continue;
-      } else if (currentChar == ' ') {
-        /* Tab (i think) */
+      } else if (currentChar == '\t') {
+        /* Tab */
+        continue;
+      } else if (currentChar == '\r') {
+        /* Windows line endings */
         continue;
       } else if (currentChar == '\"') {
         stringInception = 1;
@@ -648,7 +702,7 @@ seajson add_string_seajson(seajson json, const char* key, const char *value) {
   unsigned long jsonLen = strlen(json);
   unsigned long keyLen = strlen(key);
   unsigned long valueLen = strlen(value);
-  seajson returnJson = malloc(sizeof(char) * (jsonLen + keyLen + valueLen + 6));
+  seajson returnJson = malloc(sizeof(char) * (jsonLen + keyLen + valueLen + 7));
   for (int i = 0; i < jsonLen; i++) {
     returnJson[i] = json[i];
   }
@@ -679,7 +733,7 @@ seajson add_item_seajson(seajson json, const char* key, const char *value) {
   unsigned long jsonLen = strlen(json);
   unsigned long keyLen = strlen(key);
   unsigned long valueLen = strlen(value);
-  seajson returnJson = malloc(sizeof(char) * (jsonLen + keyLen + valueLen + 4));
+  seajson returnJson = malloc(sizeof(char) * (jsonLen + keyLen + valueLen + 5));
   for (int i = 0; i < jsonLen; i++) {
     returnJson[i] = json[i];
   }
@@ -1178,5 +1232,5 @@ char * getstring(char *funckey, char *dict) {
 
 /* Just a function to return SeaJSON build version in case a program ever needs to check */
 int seaJSONBuildVersion(void) {
-  return 18;
+  return 20;
 }
\ No newline at end of file
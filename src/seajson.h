@@ -24,6 +24,12 @@ typedef struct {
   int isValid;
 } jarray;
 
+/* Walks a jarray front to back without rescanning what came before */
+typedef struct {
+  jarray array;
+  unsigned long position;
+} jarray_iterator;
+
 /* Functions */
 
 seajson init_json_from_file(const char *restrict filename);
@@ -34,6 +40,9 @@ seajson get_dictionary(seajson json, const char *value);
 jarray get_array(seajson json, const char *value);
 jarray new_jarray(void);
 char* get_item_from_jarray(jarray array, int index);
+jarray_iterator iterate_jarray(jarray array);
+char* next_item_from_jarray(jarray_iterator *iterator);
+jarray jarray_from_json(seajson json);
 void free_jarray(jarray array);
 seajson remove_whitespace_from_json(seajson json);
 jarray remove_whitespace_from_jarray(jarray array);
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "serial.h"
+#include "interrupts.h"
+#include "timer.h"
+#include "cgb.h"
+#include "emu.h"
+
+/* A byte at 8192 Hz, or at 262144 Hz with the CGB's fast clock */
+#define SERIAL_BYTE_CYCLES 4096
+#define SERIAL_FAST_BYTE_CYCLES 128
+/* How often a side waiting on the other's clock looks again, when both were listening */
+#define LINK_POLL_CYCLES SERIAL_BYTE_CYCLES
+
+#define LINK_MAGIC 0x4B4E4C48 /* "HLNK" */
+
+uint64_t serialEventAt = SERIAL_NEVER;
+uint8_t *serialOutput;
+size_t serialOutputLength;
+static size_t serialOutputCapacity;
+static FILE *captureFile;
+
+/* Written by one side only, request is how many bytes it has clocked out */
+typedef struct {
+    _Atomic uint32_t request;
+    _Atomic uint32_t reply; /* the last of the other side's requests answered */
+    _Atomic uint32_t closed;
+    _Atomic uint32_t listening; /* SC has a transfer waiting on the other side's clock */
+    uint8_t requestByte;
+    uint8_t replyByte;
+} link_port;
+
+typedef struct {
+    _Atomic uint32_t magic;
+    _Atomic uint32_t sides;
+    link_port ports[2];
+} link_shared;
+
+static link_shared *linkShared;
+static int linkSide;
+/* Their last request as of the previous frame end */
+static uint32_t ignoredRequest;
+
+static void serial_output_add(uint8_t value) {
+    if (speculating) {
+        return; /* Sent again when the frame runs for real */
+    }
+    if (serialOutputLength == serialOutputCapacity) {
+        size_t capacity = serialOutputCapacity ? serialOutputCapacity * 2 : 256;
+        uint8_t *grown = realloc(serialOutput, capacity);
+        if (!grown) {
+            return;
+        }
+        serialOutput = grown;
+        serialOutputCapacity = capacity;
+    }
+    serialOutput[serialOutputLength++] = value;
+    if (captureFile) {
+        fputc(value, captureFile);
+        if (value == '\n') {
+            fflush(captureFile);
+        }
+    }
+}
+
+/*
+ * Takes the byte the other side clocked out, if there is one, and hands
+ * it reply. Returns -1 when there was nothing to answer.
+ */
+static int link_answer(uint8_t reply) {
+    link_port *mine = &linkShared->ports[linkSide];
+    link_port *theirs = &linkShared->ports[!linkSide];
+    uint32_t request = atomic_load_explicit(&theirs->request, memory_order_acquire);
+    if (request == atomic_load_explicit(&mine->reply, memory_order_relaxed)) {
+        return -1;
+    }
+    uint8_t in = theirs->requestByte;
+    mine->replyByte = reply;
+    atomic_store_explicit(&mine->reply, request, memory_order_release);
+    return in;
+}
+
+/* The internal clock side, sends out and waits for what comes back */
+static uint8_t link_exchange(uint8_t out) {
+    link_port *mine = &linkShared->ports[linkSide];
+    link_port *theirs = &linkShared->ports[!linkSide];
+    uint32_t request = atomic_load_explicit(&mine->request, memory_order_relaxed) + 1;
+    mine->requestByte = out;
+    atomic_store_explicit(&mine->request, request, memory_order_release);
+    while (atomic_load_explicit(&theirs->reply, memory_order_acquire) != request) {
+        if (atomic_load_explicit(&theirs->closed, memory_order_acquire)) {
+            return 0xFF; /* Unplugged */
+        }
+        /* Both clocking at once, answer theirs so neither waits forever */
+        link_answer(0xFF);
+        sched_yield();
+    }
+    return theirs->replyByte;
+}
+
+/*
+ * Waits for the other side to clock a byte at us. Gives up if it is
+ * listening too, then neither would ever clock. Returns -1 if it gave up.
+ */
+static int link_wait(uint8_t reply) {
+    link_port *theirs = &linkShared->ports[!linkSide];
+    for (;;) {
+        int in = link_answer(reply);
+        if (in >= 0) {
+            return in;
+        }
+        if (atomic_load_explicit(&theirs->listening, memory_order_acquire) || atomic_load_explicit(&theirs->closed, memory_order_acquire)) {
+            return -1;
+        }
+        sched_yield();
+    }
+}
+
+static void link_listen(int listening) {
+    if (linkShared) {
+        atomic_store_explicit(&linkShared->ports[linkSide].listening, listening, memory_order_release);
+    }
+}
+
+static void serial_finish(uint8_t in) {
+    emuRAM[SB_ADDR] = in;
+    emuRAM[SC_ADDR] &= 0x7F;
+    link_listen(0);
+    interrupt_request(INT_SERIAL);
+}
+
+void serial_write(uint16_t addr, uint8_t value) {
+    if (addr == SB_ADDR) {
+        emuRAM[SB_ADDR] = value;
+        return;
+    }
+    /* The clock speed bit only exists on a CGB */
+    emuRAM[SC_ADDR] = value | (cgbMode ? 0x7C : 0x7E);
+    int listening = 0;
+    if (!(value & 0x80)) {
+        serialEventAt = SERIAL_NEVER;
+    } else if (value & 0x01) {
+        serial_output_add(emuRAM[SB_ADDR]);
+        int fast = cgbMode && (value & 0x02);
+        serialEventAt = cycleCount + (fast ? SERIAL_FAST_BYTE_CYCLES : SERIAL_BYTE_CYCLES);
+    } else {
+        /* External clock, only a link partner can finish it, no sooner than a byte takes */
+        listening = linkShared != NULL;
+        serialEventAt = linkShared ? cycleCount + SERIAL_BYTE_CYCLES : SERIAL_NEVER;
+    }
+    link_listen(listening);
+    schedule_update();
+}
+
+void serial_event(void) {
+    serialEventAt = SERIAL_NEVER;
+    if (emuRAM[SC_ADDR] & 0x01) {
+        serial_finish(linkShared ? link_exchange(emuRAM[SB_ADDR]) : 0xFF);
+    } else if (linkShared) {
+        /* Both sides meet here, so where the byte lands does not depend on which ran ahead */
+        int in = link_wait(emuRAM[SB_ADDR]);
+        if (in >= 0) {
+            serial_finish((uint8_t)in);
+        } else {
+            serialEventAt = cycleCount + LINK_POLL_CYCLES;
+        }
+    }
+    schedule_update();
+}
+
+/*
+ * Not listening, nothing shifts in and they get $FF. Only once a byte has
+ * waited a whole frame though, a game is usually just about to listen.
+ */
+void serial_frame_end(void) {
+    if (!linkShared || (emuRAM[SC_ADDR] & 0x81) == 0x80) {
+        return; /* Waiting on their clock, serial_event() finishes it */
+    }
+    uint32_t request = atomic_load_explicit(&linkShared->ports[!linkSide].request, memory_order_acquire);
+    if (request == ignoredRequest) {
+        link_answer(0xFF);
+    }
+    ignoredRequest = request;
+}
+
+int serial_capture_open(const char *path) {
+    if (!strcmp(path, "-")) {
+        captureFile = stdout;
+        return 0;
+    }
+    captureFile = fopen(path, "wb");
+    if (!captureFile) {
+        printf("serial: unable to open %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+void serial_capture_close(void) {
+    if (captureFile && captureFile != stdout) {
+        fclose(captureFile);
+    } else if (captureFile) {
+        fflush(captureFile);
+    }
+    captureFile = NULL;
+}
+
+/*
+ * Whoever creates the file is side 0 and sets it up, the second process
+ * to open it is side 1. Both wait here until the other one is there.
+ */
+int link_open(const char *path) {
+    int side = 0;
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        fd = open(path, O_RDWR);
+        side = 1;
+    }
+    if (fd < 0) {
+        printf("link: unable to open %s\n", path);
+        return -1;
+    }
+    if (side == 0 && ftruncate(fd, sizeof(link_shared)) != 0) {
+        printf("link: unable to size %s\n", path);
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    /* Side 0 may not have sized it yet */
+    struct stat info;
+    while (fstat(fd, &info) == 0 && info.st_size < (off_t)sizeof(link_shared)) {
+        sched_yield();
+    }
+    link_shared *shared = mmap(NULL, sizeof(link_shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shared == MAP_FAILED) {
+        printf("link: unable to map %s\n", path);
+        return -1;
+    }
+
+    if (side == 0) {
+        atomic_store_explicit(&shared->magic, LINK_MAGIC, memory_order_release);
+    }
+    while (atomic_load_explicit(&shared->magic, memory_order_acquire) != LINK_MAGIC) {
+        sched_yield();
+    }
+    if (atomic_fetch_add(&shared->sides, 1) >= 2) {
+        printf("link: %s already has two sides, remove it if it is left over\n", path);
+        munmap(shared, sizeof(link_shared));
+        return -1;
+    }
+    printf("link: side %d on %s, waiting for the other side\n", side, path);
+    while (atomic_load(&shared->sides) < 2) {
+        sched_yield();
+    }
+    if (side == 0) {
+        /* Both are mapped, the name is not needed any more */
+        unlink(path);
+    }
+    linkShared = shared;
+    linkSide = side;
+    return 0;
+}
+
+void link_close(void) {
+    if (!linkShared) {
+        return;
+    }
+    atomic_store_explicit(&linkShared->ports[linkSide].closed, 1, memory_order_release);
+    munmap(linkShared, sizeof(link_shared));
+    linkShared = NULL;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SB_ADDR 0xFF01
+#define SC_ADDR 0xFF02
+
+/* No transfer running */
+#define SERIAL_NEVER UINT64_MAX
+
+/*
+ * The serial port. A transfer is an event run_frame() stops at once the
+ * eighth bit has gone out, nothing happens per bit. With no cable the
+ * byte shifted in is $FF. Every byte clocked out is kept in serialOutput,
+ * which is how blargg's test ROMs print their results.
+ */
+extern uint64_t serialEventAt; /* in cycleCount, SERIAL_NEVER when idle */
+extern uint8_t *serialOutput;
+extern size_t serialOutputLength;
+
+void serial_write(uint16_t addr, uint8_t value);
+/* Run by the scheduler once cycleCount reaches serialEventAt */
+void serial_event(void);
+/* Answers the link partner if it clocked a byte at us, run after every frame */
+void serial_frame_end(void);
+
+/* Also writes serial output to path as it comes, - for stdout */
+int serial_capture_open(const char *path);
+void serial_capture_close(void);
+
+/*
+ * Link cable between two honeybun processes started with the same path.
+ * They share one mapping with a mailbox each way and only meet when a
+ * byte goes across. The side with the internal clock posts its byte and
+ * waits for the reply. The other side waits for it at the end of its own
+ * transfer, or answers $FF between frames if it is not listening.
+ */
+int link_open(const char *path);
+void link_close(void);
+
+#endif /* SERIAL_H */
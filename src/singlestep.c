@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "emu.h"
+#include "alu.h"
+#include "interrupts.h"
+#include "seajson.h"
+
+/*
+ * honeybun-singlestep, runs the SM83 single step tests (one JSON file per
+ * opcode, thousands of cases in each) through execute_instruction(). A
+ * case sets the registers and a few bytes of a flat 64KB, runs one
+ * instruction and checks the registers, the bytes and the cycles against
+ * what it expects. Files run in forked children, as many at once as there
+ * are cores, since the CPU is process globals.
+ */
+
+#define OPTSTR "d:n:h"
+
+#define FAILURE_SIZE 256
+
+/* What a child sends back, small enough for one atomic pipe write */
+typedef struct {
+    unsigned long tests;
+    unsigned long failed;
+    char firstFailure[FAILURE_SIZE];
+} file_result;
+
+typedef struct {
+    char *path;
+    pid_t pid;
+    int pipe; /* read end while the child runs */
+    file_result result;
+} test_file;
+
+static test_file *files;
+static int fileCount;
+static int fileCapacity;
+
+static int compare_files(const void *a, const void *b) {
+    return strcmp(((const test_file *)a)->path, ((const test_file *)b)->path);
+}
+
+static void find_files(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "honeybun-singlestep: unable to open %s\n", dir);
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(d))) {
+        const char *dot = strrchr(entry->d_name, '.');
+        if (entry->d_name[0] == '.' || !dot || strcmp(dot, ".json")) {
+            continue;
+        }
+        if (fileCount == fileCapacity) {
+            fileCapacity = fileCapacity ? fileCapacity * 2 : 512;
+            files = realloc(files, sizeof(test_file) * fileCapacity);
+            if (!files) {
+                fprintf(stderr, "honeybun-singlestep: out of memory\n");
+                exit(1);
+            }
+        }
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        memset(&files[fileCount], 0, sizeof(test_file));
+        files[fileCount].path = strdup(path);
+        files[fileCount].pipe = -1;
+        fileCount++;
+    }
+    closedir(d);
+}
+
+/* Calls back with every [address, value] pair in a state's "ram" */
+static void for_each_ram(seajson state, void (*fn)(uint16_t addr, uint8_t value, void *context), void *context) {
+    jarray ram = get_array(state, "ram");
+    if (!ram.isValid) {
+        return;
+    }
+    jarray_iterator iterator = iterate_jarray(ram);
+    char *pair;
+    while ((pair = next_item_from_jarray(&iterator))) {
+        jarray entry = jarray_from_json(pair);
+        if (entry.itemCount == 2) {
+            fn((uint16_t)get_int_from_jarray(entry, 0), (uint8_t)get_int_from_jarray(entry, 1), context);
+        }
+        free(pair);
+    }
+    free_jarray(ram);
+}
+
+static void poke(uint16_t addr, uint8_t value, void *context) {
+    emuRAM[addr] = value;
+}
+
+static void clear(uint16_t addr, uint8_t value, void *context) {
+    emuRAM[addr] = 0;
+}
+
+/* The first byte that came out wrong, if any */
+typedef struct {
+    int bad;
+    uint16_t addr;
+    uint8_t expected;
+} ram_check;
+
+static void check(uint16_t addr, uint8_t value, void *context) {
+    ram_check *result = context;
+    if (!result->bad && emuRAM[addr] != value) {
+        result->bad = 1;
+        result->addr = addr;
+        result->expected = value;
+    }
+}
+
+static void load_state(seajson state) {
+    pc = (uint16_t)get_int(state, "pc");
+    sp = (uint16_t)get_int(state, "sp");
+    af = (uint16_t)((get_int(state, "a") << 8) | get_int(state, "f"));
+    bc = (uint16_t)((get_int(state, "b") << 8) | get_int(state, "c"));
+    de = (uint16_t)((get_int(state, "d") << 8) | get_int(state, "e"));
+    hl = (uint16_t)((get_int(state, "h") << 8) | get_int(state, "l"));
+    interrupts_enabled = (int)get_int(state, "ime");
+    imeDelay = 0;
+    halted = 0;
+    emuRAM[IE_ADDR] = (uint8_t)get_int(state, "ie");
+    for_each_ram(state, poke, NULL);
+}
+
+/* Runs one case, 0 if it passed, otherwise why it did not in why */
+static int run_case(const char *item, char *why, size_t size) {
+    seajson initial = get_dictionary((seajson)item, "initial");
+    seajson final = get_dictionary((seajson)item, "final");
+    if (!initial || !final) {
+        snprintf(why, size, "no initial or final state");
+        free(initial);
+        free(final);
+        return 1;
+    }
+    jarray cycleList = get_array((seajson)item, "cycles");
+    int expectedCycles = cycleList.isValid ? cycleList.itemCount * 4 : -1;
+    if (cycleList.isValid) {
+        free_jarray(cycleList);
+    }
+
+    load_state(initial);
+    int cycles = execute_instruction();
+
+    static const struct { const char *name; int shift; uint16_t *reg; } regs[] = {
+        { "a", 8, &af }, { "f", 0, &af }, { "b", 8, &bc }, { "c", 0, &bc },
+        { "d", 8, &de }, { "e", 0, &de }, { "h", 8, &hl }, { "l", 0, &hl },
+    };
+    int failed = 1;
+    char *name = get_string((seajson)item, "name");
+    if (!name) {
+        name = strdup("?");
+    }
+    if (pc != get_int(final, "pc")) {
+        snprintf(why, size, "%s: pc $%04X, expected $%04X", name, pc, (unsigned)get_int(final, "pc"));
+    } else if (sp != get_int(final, "sp")) {
+        snprintf(why, size, "%s: sp $%04X, expected $%04X", name, sp, (unsigned)get_int(final, "sp"));
+    } else {
+        failed = 0;
+        for (size_t i = 0; i < sizeof(regs) / sizeof(regs[0]); i++) {
+            uint8_t value = (uint8_t)(*regs[i].reg >> regs[i].shift);
+            unsigned long expected = get_int(final, regs[i].name);
+            if (value != expected) {
+                snprintf(why, size, "%s: %s $%02X, expected $%02lX", name, regs[i].name, value, expected);
+                failed = 1;
+                break;
+            }
+        }
+    }
+    if (!failed) {
+        /* EI's delay counts as IME being on, however the file records it */
+        int ime = interrupts_enabled || imeDelay;
+        int expectedIme = get_int(final, "ime") || get_int(final, "ei");
+        ram_check ram = { 0 };
+        for_each_ram(final, check, &ram);
+        if (ime != expectedIme) {
+            snprintf(why, size, "%s: ime %d, expected %d", name, ime, expectedIme);
+            failed = 1;
+        } else if (ram.bad) {
+            snprintf(why, size, "%s: [$%04X] $%02X, expected $%02X", name, ram.addr, emuRAM[ram.addr], ram.expected);
+            failed = 1;
+        } else if (expectedCycles >= 0 && cycles != expectedCycles) {
+            snprintf(why, size, "%s: %d cycles, expected %d", name, cycles, expectedCycles);
+            failed = 1;
+        }
+    }
+
+    /* Leave the 64KB as zero as the next case expects */
+    for_each_ram(initial, clear, NULL);
+    for_each_ram(final, clear, NULL);
+    free(name);
+    free_json(initial);
+    free_json(final);
+    return failed;
+}
+
+/* Runs in the child, never returns */
+static void run_file(const char *path, int out) {
+    /* STOP and friends talk on stdout */
+    int devNull = open("/dev/null", O_WRONLY);
+    if (devNull >= 0) {
+        dup2(devNull, STDOUT_FILENO);
+        close(devNull);
+    }
+
+    file_result result;
+    memset(&result, 0, sizeof(result));
+    /* Immediates past $FFFF read two spare bytes */
+    emuRAM = calloc(1, 0x10000 + 2);
+    alu_init();
+    bus_flat();
+
+    seajson raw = init_json_from_file(path);
+    seajson json = remove_whitespace_from_json(raw);
+    free_json(raw);
+    jarray cases = jarray_from_json(json);
+    if (!cases.isValid) {
+        snprintf(result.firstFailure, FAILURE_SIZE, "not a JSON array");
+        result.failed = 1;
+    } else {
+        jarray_iterator iterator = iterate_jarray(cases);
+        char *item;
+        char why[FAILURE_SIZE];
+        while ((item = next_item_from_jarray(&iterator))) {
+            result.tests++;
+            if (run_case(item, why, sizeof(why))) {
+                if (!result.failed) {
+                    memcpy(result.firstFailure, why, FAILURE_SIZE);
+                }
+                result.failed++;
+            }
+            free(item);
+        }
+    }
+    free_json(json);
+    if (write(out, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+static void start_file(test_file *file) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("honeybun-singlestep: pipe");
+        exit(1);
+    }
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("honeybun-singlestep: fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        run_file(file->path, fds[1]);
+    }
+    close(fds[1]);
+    file->pid = pid;
+    file->pipe = fds[0];
+}
+
+/* Collects whatever child exits next, returns its file */
+static test_file *finish_file(void) {
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0) {
+        if (errno != EINTR) {
+            perror("honeybun-singlestep: wait");
+            exit(1);
+        }
+        return NULL;
+    }
+    test_file *file = NULL;
+    for (int i = 0; i < fileCount; i++) {
+        if (files[i].pid == pid && files[i].pipe >= 0) {
+            file = &files[i];
+            break;
+        }
+    }
+    if (!file) {
+        return NULL;
+    }
+    ssize_t got = read(file->pipe, &file->result, sizeof(file->result));
+    close(file->pipe);
+    file->pipe = -1;
+    if (got != sizeof(file->result)) {
+        /* Crashed partway, count the file as one failure */
+        memset(&file->result, 0, sizeof(file->result));
+        file->result.failed = 1;
+        if (WIFSIGNALED(status)) {
+            snprintf(file->result.firstFailure, FAILURE_SIZE, "crashed, signal %d", WTERMSIG(status));
+        } else {
+            snprintf(file->result.firstFailure, FAILURE_SIZE, "crashed, exit status %d", WEXITSTATUS(status));
+        }
+    }
+    return file;
+}
+
+static void show_help(void) {
+    printf("Usage: honeybun-singlestep <options>\n\n");
+    printf(" -d: (required) directory of SM83 single step test JSON files\n");
+    printf(" -n: (optional) files to run at once, defaults to the number of cores\n");
+    printf(" -h: show usage\n");
+}
+
+int main(int argc, char **argv) {
+    const char *testDir = NULL;
+    long parallel = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    while ((opt = getopt(argc, argv, OPTSTR)) != EOF) {
+        if (opt == 'd') {
+            testDir = optarg;
+        } else if (opt == 'n') {
+            parallel = atol(optarg);
+        } else {
+            show_help();
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (!testDir) {
+        show_help();
+        return 1;
+    }
+    if (parallel < 1) {
+        parallel = 1;
+    }
+
+    find_files(testDir);
+    if (!fileCount) {
+        fprintf(stderr, "honeybun-singlestep: no JSON files in %s\n", testDir);
+        return 1;
+    }
+    qsort(files, fileCount, sizeof(test_file), compare_files);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int next = 0;
+    int running = 0;
+    while (next < fileCount || running) {
+        if (next < fileCount && running < parallel) {
+            start_file(&files[next++]);
+            running++;
+            continue;
+        }
+        if (finish_file()) {
+            running--;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    /* Failures in file order, whatever finished first */
+    unsigned long tests = 0;
+    unsigned long failed = 0;
+    int failedFiles = 0;
+    for (int i = 0; i < fileCount; i++) {
+        tests += files[i].result.tests;
+        failed += files[i].result.failed;
+        if (files[i].result.failed) {
+            failedFiles++;
+            printf("%s: %lu of %lu failed, first %s\n", files[i].path, files[i].result.failed,
+                files[i].result.tests, files[i].result.firstFailure);
+        }
+    }
+    printf("honeybun-singlestep: %lu tests in %d files, %lu failed in %d files\n", tests, fileCount, failed, failedFiles);
+    printf("honeybun-singlestep: %.2fs, %.0f tests/s\n", seconds, seconds > 0 ? tests / seconds : 0.0);
+    return failed ? 1 : 0;
+}
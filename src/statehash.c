@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "statehash.h"
+#include "emu.h"
+
+/*
+ * XXH64. Four independent lanes over 32-byte stripes, which keeps the
+ * multipliers busy and lets the compiler vectorise where it can.
+ */
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t xxh_merge(uint64_t acc, uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *p = data;
+    const uint8_t *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        const uint8_t *limit = end - 32;
+        do {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+
+    h += (uint64_t)len;
+    while (p + 8 <= end) {
+        h ^= xxh_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static const char *subsystemNames[HASH_SUBSYSTEMS] = {
+    "cpu", "ppu", "vram", "xram", "wram", "hiram", "framebuffer"
+};
+
+#define RAM_OFFSET(addr) ((addr) - SAVESTATE_RAM_START)
+
+/*
+ * Hashes the running machine, scratch is only there to avoid a 32 KB stack
+ * frame. The framebuffer is derived from VRAM and registers that are hashed
+ * anyway, so it is only worth rendering when checking the renderer itself.
+ */
+void hash_machine(hash_log_record *record, gb_savestate *scratch, int withFramebuffer) {
+    savestate_capture(scratch);
+
+    uint64_t cpu = hash64(&scratch->cpu, sizeof(scratch->cpu), 0);
+    cpu = hash64(&scratch->callStack, sizeof(scratch->callStack), cpu);
+    /* The clock and what is scheduled on it, a tier that gets the cycles wrong shows here first */
+    cpu = hash64(&scratch->timer, sizeof(scratch->timer), cpu);
+    cpu = hash64(&scratch->dma, sizeof(scratch->dma), cpu);
+    record->hashes[HASH_CPU] = hash64(&scratch->serial, sizeof(scratch->serial), cpu);
+    record->hashes[HASH_PPU] = hash64(&scratch->ppu, sizeof(scratch->ppu), 0);
+    record->hashes[HASH_VRAM] = hash64(scratch->ram + RAM_OFFSET(0x8000), 0x2000, 0);
+    record->hashes[HASH_XRAM] = hash64(scratch->ram + RAM_OFFSET(0xA000), 0x2000, 0);
+    record->hashes[HASH_WRAM] = hash64(scratch->ram + RAM_OFFSET(0xC000), 0x2000, 0);
+    if (scratch->cgb.enabled) {
+        /* The banks and palettes go in with what they belong to */
+        record->hashes[HASH_PPU] = hash64(&scratch->cgb, sizeof(scratch->cgb), record->hashes[HASH_PPU]);
+        record->hashes[HASH_VRAM] = hash64(scratch->banks, SAVESTATE_VRAM_BANKS_SIZE, record->hashes[HASH_VRAM]);
+        record->hashes[HASH_WRAM] = hash64(scratch->banks + SAVESTATE_VRAM_BANKS_SIZE, SAVESTATE_WRAM_BANKS_SIZE, record->hashes[HASH_WRAM]);
+    }
+    record->hashes[HASH_HIRAM] = hash64(scratch->ram + RAM_OFFSET(0xE000), 0x2000, 0);
+    record->hashes[HASH_FRAMEBUFFER] = 0;
+    if (withFramebuffer) {
+        render_framebuffer();
+        record->hashes[HASH_FRAMEBUFFER] = hash64(framebuffer, sizeof(framebuffer), 0);
+    }
+}
+
+hash_log *hash_log_open(const char *path, int withFramebuffer) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "unable to open hash log %s for writing\n", path);
+        return NULL;
+    }
+    hash_log *log = calloc(1, sizeof(hash_log));
+    if (!log) {
+        fclose(fp);
+        return NULL;
+    }
+    log->fp = fp;
+    log->withFramebuffer = withFramebuffer;
+    log->scratch = malloc(sizeof(gb_savestate));
+    if (!log->scratch) {
+        hash_log_close(log);
+        return NULL;
+    }
+    hash_log_header header = { HASH_LOG_MAGIC, HASH_LOG_VERSION, HASH_SUBSYSTEMS, 0 };
+    fwrite(&header, sizeof(header), 1, fp);
+    return log;
+}
+
+void hash_log_frame(hash_log *log) {
+    hash_log_record record;
+    record.frame = log->frame++;
+    record.reserved = 0;
+    hash_machine(&record, log->scratch, log->withFramebuffer);
+    fwrite(&record, sizeof(record), 1, log->fp);
+}
+
+void hash_log_close(hash_log *log) {
+    if (!log) {
+        return;
+    }
+    fclose(log->fp);
+    free(log->scratch);
+    free(log);
+}
+
+static FILE *open_log_for_compare(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "unable to open hash log %s\n", path);
+        return NULL;
+    }
+    hash_log_header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != HASH_LOG_MAGIC) {
+        fprintf(stderr, "%s is not a hash log\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    if (header.version != HASH_LOG_VERSION || header.subsystems != HASH_SUBSYSTEMS) {
+        fprintf(stderr, "hash log %s has version %u, expected %u\n", path, header.version, HASH_LOG_VERSION);
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+/* Returns 0 if the logs match, 1 on the first divergence, -1 if either can't be read */
+int hash_log_compare(const char *pathA, const char *pathB) {
+    FILE *a = open_log_for_compare(pathA);
+    if (!a) {
+        return -1;
+    }
+    FILE *b = open_log_for_compare(pathB);
+    if (!b) {
+        fclose(a);
+        return -1;
+    }
+    int result = 0;
+    unsigned long frames = 0;
+    hash_log_record recordA, recordB;
+    while (1) {
+        size_t gotA = fread(&recordA, sizeof(recordA), 1, a);
+        size_t gotB = fread(&recordB, sizeof(recordB), 1, b);
+        if (!gotA || !gotB) {
+            if (gotA != gotB) {
+                printf("logs match for %lu frames, then %s ends\n", frames, gotA ? pathB : pathA);
+                result = 1;
+            }
+            break;
+        }
+        if (memcmp(recordA.hashes, recordB.hashes, sizeof(recordA.hashes))) {
+            printf("first divergence at frame %u:", recordA.frame);
+            for (int i = 0; i < HASH_SUBSYSTEMS; i++) {
+                if (recordA.hashes[i] != recordB.hashes[i]) {
+                    printf(" %s", subsystemNames[i]);
+                }
+            }
+            printf("\n");
+            result = 1;
+            break;
+        }
+        frames++;
+    }
+    if (!result) {
+        printf("logs match (%lu frames)\n", frames);
+    }
+    fclose(a);
+    fclose(b);
+    return result;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef STATEHASH_H
+#define STATEHASH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "savestate.h"
+
+#define HASH_LOG_MAGIC 0x4C484248 /* "HBHL" */
+#define HASH_LOG_VERSION 3
+
+/* One hash per subsystem, so a divergence says where it happened */
+enum {
+    HASH_CPU,
+    HASH_PPU,
+    HASH_VRAM,
+    HASH_XRAM,
+    HASH_WRAM,
+    HASH_HIRAM, /* echo, OAM, I/O and HRAM */
+    HASH_FRAMEBUFFER,
+    HASH_SUBSYSTEMS
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t subsystems;
+    uint32_t reserved;
+} hash_log_header;
+
+typedef struct {
+    uint32_t frame;
+    uint32_t reserved;
+    uint64_t hashes[HASH_SUBSYSTEMS];
+} hash_log_record;
+
+typedef struct {
+    FILE *fp;
+    uint32_t frame;
+    int withFramebuffer;
+    gb_savestate *scratch;
+} hash_log;
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed);
+void hash_machine(hash_log_record *record, gb_savestate *scratch, int withFramebuffer);
+hash_log *hash_log_open(const char *path, int withFramebuffer);
+void hash_log_frame(hash_log *log);
+void hash_log_close(hash_log *log);
+int hash_log_compare(const char *pathA, const char *pathB);
+
+#endif /* STATEHASH_H */
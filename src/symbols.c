@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symbols.h"
+#include "cgb.h"
+
+typedef struct {
+    uint32_t key; /* bank << 16 | addr */
+    char *name;
+} symbol;
+
+static symbol *symbols;
+static int symbolCount;
+
+/* Which part of the map addr is in, a label never covers past its own */
+static int region_of(uint16_t addr) {
+    if (addr < 0x4000) {
+        return 0; /* ROM0 */
+    }
+    if (addr < 0x8000) {
+        return 1; /* ROMX */
+    }
+    if (addr < 0xA000) {
+        return 2; /* VRAM */
+    }
+    if (addr < 0xC000) {
+        return 3; /* SRAM */
+    }
+    if (addr < 0xD000) {
+        return 4; /* WRAM0 */
+    }
+    if (addr < 0xE000) {
+        return 5; /* WRAMX */
+    }
+    if (addr >= 0xFF80 && addr < 0xFFFF) {
+        return 6; /* HRAM */
+    }
+    return 7;
+}
+
+/* rgblink numbers ROMX and WRAMX banks from 1, -t and -w write them as 0 */
+static uint8_t file_bank(uint8_t bank, uint16_t addr) {
+    int region = region_of(addr);
+    if ((region == 1 || region == 5) && !bank) {
+        return 1;
+    }
+    return bank;
+}
+
+/* The bank the .sym would give addr as the machine is now */
+static uint8_t running_bank(uint8_t bank, uint16_t addr) {
+    switch (region_of(addr)) {
+        case 1:
+            return bank ? bank : 1;
+        case 2:
+            return (uint8_t)vramBank;
+        case 5:
+            return (uint8_t)(wramBank ? wramBank : 1);
+        default:
+            return 0;
+    }
+}
+
+static int compare_symbols(const void *a, const void *b) {
+    uint32_t keyA = ((const symbol *)a)->key;
+    uint32_t keyB = ((const symbol *)b)->key;
+    return keyA < keyB ? -1 : keyA > keyB;
+}
+
+void symbols_free(void) {
+    for (int i = 0; i < symbolCount; i++) {
+        free(symbols[i].name);
+    }
+    free(symbols);
+    symbols = NULL;
+    symbolCount = 0;
+}
+
+char *symbols_path_for(const char *romPath) {
+    const char *dot = strrchr(romPath, '.');
+    const char *slash = strrchr(romPath, '/');
+    size_t stem = (dot && (!slash || dot > slash)) ? (size_t)(dot - romPath) : strlen(romPath);
+    char *path = malloc(stem + sizeof(".sym"));
+    if (path) {
+        memcpy(path, romPath, stem);
+        memcpy(path + stem, ".sym", sizeof(".sym"));
+    }
+    return path;
+}
+
+int symbols_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    symbols_free();
+    int capacity = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        unsigned int bank, addr;
+        char name[256];
+        /* Comments start with ; and so does the header rgblink writes */
+        if (sscanf(line, "%x:%x %255s", &bank, &addr, name) != 3 || bank > 0xFF || addr > 0xFFFF) {
+            continue;
+        }
+        if (strchr(name, '.')) {
+            continue;
+        }
+        if (symbolCount == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            symbol *grown = realloc(symbols, sizeof(symbol) * capacity);
+            if (!grown) {
+                printf("symbols: out of memory reading %s\n", path);
+                break;
+            }
+            symbols = grown;
+        }
+        symbols[symbolCount].key = (uint32_t)file_bank((uint8_t)bank, (uint16_t)addr) << 16 | addr;
+        symbols[symbolCount].name = strdup(name);
+        if (symbols[symbolCount].name) {
+            symbolCount++;
+        }
+    }
+    fclose(file);
+    qsort(symbols, symbolCount, sizeof(symbol), compare_symbols);
+    return symbolCount;
+}
+
+int symbols_loaded(void) {
+    return symbolCount;
+}
+
+int symbols_name(uint8_t bank, uint16_t addr, char *out, size_t size) {
+    uint32_t key = (uint32_t)running_bank(bank, addr) << 16 | addr;
+    /* The last symbol at or before key */
+    int low = 0, high = symbolCount;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (symbols[middle].key <= key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low > 0) {
+        const symbol *found = &symbols[low - 1];
+        if (found->key >> 16 == key >> 16 && region_of(found->key & 0xFFFF) == region_of(addr)) {
+            snprintf(out, size, "%s", found->name);
+            return 1;
+        }
+    }
+    snprintf(out, size, "$%02X:%04X", key >> 16, addr);
+    return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Labels from an RGBDS .sym file (rgblink -n), "BB:AAAA Name" a line.
+ * Local labels (Parent.local) are skipped so an address is named after
+ * the routine it is in rather than the nearest loop.
+ */
+
+/* romPath with its extension swapped for .sym, the caller frees it */
+char *symbols_path_for(const char *romPath);
+/* Returns how many symbols were loaded, -1 if path could not be read */
+int symbols_load(const char *path);
+void symbols_free(void);
+int symbols_loaded(void);
+
+/*
+ * The label at or before addr in the same bank and memory region, bank as
+ * bank_for_pc() gives it. Writes "$BB:AAAA" when no label covers it and
+ * returns 0, 1 when a label was found.
+ */
+int symbols_name(uint8_t bank, uint16_t addr, char *out, size_t size);
+
+#endif /* SYMBOLS_H */
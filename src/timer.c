@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#include "timer.h"
+#include "interrupts.h"
+#include "emu.h"
+
+uint64_t cycleCount = 0;
+uint64_t divBase = 0;
+uint64_t timaSyncedAt = 0;
+uint64_t timerEventAt = TIMER_NEVER;
+
+/* Cycles per TIMA increment by the low bits of TAC */
+static const uint32_t timaPeriods[4] = { 1024, 16, 64, 256 };
+
+static inline int timer_enabled(void) {
+    return emuRAM[TAC_ADDR] & 0x04;
+}
+
+static inline uint32_t timer_period(void) {
+    return timaPeriods[emuRAM[TAC_ADDR] & 0x03];
+}
+
+/*
+ * TIMA goes up each time the divider passes a multiple of the period, so
+ * the count between two times is a difference of two divisions.
+ */
+void timer_sync(void) {
+    uint64_t now = cycleCount;
+    if (now <= timaSyncedAt) {
+        return;
+    }
+    if (timer_enabled()) {
+        uint32_t period = timer_period();
+        uint64_t ticks = (now - divBase) / period - (timaSyncedAt - divBase) / period;
+        uint32_t tima = emuRAM[TIMA_ADDR];
+        while (ticks) {
+            if (tima + ticks < 0x100) {
+                tima += ticks;
+                break;
+            }
+            /* Overflow, reload from TMA and go on counting from there */
+            ticks -= 0x100 - tima;
+            tima = emuRAM[TMA_ADDR];
+            interrupt_request(INT_TIMER);
+        }
+        emuRAM[TIMA_ADDR] = tima;
+    }
+    timaSyncedAt = now;
+}
+
+/* Works out when TIMA overflows next, call with TIMA synced */
+static void timer_schedule(void) {
+    if (!timer_enabled()) {
+        timerEventAt = TIMER_NEVER;
+    } else {
+        uint32_t period = timer_period();
+        uint64_t ticks = 0x100 - emuRAM[TIMA_ADDR];
+        timerEventAt = divBase + ((timaSyncedAt - divBase) / period + ticks) * period;
+    }
+    schedule_update();
+}
+
+uint8_t timer_read(uint16_t addr) {
+    if (addr == DIV_ADDR) {
+        return (uint8_t)((cycleCount - divBase) >> 8);
+    }
+    timer_sync();
+    return emuRAM[TIMA_ADDR];
+}
+
+void timer_write(uint16_t addr, uint8_t value) {
+    timer_sync();
+    switch (addr) {
+        case DIV_ADDR: {
+            /* Resetting the divider is a falling edge if the bit TIMA watches was set */
+            uint32_t period = timer_period();
+            if (timer_enabled() && ((cycleCount - divBase) & (period >> 1))) {
+                emuRAM[TIMA_ADDR]++;
+                if (!emuRAM[TIMA_ADDR]) {
+                    emuRAM[TIMA_ADDR] = emuRAM[TMA_ADDR];
+                    interrupt_request(INT_TIMER);
+                }
+            }
+            divBase = cycleCount;
+            emuRAM[DIV_ADDR] = 0;
+            break;
+        }
+        case TIMA_ADDR:
+            emuRAM[TIMA_ADDR] = value;
+            break;
+        case TMA_ADDR:
+            emuRAM[TMA_ADDR] = value;
+            return; /* Only read on overflow, nothing moves */
+        case TAC_ADDR:
+            emuRAM[TAC_ADDR] = value | 0xF8;
+            break;
+    }
+    timer_schedule();
+}
+
+void timer_flush(void) {
+    timer_sync();
+    emuRAM[DIV_ADDR] = (uint8_t)((cycleCount - divBase) >> 8);
+}
+
+/* Run by the scheduler once cycleCount reaches timerEventAt, and after loading a state */
+void timer_reschedule(void) {
+    timer_sync();
+    timer_schedule();
+}
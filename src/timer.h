@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2024 Snoolie K / 0xilis. All rights reserved.
+ *
+ * This document is the property of Snoolie K / 0xilis.
+ * It is considered confidential and proprietary.
+ *
+ * This document may not be reproduced or transmitted in any form,
+ * in whole or in part, without the express written permission of
+ * Snoolie K / 0xilis.
+*/
+
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+#define DIV_ADDR 0xFF04
+#define TIMA_ADDR 0xFF05
+#define TMA_ADDR 0xFF06
+#define TAC_ADDR 0xFF07
+
+/* No event scheduled */
+#define TIMER_NEVER UINT64_MAX
+
+/*
+ * DIV and TIMA are never ticked. Both are worked out from cycleCount when
+ * read, and the next TIMA overflow is an event run_frame() stops at. Only
+ * writes to DIV, TIMA or TAC move the event.
+ */
+extern uint64_t cycleCount; /* T-cycles since power on, as of the start of the running step */
+extern uint64_t divBase; /* cycleCount when DIV was last reset */
+extern uint64_t timaSyncedAt; /* cycleCount emuRAM[TIMA_ADDR] is current for */
+extern uint64_t timerEventAt; /* when TIMA next overflows, TIMER_NEVER if stopped */
+
+uint8_t timer_read(uint16_t addr);
+void timer_write(uint16_t addr, uint8_t value);
+/* Brings TIMA up to cycleCount, raising the interrupt for every overflow passed */
+void timer_sync(void);
+/* Writes the current DIV and TIMA into emuRAM, for anything that reads it raw */
+void timer_flush(void);
+/* Syncs TIMA and works out the next overflow again */
+void timer_reschedule(void);
+
+#endif /* TIMER_H */